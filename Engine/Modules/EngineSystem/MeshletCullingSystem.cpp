@@ -0,0 +1,212 @@
+#include "MeshletCullingSystem.hpp"
+
+//libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    struct MeshletCullPushConstants
+    {
+        glm::vec4 frustumPlanes[6];
+        glm::vec4 cameraPosition;
+        uint32_t meshletCount;
+        uint32_t sourceIndex16Bit; // source index buffer is VK_INDEX_TYPE_UINT16
+    };
+
+    // keep the dispatch below the guaranteed maxComputeWorkGroupCount, see meshlet_cull.comp
+    static constexpr uint32_t MAX_GROUP_COUNT_X = 65535;
+
+    MeshletCullingSystem::MeshletCullingSystem(LveDevice& device) : mDevice{device}
+    {
+        createPipelineLayout();
+        createPipeline();
+    }
+
+    MeshletCullingSystem::~MeshletCullingSystem()
+    {
+        vkDestroyPipelineLayout(mDevice.device(), pipelineLayout, nullptr);
+    }
+
+    void MeshletCullingSystem::createPipelineLayout()
+    {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(MeshletCullPushConstants);
+
+        cullSetLayout = LveDescriptorSetLayout::Builder(mDevice)
+                            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // meshlets
+                            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // source indices
+                            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // culled indices
+                            .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)  // indirect draw
+                            .build();
+
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{cullSetLayout->getDescriptorSetLayout()};
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create meshlet culling pipeline layout!");
+        }
+    }
+
+    void MeshletCullingSystem::createPipeline()
+    {
+        assert(pipelineLayout != nullptr && "Cannot create compute pipeline before pipeline layout");
+
+        ComputePipelineConfigInfo computeConfig{};
+        ComputePipeline::defaultPipelineConfigInfo(computeConfig);
+        computeConfig.pipelineLayout = pipelineLayout;
+        computeConfig.pushConstantSize = sizeof(MeshletCullPushConstants);
+        computePipeline = std::make_unique<ComputePipeline>(
+            mDevice,
+            "E:/Projects/VulkanEngine/build/ShaderBin/meshlet_cull.comp.spv",
+            computeConfig);
+    }
+
+    void MeshletCullingSystem::reloadShaders(const std::vector<std::string>& changedFiles)
+    {
+        if (!computePipeline->dependsOn(changedFiles)) return;
+        // the old pipeline may still be in use by a frame in flight
+        vkDeviceWaitIdle(mDevice.device());
+        try
+        {
+            createPipeline();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Meshlet culling shader reload failed, keeping the old pipeline: " << e.what() << std::endl;
+        }
+    }
+
+    void MeshletCullingSystem::cull(FrameInfo& frameInfo)
+    {
+        VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+        // reset the indirect draws of this frame: indexCount 0, instanceCount 1, firstIndex at the submesh
+        bool hasWork = false;
+        for (auto& kv : frameInfo.gameObjects)
+        {
+            auto& obj = kv.second;
+            if (obj.model == nullptr || !obj.model->hasMeshlets()) continue;
+
+            VkBufferCopy copyRegion{};
+            copyRegion.size = obj.model->getDrawCommandsSize();
+            vkCmdCopyBuffer(
+                commandBuffer,
+                obj.model->getDrawCommandResetBuffer(),
+                obj.model->getDrawCommandBuffer(frameInfo.frameIndex),
+                1,
+                &copyRegion);
+            hasWork = true;
+        }
+        if (!hasWork) return;
+
+        VkMemoryBarrier resetBarrier{};
+        resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &resetBarrier,
+            0, nullptr,
+            0, nullptr);
+
+        computePipeline->bind(commandBuffer);
+
+        glm::mat4 viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+        for (auto& kv : frameInfo.gameObjects)
+        {
+            auto& obj = kv.second;
+            if (obj.model == nullptr || !obj.model->hasMeshlets()) continue;
+
+            auto meshletInfo = obj.model->getMeshletBufferInfo();
+            auto sourceInfo = obj.model->getIndexBufferInfo();
+            auto culledInfo = obj.model->getCulledIndexBufferInfo(frameInfo.frameIndex);
+            auto drawInfo = obj.model->getDrawCommandBufferInfo(frameInfo.frameIndex);
+
+            VkDescriptorSet cullDescriptorSet;
+            LveDescriptorWriter(*cullSetLayout, frameInfo.frameDescriptorPool)
+                .writeBuffer(0, &meshletInfo)
+                .writeBuffer(1, &sourceInfo)
+                .writeBuffer(2, &culledInfo)
+                .writeBuffer(3, &drawInfo)
+                .build(cullDescriptorSet);
+
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_COMPUTE,
+                pipelineLayout,
+                0,
+                1,
+                &cullDescriptorSet,
+                0,
+                nullptr);
+
+            // Gribb-Hartmann plane extraction, done on the full mvp so the planes end up in object space
+            glm::mat4 modelMatrix = obj.transform.mat4();
+            glm::mat4 mvp = viewProjection * modelMatrix;
+            glm::vec4 row0{mvp[0][0], mvp[1][0], mvp[2][0], mvp[3][0]};
+            glm::vec4 row1{mvp[0][1], mvp[1][1], mvp[2][1], mvp[3][1]};
+            glm::vec4 row2{mvp[0][2], mvp[1][2], mvp[2][2], mvp[3][2]};
+            glm::vec4 row3{mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]};
+
+            MeshletCullPushConstants push{};
+            push.frustumPlanes[0] = row3 + row0; // left
+            push.frustumPlanes[1] = row3 - row0; // right
+            push.frustumPlanes[2] = row3 + row1; // top (vulkan clip space y points down)
+            push.frustumPlanes[3] = row3 - row1; // bottom
+            push.frustumPlanes[4] = row2;        // near, depth range is [0, 1]
+            push.frustumPlanes[5] = row3 - row2; // far
+            for (auto& plane : push.frustumPlanes)
+            {
+                plane /= glm::length(glm::vec3(plane));
+            }
+            push.cameraPosition = glm::inverse(modelMatrix) * glm::vec4(frameInfo.camera.getPosition(), 1.0f);
+            push.meshletCount = obj.model->getMeshletCount();
+            push.sourceIndex16Bit = obj.model->getIndexType() == VK_INDEX_TYPE_UINT16 ? 1 : 0;
+
+            vkCmdPushConstants(
+                commandBuffer,
+                pipelineLayout,
+                VK_SHADER_STAGE_COMPUTE_BIT,
+                0,
+                sizeof(MeshletCullPushConstants),
+                &push);
+
+            uint32_t groupCountX = std::min(push.meshletCount, MAX_GROUP_COUNT_X);
+            uint32_t groupCountY = (push.meshletCount + MAX_GROUP_COUNT_X - 1) / MAX_GROUP_COUNT_X;
+            computePipeline->dispatch(commandBuffer, groupCountX, groupCountY, 1);
+        }
+
+        // culled indices and draw counts are consumed by the indirect draws of the render pass
+        VkMemoryBarrier cullBarrier{};
+        cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            1, &cullBarrier,
+            0, nullptr,
+            0, nullptr);
+    }
+
+}
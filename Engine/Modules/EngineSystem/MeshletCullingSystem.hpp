@@ -0,0 +1,49 @@
+/*************************************************
+Meshlet Culling System:
+Runs before the swap chain render pass. For every game object whose model
+was imported with meshlets, a compute pass rejects clusters outside the
+view frustum or facing away from the camera and writes the surviving
+triangles into the model's per-frame indirect draws, one per submesh so
+every material range is still drawn with its own material.
+*************************************************/
+#pragma once
+
+#include "../Rendering/ComputePipeline.hpp"
+#include "../Rendering/Vulkan/Device.hpp"
+#include "../Rendering/Vulkan/Descriptors.hpp"
+#include "../GameFramework/FrameInfo.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+
+    class MeshletCullingSystem
+    {
+    public:
+        MeshletCullingSystem(LveDevice& device);
+        ~MeshletCullingSystem();
+
+        MeshletCullingSystem(const MeshletCullingSystem&) = delete;
+        MeshletCullingSystem& operator=(const MeshletCullingSystem&) = delete;
+
+        // must be recorded outside of a render pass
+        void cull(FrameInfo& frameInfo);
+        // rebuilds the pipeline if meshlet_cull.comp.spv changed, a broken shader keeps the old one
+        void reloadShaders(const std::vector<std::string>& changedFiles);
+
+    private:
+        void createPipelineLayout();
+        void createPipeline();
+
+        LveDevice& mDevice;
+
+        std::unique_ptr<ComputePipeline> computePipeline;
+        VkPipelineLayout pipelineLayout;
+        std::unique_ptr<LveDescriptorSetLayout> cullSetLayout;
+    };
+
+}
@@ -6,6 +6,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
 #include <stdexcept>
 namespace RenderingEngine
 {
@@ -15,20 +19,71 @@ namespace RenderingEngine
         glm::mat4 normalMatrix{1.0f};
     };
     
-    PBRRenderSystem::PBRRenderSystem(LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalDescriptorSetLayout)
-        : mDevice(device)
+    PBRRenderSystem::PBRRenderSystem(
+        LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalDescriptorSetLayout,
+        VirtualTextureSystem& virtualTextures)
+        : mDevice(device), mRenderPass(renderPass), mVirtualTextures(virtualTextures), shProjector(device),
+          iblBaker(device, shProjector)
     {
         createPipelineLayout(globalDescriptorSetLayout);
         createPipeline(renderPass);
-        createComputePipeline();  
+        ibl = iblBaker.bakeEmpty();
     }
     
     PBRRenderSystem::~PBRRenderSystem()
     {
         vkDestroyPipelineLayout(mDevice.device(), graphicsPipelineLayout, nullptr);  
-        vkDestroyPipelineLayout(mDevice.device(), computePipelineLayout, nullptr);  
+    }
+
+    void PBRRenderSystem::setEnvironment(std::shared_ptr<LveTexture> environment)
+    {
+        // frames in flight may still sample the old maps
+        vkQueueWaitIdle(mDevice.graphicsQueue());
+        ibl = environment ? iblBaker.bake(*environment) : iblBaker.bakeEmpty();
+    }
+
+    void PBRRenderSystem::loadEnvironment(const std::string& filepath)
+    {
+        vkQueueWaitIdle(mDevice.graphicsQueue());
+        ibl = iblBaker.load(filepath);
+    }
+
+    void PBRRenderSystem::setDynamicEnvironment(std::shared_ptr<LveTexture> environment)
+    {
+        vkQueueWaitIdle(mDevice.graphicsQueue());
+        dynamicEnvironment = std::move(environment);
+    }
+
+    void PBRRenderSystem::update(GlobalUbo& ubo) const
+    {
+        std::copy(ibl.irradianceSH.begin(), ibl.irradianceSH.end(), ubo.irradianceSH);
+    }
+
+    void PBRRenderSystem::recordEnvironmentProjection(FrameInfo& frameInfo, VkBuffer globalUbo)
+    {
+        if (dynamicEnvironment == nullptr) return;
+        // overwrites what update put into the buffer, the host write happened before the submission
+        shProjector.record(
+            frameInfo.commandBuffer, *dynamicEnvironment, frameInfo.frameDescriptorPool, globalUbo,
+            offsetof(GlobalUbo, irradianceSH));
     }
     
+    void PBRRenderSystem::reloadShaders(const std::vector<std::string>& changedFiles)
+    {
+        if (!graphicsPipeline->dependsOn(changedFiles) && !compactGraphicsPipeline->dependsOn(changedFiles)) return;
+
+        // the old pipelines may still be in use by a frame in flight
+        vkDeviceWaitIdle(mDevice.device());
+        try
+        {
+            createPipeline(mRenderPass);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "PBR shader reload failed, keeping the old pipeline: " << e.what() << std::endl;
+        }
+    }
+
     void PBRRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout)
     {
         // graphics pipeline layout
@@ -38,6 +93,18 @@ namespace RenderingEngine
         pushConstantRange.size = sizeof(SimplePushConstantData);
         
     
+        // the image based lighting maps are always sampled the same way, their sampler lives in the layout
+        VkSamplerCreateInfo iblSamplerInfo{};
+        iblSamplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        iblSamplerInfo.magFilter = VK_FILTER_LINEAR;
+        iblSamplerInfo.minFilter = VK_FILTER_LINEAR;
+        iblSamplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        iblSamplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        iblSamplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        iblSamplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        iblSamplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        VkSampler iblSampler = mDevice.getSampler(iblSamplerInfo);
+
         renderSystemLayout = LveDescriptorSetLayout::Builder(mDevice)
                                   .addBinding(
                                       0,
@@ -45,11 +112,14 @@ namespace RenderingEngine
                                       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
                                   .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // albedo
                                   .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // normal
-                                  .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // roughness
-                                  .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // metallic
-                                  .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // specular
-                                  .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // irradiance
-                                  .addBinding(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // specularBRDF_LUT                       
+                                  .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)   // occlusion / roughness / metallic
+                                  .addImmutableSamplerBinding(4, VK_SHADER_STAGE_FRAGMENT_BIT, iblSampler)   // specular
+                                  // 5 is unused, diffuse ambient light is GlobalUbo::irradianceSH
+                                  .addImmutableSamplerBinding(6, VK_SHADER_STAGE_FRAGMENT_BIT, iblSampler)   // specularBRDF_LUT
+                                  .addImmutableSamplerBinding(7, VK_SHADER_STAGE_FRAGMENT_BIT, mVirtualTextures.getPageTableSampler())   // virtual albedo page table
+                                  .addImmutableSamplerBinding(8, VK_SHADER_STAGE_FRAGMENT_BIT, mVirtualTextures.getTileCacheSampler())   // virtual albedo tile cache
+                                  .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)   // virtual albedo page requests
+                                  .addBinding(10, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)   // material factors
                                 .build();
 
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
@@ -68,27 +138,6 @@ namespace RenderingEngine
         {
             throw std::runtime_error("Failed to create graphics pipeline layout!");
         }
-
-        // compute pipeline layout
-        computeSystemLayout = LveDescriptorSetLayout::Builder(mDevice)
-                                  .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // input 
-                                  .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT) // output   
-                                  .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)  // output mipmap 
-                                .build();
-        std::vector<VkDescriptorSetLayout> computeDescriptorSetLayouts{  
-            computeSystemLayout->getDescriptorSetLayout()  
-        }; 
-        VkPipelineLayoutCreateInfo computePipelineLayoutInfo{};  
-        computePipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;  
-        computePipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(computeDescriptorSetLayouts.size());  
-        computePipelineLayoutInfo.pSetLayouts = computeDescriptorSetLayouts.data();  
-        computePipelineLayoutInfo.pushConstantRangeCount = 0;  
-        computePipelineLayoutInfo.pPushConstantRanges = nullptr; 
-
-        if (vkCreatePipelineLayout(mDevice.device(), &computePipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create compute pipeline layout!");
-        }
     }
     
     void PBRRenderSystem::createPipeline(VkRenderPass renderPass)
@@ -106,25 +155,25 @@ namespace RenderingEngine
             "E:/Projects/VulkanEngine/build/ShaderBin/pbr.vert.spv", 
             "E:/Projects/VulkanEngine/build/ShaderBin/pbr.frag.spv", 
             pipelineConfig);
-    }
 
-    void PBRRenderSystem::createComputePipeline()  
-    {  
-        assert(computePipelineLayout != nullptr && "Cannot create compute pipeline before pipeline layout");
+        // same layout and fragment stage, only the vertex input and its decoding differ
+        PipelineConfigInfo compactPipelineConfig{};
+        BasicPipeline::defaultPipelineConfigInfo(compactPipelineConfig);
+        compactPipelineConfig.bindingDescriptions = LveModel::CompactVertex::getBindingDescriptions();
+        compactPipelineConfig.attributeDescriptions = LveModel::CompactVertex::getAttributeDescriptions();
+        compactPipelineConfig.renderPass = renderPass;
+        compactPipelineConfig.pipelineLayout = graphicsPipelineLayout;
 
-        ComputePipelineConfigInfo computeConfig{};  
-        ComputePipeline::defaultPipelineConfigInfo(computeConfig);  
-        computeConfig.pipelineLayout = computePipelineLayout;  
-        computePipeline = std::make_unique<ComputePipeline>(  
-            mDevice,  
-            "E:/Projects/VulkanEngine/build/ShaderBin/irmap.comp.spv",  
-            computeConfig  
-        );  
-    } 
+        compactGraphicsPipeline = std::make_unique<BasicPipeline>(mDevice, 
+            "E:/Projects/VulkanEngine/build/ShaderBin/pbr_compact.vert.spv", 
+            "E:/Projects/VulkanEngine/build/ShaderBin/pbr.frag.spv", 
+            compactPipelineConfig);
+    }
 
     void PBRRenderSystem::performRenderPass(FrameInfo& frameInfo)  
     {
-        graphicsPipeline->bind(frameInfo.commandBuffer);
+        BasicPipeline* boundPipeline = graphicsPipeline.get();
+        boundPipeline->bind(frameInfo.commandBuffer);
         
         vkCmdBindDescriptorSets(
             frameInfo.commandBuffer,
@@ -136,6 +185,10 @@ namespace RenderingEngine
             0,
             nullptr);
 
+        // the environment is the same for every object
+        auto specularInfo = ibl.specular->getImageInfo();
+        auto brdfLutInfo = ibl.brdfLut->getImageInfo();
+
         for (auto& kv : frameInfo.gameObjects)
         {
             auto& obj = kv.second;
@@ -144,34 +197,56 @@ namespace RenderingEngine
                 continue;
             }
 
+            // both pipelines share graphicsPipelineLayout, so bound descriptor sets stay valid across the switch
+            BasicPipeline* pipeline = obj.model->getVertexFormat() == LveModel::VertexFormat::Compact
+                                          ? compactGraphicsPipeline.get()
+                                          : graphicsPipeline.get();
+            if (pipeline != boundPipeline)
+            {
+                pipeline->bind(frameInfo.commandBuffer);
+                boundPipeline = pipeline;
+            }
+
             auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-            auto albedoInfo = obj.diffuseMap->getImageInfo();
-            auto normalInfo = obj.normalMap->getImageInfo();
-            auto roughnessInfo = obj.roughnessMap->getImageInfo();
-            auto metallicInfo = obj.metallicMap->getImageInfo();
-                 
-            VkDescriptorSet gameObjectDescriptorSet;
-
-            LveDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-                .writeBuffer(0, &bufferInfo)
-                .writeImage(1, &albedoInfo)
-                .writeImage(2, &normalInfo)
-                .writeImage(3, &roughnessInfo)
-                .writeImage(4, &metallicInfo)
-                .writeImage(5, &metallicInfo)
-                .writeImage(6, &metallicInfo)
-                .writeImage(7, &metallicInfo)
-                .build(gameObjectDescriptorSet);
-
-            vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                graphicsPipelineLayout,
-                1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-                1,  // set count
-                &gameObjectDescriptorSet,
-                0,
-                nullptr);
+            auto feedbackInfo = mVirtualTextures.getFeedbackInfo(obj.virtualAlbedo.get(), frameInfo.frameIndex);
+
+            // one set per material, an object without materials draws everything with its own maps
+            auto bindMaterial = [&](size_t materialIndex) {
+                const MaterialComponent* material = obj.materials.empty() ? nullptr : &obj.materials[materialIndex];
+                auto albedoInfo = (material ? material->albedoMap : obj.diffuseMap)->getImageInfo();
+                auto normalInfo = (material ? material->normalMap : obj.normalMap)->getImageInfo();
+                auto ormInfo = (material ? material->ormMap : obj.ormMap)->getImageInfo();
+                auto materialInfo = obj.getMaterialBufferInfo(frameInfo.frameIndex, materialIndex);
+                // without a virtual albedo the shader never reads these, any image of the right type will do
+                auto pageTableInfo = obj.virtualAlbedo ? obj.virtualAlbedo->getPageTableInfo()
+                                                       : mVirtualTextures.getFallbackPageTableInfo();
+                auto tileCacheInfo = obj.virtualAlbedo ? mVirtualTextures.getTileCacheInfo(*obj.virtualAlbedo) : albedoInfo;
+
+                VkDescriptorSet gameObjectDescriptorSet;
+
+                LveDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
+                    .writeBuffer(0, &bufferInfo)
+                    .writeImage(1, &albedoInfo)
+                    .writeImage(2, &normalInfo)
+                    .writeImage(3, &ormInfo)
+                    .writeImage(4, &specularInfo)
+                    .writeImage(6, &brdfLutInfo)
+                    .writeImage(7, &pageTableInfo)
+                    .writeImage(8, &tileCacheInfo)
+                    .writeBuffer(9, &feedbackInfo)
+                    .writeBuffer(10, &materialInfo)
+                    .build(gameObjectDescriptorSet);
+
+                vkCmdBindDescriptorSets(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    graphicsPipelineLayout,
+                    1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
+                    1,  // set count
+                    &gameObjectDescriptorSet,
+                    0,
+                    nullptr);
+            };
 
 
             SimplePushConstantData push{};
@@ -187,51 +262,44 @@ namespace RenderingEngine
                 sizeof(SimplePushConstantData),
                 &push);
 
-            obj.model->bind(frameInfo.commandBuffer);
-            obj.model->draw(frameInfo.commandBuffer);
-        }
-    }
-
-    void PBRRenderSystem::performComputePass(FrameInfo& frameInfo)  
-    {  
-        computePipeline->bind(frameInfo.commandBuffer);  
-        
-        for (auto& kv : frameInfo.gameObjects)
-        {
-            auto& obj = kv.second;
-            if (obj.envMap == nullptr)
+            // meshlet models draw the triangles that survived MeshletCullingSystem::cull this frame
+            bool culled = obj.model->hasMeshlets();
+            if (culled)
             {
-                continue;
+                obj.model->bindCulled(frameInfo.commandBuffer, frameInfo.frameIndex);
             }
-
-            auto envMapInfo = obj.envMap->getImageInfo();
-            auto albedoInfo = obj.diffuseMap->getImageInfo();
-
-            VkDescriptorSet envMapDescriptorSet;
-
-            LveDescriptorWriter(*computeSystemLayout, frameInfo.frameDescriptorPool)
-                .writeImage(0, &albedoInfo)
-                .writeImage(1, &envMapInfo)
-                .writeImage(2, &envMapInfo)
-                .build(envMapDescriptorSet);
-
-            vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_COMPUTE,
-                computePipelineLayout,
-                0, 
-                1,  
-                &envMapDescriptorSet,
-                0,
-                nullptr);
+            else
+            {
+                obj.model->bind(frameInfo.commandBuffer);
             }
-            // computePipeline->dispatch(frameInfo.commandBuffer, 32, 32, 1);
 
-    }  
+            // one draw per material range, a set is only bound when the material changes
+            size_t boundMaterial = SIZE_MAX;
+            const auto& submeshes = obj.model->getSubmeshes();
+            for (uint32_t i = 0; i < submeshes.size(); i++)
+            {
+                size_t material = obj.materials.empty()
+                                      ? 0
+                                      : std::min<size_t>(submeshes[i].materialIndex, obj.materials.size() - 1);
+                if (material != boundMaterial)
+                {
+                    bindMaterial(material);
+                    boundMaterial = material;
+                }
+                if (culled)
+                {
+                    obj.model->drawCulled(frameInfo.commandBuffer, frameInfo.frameIndex, i);
+                }
+                else
+                {
+                    obj.model->drawSubmesh(frameInfo.commandBuffer, i);
+                }
+            }
+        }
+    }
 
     void PBRRenderSystem::renderGameObjects(FrameInfo& frameInfo)
     {
-        performComputePass(frameInfo);
         performRenderPass(frameInfo);
     }
     
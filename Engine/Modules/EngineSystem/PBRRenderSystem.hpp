@@ -1,14 +1,16 @@
 ﻿#pragma once
 
 #include "../Rendering/BasicPipeline.hpp"
-#include "../Rendering/ComputePipeline.hpp"
 #include "../Rendering/Vulkan/Device.hpp"
 #include "../Rendering/Vulkan/Descriptors.hpp"
+#include "../Rendering/Vulkan/IBLBaker.hpp"
+#include "../Rendering/Vulkan/VirtualTextureSystem.hpp"
 #include "../GameFramework/GameObject.hpp"
 #include "../GameFramework/Camera.hpp"
 #include "../GameFramework/FrameInfo.hpp"
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace RenderingEngine
@@ -18,31 +20,50 @@ namespace RenderingEngine
     {
     public:
         
-        PBRRenderSystem(LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalDescriptorSetLayout);
+        PBRRenderSystem(
+            LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalDescriptorSetLayout,
+            VirtualTextureSystem& virtualTextures);
         ~PBRRenderSystem();
         
         PBRRenderSystem(const PBRRenderSystem&) = delete;
         PBRRenderSystem& operator=(const PBRRenderSystem&) = delete;
+        // writes the environment's irradiance coefficients
+        void update(GlobalUbo& ubo) const;
+        // re-projects the dynamic environment's irradiance into this frame's globalUbo buffer,
+        // record before the render pass; nothing without a dynamic environment
+        void recordEnvironmentProjection(FrameInfo& frameInfo, VkBuffer globalUbo);
         void renderGameObjects(FrameInfo& frameInfo);
+        // bakes the image based lighting of an environment cube once, nullptr turns ambient light off;
+        // waits for the graphics queue, so no frame is in flight while the maps are swapped
+        void setEnvironment(std::shared_ptr<LveTexture> environment);
+        // the same for an equirectangular image, the baked maps are cached next to it (IBLCache)
+        void loadEnvironment(const std::string& filepath);
+        // an environment that changes every frame, e.g. a sky with a time of day: its diffuse irradiance is
+        // projected each frame, specular keeps the maps of the last setEnvironment / loadEnvironment
+        void setDynamicEnvironment(std::shared_ptr<LveTexture> environment);
+        // rebuilds the pipelines built from a changed SPIR-V file, a broken shader keeps the old pipeline
+        void reloadShaders(const std::vector<std::string>& changedFiles);
    
     private:
         void createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout);
         void createPipeline(VkRenderPass renderPass);
 
-        void createComputePipeline(); 
-
-        void performComputePass(FrameInfo& frameInfo);  
         void performRenderPass(FrameInfo& frameInfo);  
 
         LveDevice& mDevice;
+        VkRenderPass mRenderPass;
+        VirtualTextureSystem& mVirtualTextures;
 
         std::unique_ptr<BasicPipeline> graphicsPipeline;  
-        std::unique_ptr<ComputePipeline> computePipeline;  
+        std::unique_ptr<BasicPipeline> compactGraphicsPipeline; // LveModel::CompactVertex input
         VkPipelineLayout graphicsPipelineLayout;  
-        VkPipelineLayout computePipelineLayout;  
 
         std::unique_ptr<LveDescriptorSetLayout> renderSystemLayout;  
-        std::unique_ptr<LveDescriptorSetLayout> computeSystemLayout;
+
+        SHProjector shProjector;
+        IBLBaker iblBaker;
+        IBLMaps ibl;
+        std::shared_ptr<LveTexture> dynamicEnvironment;
     };
 
 }
\ No newline at end of file
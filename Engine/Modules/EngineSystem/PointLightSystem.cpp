@@ -7,6 +7,7 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <iostream>
 #include <stdexcept>
 #include <map>
 
@@ -21,7 +22,7 @@ namespace RenderingEngine
 
 
     PointLightSystem::PointLightSystem(LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout):
-        lveDevice{device}
+        lveDevice{device}, mRenderPass{renderPass}
     {
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
@@ -74,6 +75,21 @@ namespace RenderingEngine
         );
     }
 
+    void PointLightSystem::reloadShaders(const std::vector<std::string>& changedFiles)
+    {
+        if (!Pipeline->dependsOn(changedFiles)) return;
+        // the old pipeline may still be in use by a frame in flight
+        vkDeviceWaitIdle(lveDevice.device());
+        try
+        {
+            createPipeline(mRenderPass);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Point light shader reload failed, keeping the old pipeline: " << e.what() << std::endl;
+        }
+    }
+
     void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
     {
         // auto rotateLight = glm::rotate(
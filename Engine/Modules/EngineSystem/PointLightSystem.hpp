@@ -18,6 +18,8 @@ It is application's resbonsibility to check whether an object is compatible to a
 
 // std
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace RenderingEngine
 {
@@ -33,12 +35,15 @@ namespace RenderingEngine
 
         void update(FrameInfo& frameInfo, GlobalUbo& ubo);
         void render(FrameInfo& frameInfo);
+        // rebuilds the pipeline if one of its SPIR-V files changed, a broken shader keeps the old one
+        void reloadShaders(const std::vector<std::string>& changedFiles);
 
     private:
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void createPipeline(VkRenderPass renderPass);
 
         LveDevice& lveDevice;
+        VkRenderPass mRenderPass;
         
         std::unique_ptr<BasicPipeline> Pipeline;
         VkPipelineLayout pipelineLayout;
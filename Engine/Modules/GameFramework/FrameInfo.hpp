@@ -26,6 +26,8 @@ namespace RenderingEngine
         glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.02f}; // w is light intensity
         PointLight pointLights[MAX_LIGHTS];
         int numLights;
+        // diffuse ambient light of the environment, L2 spherical harmonics (SHProjector)
+        alignas(16) glm::vec4 irradianceSH[9]{};
     };
 
     struct FrameInfo
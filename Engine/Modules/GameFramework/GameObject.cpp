@@ -1,9 +1,24 @@
 ﻿#include "GameObject.hpp"
+#include "Camera.hpp"
 
+#include <algorithm>
 #include <numeric>
 
 namespace RenderingEngine {
 
+    namespace {
+      // a 1x1 texture of one color
+      std::shared_ptr<LveTexture> makeSolidTexture(LveDevice& device, uint8_t r, uint8_t g, uint8_t b) {
+        LveTexture::ImageData image{};
+        image.width = 1;
+        image.height = 1;
+        image.size = 4;
+        image.pixels = std::shared_ptr<uint8_t>(new uint8_t[4]{r, g, b, 255}, std::default_delete<uint8_t[]>());
+        return std::make_shared<LveTexture>(
+            device, image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+      }
+    }
+
     glm::mat4 TransformComponent::mat4() {
         const float c3 = glm::cos(rotation.z);
         const float s3 = glm::sin(rotation.z);
@@ -71,7 +86,7 @@ namespace RenderingEngine {
           return gameObj;
     }
 
-    GameObjectManager::GameObjectManager(LveDevice& device) {
+    GameObjectManager::GameObjectManager(LveDevice& device, AssetManager& assetManager) {
       // including nonCoherentAtomSize allows us to flush a specific index at once
       int alignment = std::lcm(
           device.properties.limits.nonCoherentAtomSize,
@@ -86,27 +101,124 @@ namespace RenderingEngine {
             alignment);
         uboBuffers[i]->map();
       }
+      for (int i = 0; i < materialBuffers.size(); i++) {
+        materialBuffers[i] = std::make_unique<LveBuffer>(
+            device,
+            sizeof(MaterialBufferData),
+            GameObjectManager::MAX_MATERIAL_SLOTS,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            alignment);
+        materialBuffers[i]->map();
+      }
       // init textureDefault as missing texture
-      textureDefault = LveTexture::createTextureFromFile(device, "E:/Projects/VulkanEngine/Assets/Textures/missing.png");
+      textureDefault = assetManager.loadTexture("E:/Projects/VulkanEngine/Assets/Textures/missing.png");
+      whiteTexture = makeSolidTexture(device, 255, 255, 255);
+      flatNormalTexture = makeSolidTexture(device, 128, 128, 255);
     }
 
     void GameObjectManager::updateBuffer(int frameIndex) {
       // copy model matrix and normal matrix for each gameObj into
-      // buffer for this frame
+      // buffer for this frame, material factors go into consecutive slots of the material buffer
+      uint32_t materialSlot = 0;
       for (auto& kv : gameObjects) {
         auto& obj = kv.second;
         GameObjectBufferData data{};
         data.modelMatrix = obj.transform.mat4();
         data.normalMatrix = obj.transform.normalMatrix();
+        if (obj.model != nullptr && obj.model->getVertexFormat() == LveModel::VertexFormat::Compact) {
+          data.positionScale = glm::vec4(obj.model->getPositionScale(), 0.0f);
+          data.positionOffset = glm::vec4(obj.model->getPositionOffset(), 0.0f);
+        }
+        data.virtualTextures.x = obj.virtualAlbedo != nullptr ? 1u : 0u;
         uboBuffers[frameIndex]->writeToIndex(&data, kv.first);
+
+        uint32_t slotCount = static_cast<uint32_t>(std::max<size_t>(obj.materials.size(), 1));
+        assert(materialSlot + slotCount <= MAX_MATERIAL_SLOTS && "Max material slot count exceeded!");
+        obj.materialSlot = materialSlot;
+        for (uint32_t i = 0; i < slotCount; i++) {
+          MaterialBufferData material{};
+          if (i < obj.materials.size()) {
+            material.baseColorFactor = obj.materials[i].baseColorFactor;
+            material.factors = {obj.materials[i].metallicFactor, obj.materials[i].roughnessFactor, 0.f, 0.f};
+          }
+          materialBuffers[frameIndex]->writeToIndex(&material, materialSlot + i);
+        }
+        materialSlot += slotCount;
       }
       uboBuffers[frameIndex]->flush();
+      materialBuffers[frameIndex]->flush();
+    }
+
+    void GameObjectManager::requestTextureLevels(TextureStreamer& streamer, const Camera& camera, float viewportHeight) {
+      // projection[1][1] is 1 / tan(fovy / 2)
+      float pixelsPerUnit = camera.getProjection()[1][1] * 0.5f * viewportHeight;
+      glm::vec3 eye = camera.getPosition();
+      for (auto& kv : gameObjects) {
+        auto& obj = kv.second;
+        if (obj.model == nullptr) continue;
+        // compact models know their bounds, standard ones count as a unit box
+        glm::vec3 extent = obj.model->getPositionScale() * glm::abs(obj.transform.scale);
+        glm::vec3 center = obj.transform.mat4() * glm::vec4(obj.model->getPositionOffset() + 0.5f * obj.model->getPositionScale(), 1.0f);
+        float radius = 0.5f * glm::length(extent);
+        float distance = glm::max(glm::length(center - eye) - radius, 0.01f);
+        float pixels = 2.0f * radius / distance * pixelsPerUnit;
+        for (auto* texture : {&obj.diffuseMap, &obj.normalMap, &obj.ormMap}) {
+          if (*texture) streamer.requestScreenSize(texture->get(), pixels);
+        }
+        for (auto& material : obj.materials) {
+          for (auto* texture : {&material.albedoMap, &material.normalMap, &material.ormMap}) {
+            if (*texture) streamer.requestScreenSize(texture->get(), pixels);
+          }
+        }
+      }
+    }
+
+    void GameObjectManager::replaceAssets(const std::vector<AssetManager::Replacement>& replacements) {
+      for (const auto& replacement : replacements) {
+        if (replacement.oldTexture == textureDefault) textureDefault = replacement.newTexture;
+        for (auto& kv : gameObjects) {
+          auto& obj = kv.second;
+          if (replacement.oldModel && obj.model == replacement.oldModel) obj.model = replacement.newModel;
+          if (!replacement.oldTexture) continue;
+          for (auto* texture : {&obj.diffuseMap, &obj.normalMap, &obj.ormMap}) {
+            if (*texture == replacement.oldTexture) *texture = replacement.newTexture;
+          }
+          for (auto& material : obj.materials) {
+            for (auto* texture : {&material.albedoMap, &material.normalMap, &material.ormMap}) {
+              if (*texture == replacement.oldTexture) *texture = replacement.newTexture;
+            }
+          }
+        }
+      }
     }
 
     VkDescriptorBufferInfo GameObject::getBufferInfo(int frameIndex) {
       return gameObjectManger.getBufferInfoForGameObject(frameIndex, id);
     }
 
+    VkDescriptorBufferInfo GameObject::getMaterialBufferInfo(int frameIndex, size_t materialIndex) {
+      uint32_t slot = materials.empty() ? 0 : static_cast<uint32_t>(std::min(materialIndex, materials.size() - 1));
+      return gameObjectManger.getMaterialBufferInfo(frameIndex, materialSlot + slot);
+    }
+
+    void GameObject::setMaterials(const AssetLoader& loader, const std::vector<AssetLoader::MaterialRequest>& requests) {
+      materials.clear();
+      for (const auto& request : requests) {
+        MaterialComponent material{};
+        material.albedoMap = loader.getTexture(request.albedo);
+        material.normalMap = loader.getTexture(request.normal);
+        material.ormMap = loader.getTexture(request.orm);
+        if (!material.albedoMap) material.albedoMap = gameObjectManger.whiteTexture;
+        if (!material.normalMap) material.normalMap = gameObjectManger.flatNormalTexture;
+        if (!material.ormMap) material.ormMap = gameObjectManger.whiteTexture;
+        material.baseColorFactor = request.baseColorFactor;
+        material.metallicFactor = request.metallicFactor;
+        material.roughnessFactor = request.roughnessFactor;
+        materials.push_back(std::move(material));
+      }
+    }
+
     GameObject::GameObject(id_t objId, const GameObjectManager& manager)
         : id{objId}, gameObjectManger{manager} {}
 
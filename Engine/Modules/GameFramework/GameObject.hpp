@@ -1,8 +1,12 @@
 ﻿#pragma once
 
+#include "../Rendering/Vulkan/AssetLoader.hpp"
+#include "../Rendering/Vulkan/AssetManager.hpp"
 #include "../Rendering/Vulkan/Model.hpp"
 #include "../Rendering/Vulkan/SwapChain.hpp"
 #include "../Rendering/Vulkan/Texture.hpp"
+#include "../Rendering/Vulkan/TextureStreamer.hpp"
+#include "../Rendering/Vulkan/VirtualTextureSystem.hpp"
 
 // libs
 #include <glm/gtc/matrix_transform.hpp>
@@ -10,6 +14,7 @@
 // std
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 namespace RenderingEngine {
 
@@ -33,8 +38,32 @@ struct PointLightComponent {
 struct GameObjectBufferData {
   glm::mat4 modelMatrix{1.f};
   glm::mat4 normalMatrix{1.f};
+  // dequantization of compact vertex positions, identity for the standard vertex format
+  glm::vec4 positionScale{1.f};
+  glm::vec4 positionOffset{0.f};
+  // x: albedo comes from the virtual texture bindings instead of the albedo texture
+  glm::uvec4 virtualTextures{0u};
 };
 
+// the textures and factors one entry of LveModel::getMaterials() is drawn with
+struct MaterialComponent {
+  std::shared_ptr<LveTexture> albedoMap = nullptr;
+  std::shared_ptr<LveTexture> normalMap = nullptr;
+  // occlusion in R, roughness in G, metallic in B
+  std::shared_ptr<LveTexture> ormMap = nullptr;
+  glm::vec4 baseColorFactor{1.f};
+  float metallicFactor = 1.f;
+  float roughnessFactor = 1.f;
+};
+
+// factors of one draw, pbr.frag's MaterialBufferData
+struct MaterialBufferData {
+  glm::vec4 baseColorFactor{1.f};
+  // x: metallic, y: roughness
+  glm::vec4 factors{1.f};
+};
+
+class Camera;
 class GameObjectManager;  // forward declare game object manager class
 
 class GameObject {
@@ -50,6 +79,11 @@ class GameObject {
   id_t getId() { return id; }
 
   VkDescriptorBufferInfo getBufferInfo(int frameIndex);
+  // factors of materials[materialIndex], or all 1 when the object has no materials
+  VkDescriptorBufferInfo getMaterialBufferInfo(int frameIndex, size_t materialIndex);
+
+  // textures the loader has no file for use the manager's neutral defaults (white albedo, flat normal, ORM of 1)
+  void setMaterials(const AssetLoader &loader, const std::vector<AssetLoader::MaterialRequest> &requests);
 
   glm::vec3 color{};
   TransformComponent transform{};
@@ -61,10 +95,12 @@ class GameObject {
   // textures
   std::shared_ptr<LveTexture> diffuseMap = nullptr;
   std::shared_ptr<LveTexture> normalMap = nullptr;
-  std::shared_ptr<LveTexture> metallicMap = nullptr;
-  std::shared_ptr<LveTexture> roughnessMap = nullptr;
-
-  std::shared_ptr<LveTexture> envMap = nullptr;
+  // occlusion in R, roughness in G, metallic in B
+  std::shared_ptr<LveTexture> ormMap = nullptr;
+  // replaces diffuseMap when set, pages stream in as the object is seen (VirtualTextureSystem)
+  std::shared_ptr<VirtualTexture> virtualAlbedo = nullptr;
+  // indexed by Submesh::materialIndex and replacing the maps above, empty draws every submesh with those maps
+  std::vector<MaterialComponent> materials{};
 
   std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
@@ -73,6 +109,8 @@ class GameObject {
 
   id_t id;
   const GameObjectManager &gameObjectManger;
+  // first slot of this object's materials in the material buffers, assigned by updateBuffer
+  uint32_t materialSlot = 0;
 
   friend class GameObjectManager;
 };
@@ -80,8 +118,9 @@ class GameObject {
 class GameObjectManager {
  public:
   static constexpr int MAX_GAME_OBJECTS = 1000;
+  static constexpr int MAX_MATERIAL_SLOTS = 4 * MAX_GAME_OBJECTS;
 
-  GameObjectManager(LveDevice &device);
+  GameObjectManager(LveDevice &device, AssetManager &assetManager);
   GameObjectManager(const GameObjectManager &) = delete;
   GameObjectManager &operator=(const GameObjectManager &) = delete;
   GameObjectManager(GameObjectManager &&) = delete;
@@ -94,9 +133,7 @@ class GameObjectManager {
 
     gameObject.diffuseMap = textureDefault;
     gameObject.normalMap = textureDefault;
-    gameObject.metallicMap = textureDefault;
-    gameObject.roughnessMap = textureDefault;
-    gameObject.envMap = textureDefault;
+    gameObject.ormMap = textureDefault;
 
     gameObjects.emplace(gameObjectId, std::move(gameObject));
     return gameObjects.at(gameObjectId);
@@ -110,14 +147,32 @@ class GameObjectManager {
     return uboBuffers[frameIndex]->descriptorInfoForIndex(gameObjectId);
   }
 
+  VkDescriptorBufferInfo getMaterialBufferInfo(int frameIndex, uint32_t slot) const {
+    return materialBuffers[frameIndex]->descriptorInfoForIndex(slot);
+  }
+
   void updateBuffer(int frameIndex);
 
+  // screen size estimate for texture streaming: every object's bounds are projected with camera,
+  // each of its textures is assumed to be mapped over the object once
+  void requestTextureLevels(TextureStreamer &streamer, const Camera &camera, float viewportHeight);
+
+  // repoints every game object (and the default texture) from reloaded assets to their replacements
+  void replaceAssets(const std::vector<AssetManager::Replacement> &replacements);
+
   GameObject::Map gameObjects{};
   std::vector<std::unique_ptr<LveBuffer>> uboBuffers{LveSwapChain::MAX_FRAMES_IN_FLIGHT};
+  // MaterialBufferData of every object's materials, one slot for an object without any
+  std::vector<std::unique_ptr<LveBuffer>> materialBuffers{LveSwapChain::MAX_FRAMES_IN_FLIGHT};
 
  private:
+  friend class GameObject;
+
   GameObject::id_t currentId = 0;
   std::shared_ptr<LveTexture> textureDefault;
+  // what a glTF material without the texture means: the factors alone
+  std::shared_ptr<LveTexture> whiteTexture;
+  std::shared_ptr<LveTexture> flatNormalTexture;
 };
 
 
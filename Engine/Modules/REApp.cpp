@@ -1,9 +1,11 @@
 #include "REApp.hpp"
 #include "EngineSystem/PBRRenderSystem.hpp"
+#include "EngineSystem/MeshletCullingSystem.hpp"
 //#include "EngineSystem/BasicRenderSystem.hpp"
 #include "EngineSystem/PointLightSystem.hpp"
 #include "GameFramework/Camera.hpp"
 #include "GameFramework/KeyboardMovementController.hpp"
+#include "Rendering/Vulkan/AssetLoader.hpp"
 #include "Rendering/Vulkan/Buffer.hpp"
 
 
@@ -37,6 +39,7 @@ namespace RenderingEngine
                                     .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
                                     .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
                                     .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 100)
+                                    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 400)
                                     .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
         std::cout << "Frame pool size: " << framePools.size() << "\n";
         for (int i = 0; i < framePools.size(); i++) {
@@ -52,33 +55,46 @@ namespace RenderingEngine
     void REApp::loadGameObjects()
     {
 
+        // every asset decodes on the pool at once, uploadAll then feeds them to the gpu in request order
+        AssetLoader loader{Device, threadPool, &assetManager, &textureStreamer};
+
         // load obj models
-        std::shared_ptr<LveModel> mModel = LveModel::createModelFromFile(Device, "E:/Projects/VulkanEngine/Assets/Models/cerberus.fbx");
+        LveModel::ImportOptions importOptions{};
+        importOptions.buildMeshlets = true;
+        importOptions.compactVertices = true;
+        auto cerberus = loader.requestModel("E:/Projects/VulkanEngine/Assets/Models/cerberus.fbx", importOptions);
+
+        // load model textures 
+        auto albedo = loader.requestTexture("E:/Projects/VulkanEngine/Assets/Textures/cerberus_A.png");
+        auto normal = loader.requestTexture(
+            "E:/Projects/VulkanEngine/Assets/Textures/cerberus_N.png", VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {}, MipFilter::NormalMap);
+        // roughness and metallic packed by TextureCooker (Assets/Textures/textures.cook.json), packed at load time until it ran
+        auto orm = loader.requestOrmTexture(
+            "E:/Projects/VulkanEngine/Assets/Cooked/cerberus_ORM.ktx2", "",
+            "E:/Projects/VulkanEngine/Assets/Textures/cerberus_R.png", "E:/Projects/VulkanEngine/Assets/Textures/cerberus_M.png");
+
+        loader.uploadAll();
+        // a model's material table (glTF) replaces the maps below, imports without one leave it empty
+        auto cerberusMaterials = loader.requestMaterials(cerberus);
+        loader.uploadAll();
+
         GameObject& gameObj = gameObjectManager.createGameObject();
-        gameObj.model = mModel;
+        gameObj.model = loader.getModel(cerberus);
         gameObj.color = {1.0f, 1.0f, 1.0f};
         gameObj.transform.translation = {0.0f, 0.0f, 0.0f};
         gameObj.transform.scale = {0.01f, 0.01f, 0.01f};
         gameObj.transform.rotation = {glm::pi<float>(), 0.0f, 0.0f};// .25 * glm::two_pi<float>();
-        
-        // load model textures 
-        std::shared_ptr<LveTexture> mAlbedo = LveTexture::createTextureFromFile(Device, "E:/Projects/VulkanEngine/Assets/Textures/cerberus_A.png");
-        gameObj.diffuseMap = mAlbedo;
-        std::shared_ptr<LveTexture> mNormal = LveTexture::createTextureFromFile(Device, "E:/Projects/VulkanEngine/Assets/Textures/cerberus_N.png");
-        gameObj.normalMap = mNormal;
-        std::shared_ptr<LveTexture> mRoughness = LveTexture::createTextureFromFile(Device, "E:/Projects/VulkanEngine/Assets/Textures/cerberus_R.png");
-        gameObj.roughnessMap = mRoughness;
-        std::shared_ptr<LveTexture> mMetallic = LveTexture::createTextureFromFile(Device, "E:/Projects/VulkanEngine/Assets/Textures/cerberus_M.png");
-        gameObj.metallicMap = mMetallic;
-
-        // load env map
-        //std::shared_ptr<LveTexture> mEnvMap = LveTexture::createTextureFromFile(Device, 
-                                                                 //               "E:/Projects/VulkanEngine/Assets/Textures/environment.hdr",
-                                                                //                 VK_FORMAT_R16G16B16A16_SFLOAT,
-                                                               //                  VK_IMAGE_VIEW_TYPE_CUBE,
-                                                                  //               VK_IMAGE_LAYOUT_GENERAL);
-        //gameObj.envMap = mEnvMap;    
-        
+        gameObj.diffuseMap = loader.getTexture(albedo);
+        gameObj.normalMap = loader.getTexture(normal);
+        gameObj.ormMap = loader.getTexture(orm);
+        gameObj.setMaterials(loader, cerberusMaterials);
+        assetManager.dumpStats();
+        textureStreamer.dumpStats();
+
+        // terrain sized textures are cooked to tiles ("virtual": true) and stream per page instead of per level
+        //gameObj.virtualAlbedo = virtualTextureSystem.load("E:/Projects/VulkanEngine/Assets/Cooked/terrain_albedo.vtex");
+
         //mModel = LveModel::createModelFromFile(Device, "E:/Projects/VulkanEngine/Assets/Models/skybox.obj");
         //GameObject& skyboxObj = gameObjectManager.createGameObject();
         //skyboxObj.model = mModel;
@@ -102,7 +118,8 @@ namespace RenderingEngine
                 Device,
                 sizeof(GlobalUbo),
                 1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                // transfer destination for irradiance coefficients projected on the gpu
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
             );
             uboBuffers[i]->map();
@@ -126,9 +143,14 @@ namespace RenderingEngine
         std::cout << "atom size: " << Device.properties.limits.nonCoherentAtomSize << "\n";
 
         //BasicRenderSystem basicRenderSystem{Device, Renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
-        PBRRenderSystem pbrRenderSystem{Device, Renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+        PBRRenderSystem pbrRenderSystem{
+            Device, Renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout(), virtualTextureSystem};
+
+        // load env map, its image based lighting is baked on the first launch and read from environment.hdr.reibl after
+        //pbrRenderSystem.loadEnvironment("E:/Projects/VulkanEngine/Assets/Textures/environment.hdr");
         
         PointLightSystem pointLightSystem{Device, Renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+        MeshletCullingSystem meshletCullingSystem{Device};
 
         Camera camera{};
         
@@ -141,6 +163,17 @@ namespace RenderingEngine
         while (!mWindow.shouldClose())
         {
             glfwPollEvents();
+
+            // hot reload: changed files decode on the pool, whatever finished is swapped in here between frames
+            std::vector<std::string> changedFiles = fileWatcher.poll();
+            if (!changedFiles.empty())
+            {
+                assetManager.reloadChanged(changedFiles, threadPool);
+                pbrRenderSystem.reloadShaders(changedFiles);
+                pointLightSystem.reloadShaders(changedFiles);
+                meshletCullingSystem.reloadShaders(changedFiles);
+            }
+            gameObjectManager.replaceAssets(assetManager.applyReloads());
             
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -154,10 +187,18 @@ namespace RenderingEngine
             
             //camera.setOrthographicProjection(-aspect, aspect, -1.0f, 1.0f, -1.0f, 1.0f);
             camera.setPerspectiveProjection(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+
+            // streamed textures follow the on-screen size, changes are applied before this frame records its descriptors
+            gameObjectManager.requestTextureLevels(textureStreamer, camera, static_cast<float>(mWindow.getExtent().height));
+            textureStreamer.update();
             
             if(auto commandBuffer = Renderer.beginFrame())
             {
                 int frameIndex = Renderer.getFrameIndex();
+                // the fence of this frame index was waited on in beginFrame, its descriptor sets are free again
+                framePools[frameIndex]->resetPool();
+                // pages this frame index asked for last time are read back, missing tiles start loading
+                virtualTextureSystem.update(frameIndex, commandBuffer);
                 FrameInfo frameInfo
                 {
                     frameIndex,
@@ -177,6 +218,7 @@ namespace RenderingEngine
                 ubo.ambientLightColor = {1.0f, 1.0f, 1.0f, 0.05f};
 
                 pointLightSystem.update(frameInfo, ubo);
+                pbrRenderSystem.update(ubo);
 
                 uboBuffers[frameIndex]->writeToBuffer(&ubo);
                 uboBuffers[frameIndex]->flush();
@@ -185,6 +227,10 @@ namespace RenderingEngine
                 // The render functions MUST not change a game objects transform data
                 gameObjectManager.updateBuffer(frameIndex);
 
+                // compute work has to be recorded before the render pass begins
+                meshletCullingSystem.cull(frameInfo);
+                pbrRenderSystem.recordEnvironmentProjection(frameInfo, uboBuffers[frameIndex]->getBuffer());
+
                 // render
                 Renderer.beginSwapChainRenderPass(commandBuffer);
                 // basicRenderSystem.renderGameObjects(frameInfo);
@@ -192,6 +238,7 @@ namespace RenderingEngine
                 pointLightSystem.render(frameInfo);
 
                 Renderer.endSwapChainRenderPass(commandBuffer);
+                virtualTextureSystem.recordFeedbackBarrier(commandBuffer);
                 Renderer.endFrame();
             }
         }
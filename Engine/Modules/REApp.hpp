@@ -1,9 +1,14 @@
 #pragma once
 
 #include "Window/REWindow.hpp"
+#include "Rendering/Vulkan/AssetManager.hpp"
 #include "Rendering/Vulkan/Descriptors.hpp"
 #include "Rendering/Vulkan/Device.hpp"
+#include "Rendering/Vulkan/FileWatcher.hpp"
 #include "Rendering/Vulkan/Renderer.hpp"
+#include "Rendering/Vulkan/TextureStreamer.hpp"
+#include "Rendering/Vulkan/ThreadPool.hpp"
+#include "Rendering/Vulkan/VirtualTextureSystem.hpp"
 #include "GameFramework/GameObject.hpp"
 
 
@@ -34,11 +39,17 @@ namespace RenderingEngine
         Window mWindow{WIDTH,HEIGHT,"RE APP"};
         LveDevice Device{mWindow};
         LveRenderer Renderer{mWindow,Device};
+        ThreadPool threadPool{};
+        TextureStreamer textureStreamer{Device, threadPool};
+        VirtualTextureSystem virtualTextureSystem{Device, threadPool};
+        AssetManager assetManager{Device, &textureStreamer};
+        // hot reload sources: edited assets and recompiled SPIR-V
+        FileWatcher fileWatcher{{"E:/Projects/VulkanEngine/Assets", "E:/Projects/VulkanEngine/build/ShaderBin"}};
 
         // note: order of declarations matters
         std::unique_ptr<LveDescriptorPool> globalPool{};
         std::vector<std::unique_ptr<LveDescriptorPool>> framePools;
-        GameObjectManager gameObjectManager{Device};
+        GameObjectManager gameObjectManager{Device, assetManager};
     };
 
 }
\ No newline at end of file
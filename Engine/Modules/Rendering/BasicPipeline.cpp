@@ -1,7 +1,9 @@
 ﻿#include "BasicPipeline.hpp"
+#include "Vulkan/FileWatcher.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cassert>
 
 namespace RenderingEngine
@@ -9,6 +11,14 @@ namespace RenderingEngine
     BasicPipeline::BasicPipeline(LveDevice &device, const std::string vertPath, const std::string fragPath, const PipelineConfigInfo &configInfo)
     : mDevice(device){
         createGraphicsPipeline(vertPath, fragPath, configInfo);
+        shaderPaths = {normalizePath(vertPath), normalizePath(fragPath)};
+    }
+
+    bool BasicPipeline::dependsOn(const std::vector<std::string>& changedFiles) const
+    {
+        return std::any_of(changedFiles.begin(), changedFiles.end(), [this](const std::string& file) {
+            return std::find(shaderPaths.begin(), shaderPaths.end(), file) != shaderPaths.end();
+        });
     }
     
     BasicPipeline::~BasicPipeline()
@@ -46,6 +46,8 @@ namespace RenderingEngine
         BasicPipeline& operator=(const BasicPipeline&) = delete;
         
         void bind(VkCommandBuffer commandBuffer);
+        // true if one of the changed files is a shader this pipeline was built from
+        bool dependsOn(const std::vector<std::string>& changedFiles) const;
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
         static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
@@ -60,5 +62,6 @@ namespace RenderingEngine
         VkPipeline graphicsPipeline;
         VkShaderModule vertShaderModule;
         VkShaderModule fragShaderModule;
+        std::vector<std::string> shaderPaths;
     };
 }
\ No newline at end of file
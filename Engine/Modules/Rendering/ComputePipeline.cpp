@@ -1,4 +1,6 @@
 ﻿#include "ComputePipeline.hpp"  
+#include "Vulkan/FileWatcher.hpp"
+#include <algorithm>
 #include <fstream>  
 #include <stdexcept>  
 #include <iostream>  
@@ -12,8 +14,14 @@ namespace RenderingEngine
         : mDevice{device}  
     {  
         createComputePipeline(computeShaderPath, configInfo);  
+        shaderPath = normalizePath(computeShaderPath);
     }  
 
+    bool ComputePipeline::dependsOn(const std::vector<std::string>& changedFiles) const
+    {
+        return std::find(changedFiles.begin(), changedFiles.end(), shaderPath) != changedFiles.end();
+    }
+
     ComputePipeline::~ComputePipeline()  
     {  
         vkDestroyShaderModule(mDevice.device(), computeShaderModule, nullptr);  
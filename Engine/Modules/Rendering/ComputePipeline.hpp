@@ -31,6 +31,8 @@ namespace RenderingEngine
         ComputePipeline& operator=(const ComputePipeline&) = delete;
         
         void bind(VkCommandBuffer commandBuffer);
+        // true if the compute shader is one of the changed files
+        bool dependsOn(const std::vector<std::string>& changedFiles) const;
 
         static void defaultPipelineConfigInfo(ComputePipelineConfigInfo& configInfo);
         void dispatch(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ); 
@@ -45,5 +47,6 @@ namespace RenderingEngine
         LveDevice& mDevice;
         VkPipeline computePipeline;
         VkShaderModule computeShaderModule;
+        std::string shaderPath;
     };
 }
\ No newline at end of file
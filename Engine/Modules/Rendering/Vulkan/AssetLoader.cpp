@@ -0,0 +1,266 @@
+#include "AssetLoader.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        // R of each source into one rgba8 image, the channels a missing source leaves get its fallback value
+        LveTexture::ImageData packOrm(const std::string (&paths)[3], const uint8_t (&fallbacks)[3])
+        {
+            LveTexture::ImageData sources[3];
+            uint32_t width = 0;
+            uint32_t height = 0;
+            for (int channel = 0; channel < 3; channel++)
+            {
+                if (paths[channel].empty()) continue;
+                sources[channel] = LveTexture::loadImageData(paths[channel]);
+                if (sources[channel].format != VK_FORMAT_UNDEFINED)
+                {
+                    throw std::runtime_error("orm sources must be 8 bit images: " + paths[channel]);
+                }
+                if (width != 0 && (sources[channel].width != width || sources[channel].height != height))
+                {
+                    throw std::runtime_error("orm sources differ in size: " + paths[channel]);
+                }
+                width = sources[channel].width;
+                height = sources[channel].height;
+            }
+            // no source at all is a single texel of the defaults
+            width = std::max(width, 1u);
+            height = std::max(height, 1u);
+
+            LveTexture::ImageData image{};
+            image.width = width;
+            image.height = height;
+            image.size = 4 * static_cast<VkDeviceSize>(width) * height;
+            image.pixels = std::shared_ptr<uint8_t>(new uint8_t[image.size], std::default_delete<uint8_t[]>());
+            uint8_t* out = image.pixels.get();
+            size_t pixelCount = static_cast<size_t>(width) * height;
+            for (size_t i = 0; i < pixelCount; i++)
+            {
+                for (int channel = 0; channel < 3; channel++)
+                {
+                    out[i * 4 + channel] = sources[channel].pixels ? sources[channel].pixels.get()[i * 4] : fallbacks[channel];
+                }
+                out[i * 4 + 3] = 255;
+            }
+            return image;
+        }
+    }
+
+    AssetLoader::AssetLoader(LveDevice& device, ThreadPool& threadPool, AssetManager* assetManager, TextureStreamer* textureStreamer)
+        : mDevice{device}, mThreadPool{threadPool}, mAssetManager{assetManager}, mTextureStreamer{textureStreamer} {}
+
+    AssetLoader::ModelRequest AssetLoader::requestModel(const std::string& filePath, const LveModel::ImportOptions& options)
+    {
+        auto key = std::make_pair(filePath, AssetManager::modelVariant(options));
+        auto it = modelIndices.find(key);
+        if (it != modelIndices.end()) return ModelRequest{it->second};
+
+        PendingModel pending{};
+        pending.filePath = filePath;
+        pending.options = options;
+        if (mAssetManager)
+        {
+            pending.model = mAssetManager->findModel(filePath, options);
+        }
+        if (!pending.model)
+        {
+            // large obj files are split across the pool too, the job parses its own share of the chunks
+            ThreadPool* threadPool = &mThreadPool;
+            pending.data = mThreadPool.submit(
+                [filePath, options, threadPool]() { return LveModel::loadMeshData(filePath, options, threadPool); });
+            uploads.push_back(Upload{true, models.size()});
+        }
+        models.push_back(std::move(pending));
+        modelIndices.emplace(std::move(key), models.size() - 1);
+        return ModelRequest{models.size() - 1};
+    }
+
+    AssetLoader::TextureRequest AssetLoader::requestTexture(
+        const std::string& filePath, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+        MipFilter mipFilter)
+    {
+        auto key = std::make_pair(filePath, AssetManager::textureVariant(format, viewType, layout, components, mipFilter));
+        auto it = textureIndices.find(key);
+        if (it != textureIndices.end()) return TextureRequest{it->second};
+
+        PendingTexture pending{};
+        pending.filePath = filePath;
+        pending.format = format;
+        pending.viewType = viewType;
+        pending.layout = layout;
+        pending.components = components;
+        pending.mipFilter = mipFilter;
+        if (mAssetManager)
+        {
+            pending.texture = mAssetManager->findTexture(filePath, format, viewType, layout, components, mipFilter);
+        }
+        if (!pending.texture)
+        {
+            // several views of one file (e.g. packed channels) decode it once
+            auto decode = imageDecodes.find(filePath);
+            if (decode == imageDecodes.end())
+            {
+                // decoded and converted into staging memory on the worker, uploadAll only records the copy
+                LveDevice* device = &mDevice;
+                auto data = mThreadPool.submit([filePath, device]() { return LveTexture::loadImageData(filePath, device); });
+                decode = imageDecodes.emplace(filePath, data.share()).first;
+            }
+            pending.data = decode->second;
+            uploads.push_back(Upload{false, textures.size()});
+        }
+        textures.push_back(std::move(pending));
+        textureIndices.emplace(std::move(key), textures.size() - 1);
+        return TextureRequest{textures.size() - 1};
+    }
+
+    AssetLoader::TextureRequest AssetLoader::requestOrmTexture(
+        const std::string& cookedPath, const std::string& occlusionPath, const std::string& roughnessPath,
+        const std::string& metallicPath)
+    {
+        std::error_code error;
+        if (std::filesystem::exists(cookedPath, error))
+        {
+            return requestTexture(cookedPath);
+        }
+
+        // stands in for the cooked file under its path, so cooking it later hot reloads the real one
+        auto key = std::make_pair(cookedPath, AssetManager::textureVariant(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D,
+                                                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {}, MipFilter::Box));
+        auto it = textureIndices.find(key);
+        if (it != textureIndices.end()) return TextureRequest{it->second};
+
+        PendingTexture pending{};
+        pending.filePath = cookedPath;
+        pending.format = VK_FORMAT_R8G8B8A8_UNORM;
+        pending.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        pending.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        pending.components = {};
+        pending.mipFilter = MipFilter::Box;
+        if (mAssetManager)
+        {
+            pending.texture = mAssetManager->findTexture(
+                cookedPath, pending.format, pending.viewType, pending.layout, pending.components, pending.mipFilter);
+        }
+        if (!pending.texture)
+        {
+            std::cout << "No cooked " << cookedPath << ", packing its sources at load time" << std::endl;
+            std::string paths[3] = {occlusionPath, roughnessPath, metallicPath};
+            pending.data = mThreadPool.submit([paths]() { return packOrm(paths, {255, 255, 0}); }).share();
+            uploads.push_back(Upload{false, textures.size()});
+        }
+        textures.push_back(std::move(pending));
+        textureIndices.emplace(std::move(key), textures.size() - 1);
+        return TextureRequest{textures.size() - 1};
+    }
+
+    AssetLoader::MaterialRequest AssetLoader::requestMaterial(const LveModel::Material& material)
+    {
+        MaterialRequest request{{NO_TEXTURE}, {NO_TEXTURE}, {NO_TEXTURE}};
+        request.baseColorFactor = material.baseColorFactor;
+        request.metallicFactor = material.metallicFactor;
+        request.roughnessFactor = material.roughnessFactor;
+        if (!material.albedoTexture.empty())
+        {
+            request.albedo = requestTexture(material.albedoTexture);
+        }
+        if (!material.normalTexture.empty())
+        {
+            request.normal = requestTexture(
+                material.normalTexture, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {},
+                MipFilter::NormalMap);
+        }
+        if (!material.metallicRoughnessTexture.empty())
+        {
+            // a separate occlusion image would need repacking, the cooker's "orm" entries do that offline
+            VkComponentMapping orm{};
+            if (material.occlusionTexture != material.metallicRoughnessTexture)
+            {
+                orm.r = VK_COMPONENT_SWIZZLE_ONE;
+            }
+            request.orm = requestTexture(
+                material.metallicRoughnessTexture, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, orm);
+        }
+        return request;
+    }
+
+    std::vector<AssetLoader::MaterialRequest> AssetLoader::requestMaterials(ModelRequest model)
+    {
+        std::vector<MaterialRequest> requests;
+        for (const LveModel::Material& material : getModel(model)->getMaterials())
+        {
+            requests.push_back(requestMaterial(material));
+        }
+        return requests;
+    }
+
+    void AssetLoader::uploadAll()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t uploaded = 0;
+        for (; nextUpload < uploads.size(); nextUpload++, uploaded++)
+        {
+            const Upload& upload = uploads[nextUpload];
+            if (upload.isModel)
+            {
+                PendingModel& pending = models[upload.index];
+                std::unique_ptr<LveModel::MeshData> data = pending.data.get();
+                pending.model = std::make_shared<LveModel>(mDevice, data->view);
+                if (mAssetManager)
+                {
+                    pending.model = mAssetManager->addModel(pending.filePath, pending.options, pending.model);
+                }
+            }
+            else
+            {
+                PendingTexture& pending = textures[upload.index];
+                const LveTexture::ImageData& image = pending.data.get();
+                if (mTextureStreamer)
+                {
+                    pending.texture = mTextureStreamer->createTexture(
+                        image, pending.format, pending.viewType, pending.layout, pending.components, pending.mipFilter);
+                }
+                else
+                {
+                    pending.texture = std::make_shared<LveTexture>(
+                        mDevice, image, pending.format, pending.viewType, pending.layout, pending.components, pending.mipFilter);
+                }
+                if (mAssetManager)
+                {
+                    pending.texture = mAssetManager->addTexture(
+                        pending.filePath, pending.format, pending.viewType, pending.layout, pending.components, pending.mipFilter,
+                        pending.texture);
+                }
+                // drop our share of the pixels, the last view of a file frees them
+                pending.data = {};
+            }
+        }
+        imageDecodes.clear();
+        auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+            std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << "Uploaded " << uploaded << " assets in " << elapsed << " ms" << std::endl;
+    }
+
+    std::shared_ptr<LveModel> AssetLoader::getModel(ModelRequest request) const
+    {
+        assert(request.index < models.size() && models[request.index].model && "Model not uploaded yet");
+        return models[request.index].model;
+    }
+
+    std::shared_ptr<LveTexture> AssetLoader::getTexture(TextureRequest request) const
+    {
+        if (request.index == NO_TEXTURE) return nullptr;
+        assert(request.index < textures.size() && textures[request.index].texture && "Texture not uploaded yet");
+        return textures[request.index].texture;
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "AssetManager.hpp"
+#include "Device.hpp"
+#include "Model.hpp"
+#include "Texture.hpp"
+#include "TextureStreamer.hpp"
+#include "ThreadPool.hpp"
+
+// std
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*************************************************
+Batch loader for a level's assets
+request*  - queue the file, parsing / decoding starts right away on the worker pool, images decode into staging memory
+uploadAll - on the calling thread, wait for each request in order and create its gpu resources
+            so decoding of later assets overlaps the upload of earlier ones
+get*      - the uploaded asset, valid after uploadAll
+With an AssetManager, assets it already holds are not loaded again and every upload is handed to it.
+With a TextureStreamer, textures with a stored mip chain are created by it and start with only their mip tail resident.
+Repeated requests of one file share a single decode.
+A model's material table is only known once it is loaded, so materials are requested after a first uploadAll
+and picked up by the next one.
+*************************************************/
+namespace RenderingEngine
+{
+    class AssetLoader
+    {
+    public:
+        struct ModelRequest { size_t index; };
+        struct TextureRequest { size_t index; };
+        // the GameObject pbr bindings of one material, see GameObject::setMaterials
+        struct MaterialRequest
+        {
+            TextureRequest albedo;
+            TextureRequest normal;
+            // occlusion in R, roughness in G, metallic in B
+            TextureRequest orm;
+            glm::vec4 baseColorFactor{1.0f};
+            float metallicFactor = 1.0f;
+            float roughnessFactor = 1.0f;
+        };
+
+        static constexpr size_t NO_TEXTURE = SIZE_MAX;
+
+        AssetLoader(
+            LveDevice& device, ThreadPool& threadPool, AssetManager* assetManager = nullptr, TextureStreamer* textureStreamer = nullptr);
+
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        ModelRequest requestModel(const std::string& filePath, const LveModel::ImportOptions& options = {});
+        TextureRequest requestTexture(
+            const std::string& filePath,
+            VkFormat format = VK_FORMAT_R8G8B8A8_UNORM,
+            VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VkComponentMapping components = {},
+            MipFilter mipFilter = MipFilter::Box);
+        // the texture TextureCooker packs from occlusion, roughness and metallic ("orm" cook list entries) when cookedPath
+        // exists, otherwise the sources are packed on the pool the same way, an empty path gives the cooker's default
+        // (unoccluded, fully rough, dielectric); the packed image is uncompressed and has no stored mips
+        TextureRequest requestOrmTexture(
+            const std::string& cookedPath, const std::string& occlusionPath, const std::string& roughnessPath,
+            const std::string& metallicPath);
+        // normal maps get renormalized mips
+        // glTF's metallicRoughness image already has the ORM layout, it is bound once as is; unless the occlusion texture
+        // is that same image its R channel means nothing and the view reads it as 1
+        MaterialRequest requestMaterial(const LveModel::Material& material);
+        // every entry of an uploaded model's material table, in Submesh::materialIndex order
+        std::vector<MaterialRequest> requestMaterials(ModelRequest model);
+
+        // rethrows the first decode error
+        void uploadAll();
+
+        std::shared_ptr<LveModel> getModel(ModelRequest request) const;
+        // nullptr for NO_TEXTURE, the caller keeps its default texture
+        std::shared_ptr<LveTexture> getTexture(TextureRequest request) const;
+
+    private:
+        // models and textures already resident in the asset manager have no data to wait for
+        struct PendingModel
+        {
+            std::string filePath;
+            LveModel::ImportOptions options;
+            std::future<std::unique_ptr<LveModel::MeshData>> data;
+            std::shared_ptr<LveModel> model;
+        };
+        struct PendingTexture
+        {
+            std::string filePath;
+            std::shared_future<LveTexture::ImageData> data;
+            VkFormat format;
+            VkImageViewType viewType;
+            VkImageLayout layout;
+            VkComponentMapping components;
+            MipFilter mipFilter;
+            std::shared_ptr<LveTexture> texture;
+        };
+        // submission order across both kinds, uploadAll walks it front to back
+        struct Upload
+        {
+            bool isModel;
+            size_t index;
+        };
+
+        LveDevice& mDevice;
+        ThreadPool& mThreadPool;
+        AssetManager* mAssetManager;
+        TextureStreamer* mTextureStreamer;
+        std::vector<PendingModel> models;
+        std::vector<PendingTexture> textures;
+        std::vector<Upload> uploads;
+        size_t nextUpload = 0;
+
+        // (path, variant) of every request so far, and the decode of each image file
+        std::map<std::pair<std::string, uint64_t>, size_t> modelIndices;
+        std::map<std::pair<std::string, uint64_t>, size_t> textureIndices;
+        std::map<std::string, std::shared_future<LveTexture::ImageData>> imageDecodes;
+    };
+}
@@ -0,0 +1,310 @@
+#include "AssetManager.hpp"
+#include "FileWatcher.hpp"
+#include "MeshCache.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iomanip>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        uint64_t hashCombine(uint64_t hash, uint64_t value)
+        {
+            return hash ^ (value + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2));
+        }
+
+        double toMiB(VkDeviceSize size)
+        {
+            return static_cast<double>(size) / (1024.0 * 1024.0);
+        }
+    }
+
+    size_t AssetManager::KeyHash::operator()(const Key& key) const
+    {
+        return static_cast<size_t>(hashCombine(hashCombine(key.path, key.isModel), key.variant));
+    }
+
+    AssetManager::AssetManager(LveDevice& device, TextureStreamer* textureStreamer, VkDeviceSize budget)
+        : mDevice{device}, mTextureStreamer{textureStreamer}, mBudget{budget} {}
+
+    AssetManager::AssetId AssetManager::intern(const std::string& path)
+    {
+        // "Assets/a/../b.png" and "Assets/b.png" are the same file
+        std::string normalized = normalizePath(path);
+
+        auto it = pathIds.find(normalized);
+        if (it != pathIds.end()) return it->second;
+
+        AssetId id = static_cast<AssetId>(paths.size());
+        paths.push_back(normalized);
+        pathIds.emplace(std::move(normalized), id);
+        return id;
+    }
+
+    uint64_t AssetManager::modelVariant(const LveModel::ImportOptions& options)
+    {
+        return MeshCache::hashImportOptions(options);
+    }
+
+    uint64_t AssetManager::textureVariant(
+        VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components, MipFilter mipFilter)
+    {
+        uint64_t hash = hashCombine(0, static_cast<uint64_t>(format));
+        hash = hashCombine(hash, static_cast<uint64_t>(viewType));
+        hash = hashCombine(hash, static_cast<uint64_t>(layout));
+        hash = hashCombine(hash, static_cast<uint64_t>(components.r));
+        hash = hashCombine(hash, static_cast<uint64_t>(components.g));
+        hash = hashCombine(hash, static_cast<uint64_t>(components.b));
+        hash = hashCombine(hash, static_cast<uint64_t>(components.a));
+        return hashCombine(hash, static_cast<uint64_t>(mipFilter));
+    }
+
+    AssetManager::Entry* AssetManager::find(const Key& key)
+    {
+        auto it = lookup.find(key);
+        if (it == lookup.end())
+        {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        entries.splice(entries.begin(), entries, it->second);
+        return &entries.front();
+    }
+
+    AssetManager::Entry& AssetManager::insert(Entry entry)
+    {
+        // evict before the new entry joins the list: its handle has no other owner yet, evict would take it for unused
+        VkDeviceSize size = entry.memorySize();
+        evictUntil(mBudget > size ? mBudget - size : 0);
+        entries.push_front(std::move(entry));
+        lookup.emplace(entries.front().key, entries.begin());
+        return entries.front();
+    }
+
+    std::shared_ptr<LveTexture> AssetManager::createTexture(const LveTexture::ImageData& image, const Entry& settings)
+    {
+        if (mTextureStreamer)
+        {
+            return mTextureStreamer->createTexture(
+                image, settings.format, settings.viewType, settings.layout, settings.components, settings.mipFilter);
+        }
+        return std::make_shared<LveTexture>(
+            mDevice, image, settings.format, settings.viewType, settings.layout, settings.components, settings.mipFilter);
+    }
+
+    std::shared_ptr<LveModel> AssetManager::findModel(const std::string& path, const LveModel::ImportOptions& options)
+    {
+        Entry* entry = find(Key{intern(path), true, modelVariant(options)});
+        return entry ? entry->model : nullptr;
+    }
+
+    std::shared_ptr<LveTexture> AssetManager::findTexture(
+        const std::string& path, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+        MipFilter mipFilter)
+    {
+        Entry* entry = find(Key{intern(path), false, textureVariant(format, viewType, layout, components, mipFilter)});
+        return entry ? entry->texture : nullptr;
+    }
+
+    std::shared_ptr<LveModel> AssetManager::addModel(
+        const std::string& path, const LveModel::ImportOptions& options, std::shared_ptr<LveModel> model)
+    {
+        assert(model && "Adding a null model");
+        Key key{intern(path), true, modelVariant(options)};
+        auto it = lookup.find(key);
+        if (it != lookup.end()) return it->second->model;
+
+        Entry entry{key, std::move(model), nullptr};
+        entry.options = options;
+        return insert(std::move(entry)).model;
+    }
+
+    std::shared_ptr<LveTexture> AssetManager::addTexture(
+        const std::string& path, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+        MipFilter mipFilter, std::shared_ptr<LveTexture> texture)
+    {
+        assert(texture && "Adding a null texture");
+        Key key{intern(path), false, textureVariant(format, viewType, layout, components, mipFilter)};
+        auto it = lookup.find(key);
+        if (it != lookup.end()) return it->second->texture;
+
+        Entry entry{key, nullptr, std::move(texture)};
+        entry.format = format;
+        entry.viewType = viewType;
+        entry.layout = layout;
+        entry.components = components;
+        entry.mipFilter = mipFilter;
+        return insert(std::move(entry)).texture;
+    }
+
+    std::shared_ptr<LveModel> AssetManager::loadModel(const std::string& path, const LveModel::ImportOptions& options)
+    {
+        if (auto model = findModel(path, options)) return model;
+        std::shared_ptr<LveModel> model = LveModel::createModelFromFile(mDevice, path, options);
+        return addModel(path, options, std::move(model));
+    }
+
+    std::shared_ptr<LveTexture> AssetManager::loadTexture(
+        const std::string& path, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+        MipFilter mipFilter)
+    {
+        if (auto texture = findTexture(path, format, viewType, layout, components, mipFilter)) return texture;
+        Entry settings{};
+        settings.format = format;
+        settings.viewType = viewType;
+        settings.layout = layout;
+        settings.components = components;
+        settings.mipFilter = mipFilter;
+        std::shared_ptr<LveTexture> texture = createTexture(LveTexture::loadImageData(path, &mDevice), settings);
+        return addTexture(path, format, viewType, layout, components, mipFilter, std::move(texture));
+    }
+
+    void AssetManager::setBudget(VkDeviceSize budget)
+    {
+        mBudget = budget;
+        evict();
+    }
+
+    VkDeviceSize AssetManager::getResidentSize() const
+    {
+        VkDeviceSize size = 0;
+        for (const Entry& entry : entries)
+        {
+            size += entry.memorySize();
+        }
+        return size;
+    }
+
+    void AssetManager::evict()
+    {
+        evictUntil(mBudget);
+    }
+
+    void AssetManager::evictUntil(VkDeviceSize targetSize)
+    {
+        std::vector<Entry> victims;
+        VkDeviceSize size = getResidentSize();
+        for (auto it = entries.end(); it != entries.begin() && size > targetSize;)
+        {
+            --it;
+            if (it->isReferenced()) continue;
+            size -= it->memorySize();
+            lookup.erase(it->key);
+            victims.push_back(std::move(*it));
+            it = entries.erase(it);
+        }
+        if (victims.empty()) return;
+
+        vkDeviceWaitIdle(mDevice.device());
+        evictions += victims.size();
+        // victims release their gpu resources here
+    }
+
+    void AssetManager::reloadChanged(const std::vector<std::string>& changedFiles, ThreadPool& threadPool)
+    {
+        for (const std::string& file : changedFiles)
+        {
+            auto id = pathIds.find(file);
+            if (id == pathIds.end()) continue;
+
+            for (const Entry& entry : entries)
+            {
+                if (entry.key.path != id->second) continue;
+                // a newer write supersedes a reload that is still decoding
+                reloads.erase(
+                    std::remove_if(reloads.begin(), reloads.end(), [&](const PendingReload& reload) { return reload.key == entry.key; }),
+                    reloads.end());
+
+                PendingReload reload{entry.key};
+                if (entry.model)
+                {
+                    LveModel::ImportOptions options = entry.options;
+                    ThreadPool* pool = &threadPool;
+                    reload.meshData =
+                        threadPool.submit([file, options, pool]() { return LveModel::loadMeshData(file, options, pool); });
+                }
+                else
+                {
+                    LveDevice* device = &mDevice;
+                    reload.imageData = threadPool.submit([file, device]() { return LveTexture::loadImageData(file, device); });
+                }
+                std::cout << "Reloading " << file << std::endl;
+                reloads.push_back(std::move(reload));
+            }
+        }
+    }
+
+    std::vector<AssetManager::Replacement> AssetManager::applyReloads()
+    {
+        std::vector<Replacement> replacements;
+        for (auto it = reloads.begin(); it != reloads.end();)
+        {
+            std::future_status status = it->meshData.valid() ? it->meshData.wait_for(std::chrono::seconds{0})
+                                                              : it->imageData.wait_for(std::chrono::seconds{0});
+            if (status != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            PendingReload reload = std::move(*it);
+            it = reloads.erase(it);
+
+            auto found = lookup.find(reload.key);
+            try
+            {
+                if (reload.meshData.valid())
+                {
+                    std::unique_ptr<LveModel::MeshData> data = reload.meshData.get();
+                    if (found == lookup.end()) continue; // evicted meanwhile
+                    Entry& entry = *found->second;
+                    auto model = std::make_shared<LveModel>(mDevice, data->view);
+                    replacements.push_back(Replacement{entry.model, model, nullptr, nullptr});
+                    entry.model = std::move(model);
+                }
+                else
+                {
+                    LveTexture::ImageData image = reload.imageData.get();
+                    if (found == lookup.end()) continue;
+                    Entry& entry = *found->second;
+                    // a stored chain is registered with the streamer again, the old texture's entry expires with it
+                    std::shared_ptr<LveTexture> texture = createTexture(image, entry);
+                    replacements.push_back(Replacement{nullptr, nullptr, entry.texture, texture});
+                    entry.texture = std::move(texture);
+                }
+                std::cout << "Reloaded " << paths[reload.key.path] << std::endl;
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Reload of " << paths[reload.key.path] << " failed, keeping the old asset: " << e.what() << std::endl;
+            }
+        }
+
+        // the replaced assets may still be read by a frame in flight once their holders let go
+        if (!replacements.empty())
+        {
+            vkDeviceWaitIdle(mDevice.device());
+        }
+        return replacements;
+    }
+
+    void AssetManager::dumpStats(std::ostream& out) const
+    {
+        out << "AssetManager: " << entries.size() << " assets, " << std::fixed << std::setprecision(2)
+            << toMiB(getResidentSize()) << " / " << toMiB(mBudget) << " MiB, " << hits << " hits, " << misses << " misses, "
+            << evictions << " evictions\n";
+        // most recently used first
+        for (const Entry& entry : entries)
+        {
+            long references = entry.model ? entry.model.use_count() - 1 : entry.texture.use_count() - 1;
+            out << "  " << (entry.key.isModel ? "model   " : "texture ") << std::setw(9) << toMiB(entry.memorySize()) << " MiB  refs "
+                << references << "  " << paths[entry.key.path] << "\n";
+        }
+        out << std::defaultfloat;
+    }
+}
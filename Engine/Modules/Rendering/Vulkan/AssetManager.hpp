@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Model.hpp"
+#include "Texture.hpp"
+#include "TextureStreamer.hpp"
+#include "ThreadPool.hpp"
+
+// std
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*************************************************
+Owner of every model and texture loaded from disk
+- paths are normalized and interned into AssetIds, the same file is only ever loaded once per settings
+  (import options for models, format / view / swizzle / mip filter for textures)
+- load* hands out shared handles, an asset stays resident while anything references it
+- once the resident size exceeds the budget, assets nobody references any more are evicted
+  least recently used first
+- reloadChanged re-imports assets whose source file changed on the thread pool, applyReloads swaps the
+  finished ones in at a frame boundary and reports old -> new so holders can repoint their handles
+- with a TextureStreamer, textures with a stored mip chain are created by it, on the first load as on a reload,
+  so an edited texture keeps streaming
+Not thread safe, use it from the thread that owns the device (AssetLoader does its decoding elsewhere).
+*************************************************/
+namespace RenderingEngine
+{
+    class AssetManager
+    {
+    public:
+        using AssetId = uint32_t;
+        static constexpr VkDeviceSize DEFAULT_BUDGET = 1024ull * 1024 * 1024;
+
+        explicit AssetManager(LveDevice& device, TextureStreamer* textureStreamer = nullptr, VkDeviceSize budget = DEFAULT_BUDGET);
+
+        AssetManager(const AssetManager&) = delete;
+        AssetManager& operator=(const AssetManager&) = delete;
+
+        AssetId intern(const std::string& path);
+        const std::string& getPath(AssetId id) const { return paths[id]; }
+
+        std::shared_ptr<LveModel> loadModel(const std::string& path, const LveModel::ImportOptions& options = {});
+        std::shared_ptr<LveTexture> loadTexture(
+            const std::string& path,
+            VkFormat format = VK_FORMAT_R8G8B8A8_UNORM,
+            VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VkComponentMapping components = {},
+            MipFilter mipFilter = MipFilter::Box);
+
+        // resident lookups without loading, nullptr on a miss
+        std::shared_ptr<LveModel> findModel(const std::string& path, const LveModel::ImportOptions& options);
+        std::shared_ptr<LveTexture> findTexture(
+            const std::string& path, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+            MipFilter mipFilter);
+
+        // adopt assets created elsewhere, returns the resident handle if the same asset was added first
+        std::shared_ptr<LveModel> addModel(const std::string& path, const LveModel::ImportOptions& options, std::shared_ptr<LveModel> model);
+        std::shared_ptr<LveTexture> addTexture(
+            const std::string& path, VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components,
+            MipFilter mipFilter, std::shared_ptr<LveTexture> texture);
+
+        // settings that make two loads of one file different assets
+        static uint64_t modelVariant(const LveModel::ImportOptions& options);
+        static uint64_t textureVariant(
+            VkFormat format, VkImageViewType viewType, VkImageLayout layout, VkComponentMapping components, MipFilter mipFilter);
+
+        void setBudget(VkDeviceSize budget);
+        VkDeviceSize getBudget() const { return mBudget; }
+        // sum of what every asset holds right now, streamed textures grow and shrink with their resident mips
+        VkDeviceSize getResidentSize() const;
+
+        // drops unreferenced assets, least recently used first, until the resident size fits the budget
+        // waits for the device before destroying anything, a frame in flight may still read them
+        void evict();
+
+        void dumpStats(std::ostream& out = std::cout) const;
+
+        struct Replacement
+        {
+            std::shared_ptr<LveModel> oldModel;
+            std::shared_ptr<LveModel> newModel;
+            std::shared_ptr<LveTexture> oldTexture;
+            std::shared_ptr<LveTexture> newTexture;
+        };
+
+        // changedFiles are normalized paths (FileWatcher::poll), files that are not resident assets are ignored
+        void reloadChanged(const std::vector<std::string>& changedFiles, ThreadPool& threadPool);
+        // uploads the reloads that finished decoding, waits for the device if anything was swapped
+        // a reload that failed keeps the old asset
+        std::vector<Replacement> applyReloads();
+
+    private:
+        struct Key
+        {
+            AssetId path;
+            bool isModel;
+            uint64_t variant;
+
+            bool operator==(const Key& other) const
+            {
+                return path == other.path && isModel == other.isModel && variant == other.variant;
+            }
+        };
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const;
+        };
+        struct Entry
+        {
+            Key key;
+            std::shared_ptr<LveModel> model;
+            std::shared_ptr<LveTexture> texture;
+
+            // what the asset was created with, a reload recreates it the same way
+            LveModel::ImportOptions options{};
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D;
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkComponentMapping components{};
+            MipFilter mipFilter = MipFilter::Box;
+
+            // the manager's own handle is always one of the references
+            bool isReferenced() const { return model ? model.use_count() > 1 : texture.use_count() > 1; }
+            // asked each time, the streamer reallocates a texture whenever its resident mips change
+            VkDeviceSize memorySize() const { return model ? model->getMemorySize() : texture->getMemorySize(); }
+        };
+
+        // moves a hit to the front of the lru list
+        Entry* find(const Key& key);
+        Entry& insert(Entry entry);
+        // evict() down to an arbitrary size, insert makes room for an entry that is not in the list yet
+        void evictUntil(VkDeviceSize targetSize);
+        // through the streamer if there is one, it falls back to a fully resident texture itself
+        std::shared_ptr<LveTexture> createTexture(const LveTexture::ImageData& image, const Entry& settings);
+
+        LveDevice& mDevice;
+        TextureStreamer* mTextureStreamer;
+        VkDeviceSize mBudget;
+
+        std::unordered_map<std::string, AssetId> pathIds;
+        std::vector<std::string> paths;
+
+        // most recently used first
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup;
+
+        struct PendingReload
+        {
+            Key key;
+            std::future<std::unique_ptr<LveModel::MeshData>> meshData;
+            std::future<LveTexture::ImageData> imageData;
+        };
+        std::vector<PendingReload> reloads;
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+}
@@ -0,0 +1,181 @@
+#include "AttachmentAllocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <numeric>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        // the only usages a transient image may have besides the transient bit
+        constexpr VkImageUsageFlags TRANSIENT_USAGES = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                       VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+        double toMiB(VkDeviceSize size)
+        {
+            return static_cast<double>(size) / (1024.0 * 1024.0);
+        }
+    }
+
+    AttachmentAllocator::AttachmentAllocator(LveDevice& device) : mDevice{device} {}
+
+    AttachmentAllocator::~AttachmentAllocator()
+    {
+        for (const Attachment& attachment : attachments)
+        {
+            vkDestroyImageView(mDevice.device(), attachment.view, nullptr);
+            vkDestroyImage(mDevice.device(), attachment.image, nullptr);
+        }
+        for (const Block& block : blocks)
+        {
+            vkFreeMemory(mDevice.device(), block.memory, nullptr);
+        }
+    }
+
+    uint32_t AttachmentAllocator::add(
+        VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t firstPass,
+        uint32_t lastPass, bool transient)
+    {
+        assert(!allocated && "Attachments are added before allocate");
+        assert(firstPass <= lastPass && "Pass range is inverted");
+        assert((!transient || (usage & ~TRANSIENT_USAGES) == 0) && "Transient attachments can't be sampled or copied");
+
+        Attachment attachment{format, extent, usage, aspect, firstPass, lastPass, transient};
+        attachments.push_back(attachment);
+        return static_cast<uint32_t>(attachments.size() - 1);
+    }
+
+    void AttachmentAllocator::allocate()
+    {
+        assert(!allocated && "allocate runs once");
+        allocated = true;
+
+        for (Attachment& attachment : attachments)
+        {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {attachment.extent.width, attachment.extent.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = attachment.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = attachment.usage | (attachment.transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if (vkCreateImage(mDevice.device(), &imageInfo, nullptr, &attachment.image) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create attachment image!");
+            }
+            vkGetImageMemoryRequirements(mDevice.device(), attachment.image, &attachment.requirements);
+
+            constexpr VkMemoryPropertyFlags lazy = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            VkMemoryPropertyFlags properties =
+                attachment.transient && mDevice.hasMemoryType(attachment.requirements.memoryTypeBits, lazy)
+                    ? lazy
+                    : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+            attachment.memoryTypeIndex = mDevice.findMemoryType(attachment.requirements.memoryTypeBits, properties);
+        }
+
+        // largest first, each goes into the first allocation of its memory type it doesn't overlap in time
+        std::vector<size_t> order(attachments.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return attachments[a].requirements.size > attachments[b].requirements.size;
+        });
+        for (size_t index : order)
+        {
+            Attachment& attachment = attachments[index];
+            auto block = std::find_if(blocks.begin(), blocks.end(), [&](const Block& candidate) {
+                return candidate.memoryTypeIndex == attachment.memoryTypeIndex && !overlaps(candidate, attachment);
+            });
+            if (block == blocks.end())
+            {
+                Block created{};
+                created.memoryTypeIndex = attachment.memoryTypeIndex;
+                created.lazy = attachment.transient &&
+                               mDevice.hasMemoryType(1u << attachment.memoryTypeIndex, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+                blocks.push_back(created);
+                block = blocks.end() - 1;
+            }
+            // sorted by size, the first attachment sets the size; alignment only matters past offset 0
+            block->size = std::max(block->size, attachment.requirements.size);
+            block->attachments.push_back(index);
+            attachment.block = static_cast<size_t>(block - blocks.begin());
+        }
+
+        for (Block& block : blocks)
+        {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = block.size;
+            allocInfo.memoryTypeIndex = block.memoryTypeIndex;
+            if (vkAllocateMemory(mDevice.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate attachment memory!");
+            }
+        }
+
+        for (Attachment& attachment : attachments)
+        {
+            if (vkBindImageMemory(mDevice.device(), attachment.image, blocks[attachment.block].memory, 0) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to bind attachment memory!");
+            }
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = attachment.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = attachment.format;
+            viewInfo.subresourceRange = {attachment.aspect, 0, 1, 0, 1};
+            if (vkCreateImageView(mDevice.device(), &viewInfo, nullptr, &attachment.view) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create attachment image view!");
+            }
+        }
+    }
+
+    bool AttachmentAllocator::overlaps(const Block& block, const Attachment& attachment) const
+    {
+        for (size_t index : block.attachments)
+        {
+            const Attachment& other = attachments[index];
+            if (attachment.firstPass <= other.lastPass && other.firstPass <= attachment.lastPass) return true;
+        }
+        return false;
+    }
+
+    VkDeviceSize AttachmentAllocator::getAllocatedSize() const
+    {
+        VkDeviceSize size = 0;
+        for (const Block& block : blocks) size += block.size;
+        return size;
+    }
+
+    VkDeviceSize AttachmentAllocator::getRequestedSize() const
+    {
+        VkDeviceSize size = 0;
+        for (const Attachment& attachment : attachments) size += attachment.requirements.size;
+        return size;
+    }
+
+    void AttachmentAllocator::dumpStats(std::ostream& out) const
+    {
+        VkDeviceSize lazySize = 0;
+        for (const Block& block : blocks)
+        {
+            if (block.lazy) lazySize += block.size;
+        }
+        out << "AttachmentAllocator: " << attachments.size() << " attachments in " << blocks.size() << " allocations, "
+            << std::fixed << std::setprecision(2) << toMiB(getAllocatedSize()) << " MiB (" << toMiB(getRequestedSize())
+            << " MiB unaliased), " << toMiB(lazySize) << " MiB lazily allocated\n"
+            << std::defaultfloat;
+    }
+}
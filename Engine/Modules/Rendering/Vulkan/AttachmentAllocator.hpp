@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Device.hpp"
+
+// std
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+/*************************************************
+Memory for the render targets of one frame
+- add declares an attachment with the passes of the frame its contents live through, [firstPass, lastPass]
+- transient attachments never leave their render pass (load op CLEAR / DONT_CARE, store op DONT_CARE): they get
+  VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and lazily allocated memory where the device has it, which tile based
+  gpus never back with real memory
+- allocate packs attachments whose pass ranges don't overlap into the same allocation, so memory follows the peak
+  of the frame instead of the sum of its targets; an aliased attachment holds garbage when its first pass starts,
+  its render pass must begin it from VK_IMAGE_LAYOUT_UNDEFINED
+Everything is created by allocate and lives until the allocator is destroyed, the owner recreates it with the
+swap chain. The passes of consecutive frames are ordered by the render pass's external dependency, not by this class.
+*************************************************/
+namespace RenderingEngine
+{
+    class AttachmentAllocator
+    {
+    public:
+        explicit AttachmentAllocator(LveDevice& device);
+        ~AttachmentAllocator();
+
+        AttachmentAllocator(const AttachmentAllocator&) = delete;
+        AttachmentAllocator& operator=(const AttachmentAllocator&) = delete;
+
+        // returns the index of the attachment, valid for image / view once allocate ran
+        uint32_t add(
+            VkFormat format, VkExtent2D extent, VkImageUsageFlags usage, VkImageAspectFlags aspect, uint32_t firstPass,
+            uint32_t lastPass, bool transient = true);
+        void allocate();
+
+        VkImage image(uint32_t index) const { return attachments[index].image; }
+        VkImageView view(uint32_t index) const { return attachments[index].view; }
+
+        // bytes allocated, and what one allocation per attachment would have taken
+        VkDeviceSize getAllocatedSize() const;
+        VkDeviceSize getRequestedSize() const;
+        void dumpStats(std::ostream& out = std::cout) const;
+
+    private:
+        struct Attachment
+        {
+            VkFormat format;
+            VkExtent2D extent;
+            VkImageUsageFlags usage;
+            VkImageAspectFlags aspect;
+            uint32_t firstPass;
+            uint32_t lastPass;
+            bool transient;
+
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkMemoryRequirements requirements{};
+            uint32_t memoryTypeIndex = 0;
+            size_t block = 0;
+        };
+        // one allocation, every attachment in it is bound at offset 0
+        struct Block
+        {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            uint32_t memoryTypeIndex = 0;
+            bool lazy = false;
+            std::vector<size_t> attachments;
+        };
+
+        bool overlaps(const Block& block, const Attachment& attachment) const;
+
+        LveDevice& mDevice;
+        std::vector<Attachment> attachments;
+        std::vector<Block> blocks;
+        bool allocated = false;
+    };
+}
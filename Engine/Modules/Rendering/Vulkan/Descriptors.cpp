@@ -23,17 +23,33 @@ LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
   return *this;
 }
 
+LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addImmutableSamplerBinding(
+    uint32_t binding,
+    VkShaderStageFlags stageFlags,
+    VkSampler sampler,
+    uint32_t count) {
+  addBinding(binding, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, stageFlags, count);
+  immutableSamplers[binding] = std::vector<VkSampler>(count, sampler);
+  return *this;
+}
+
 std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings);
+  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings, immutableSamplers);
 }
 
 // *************** Descriptor Set Layout *********************
 
 LveDescriptorSetLayout::LveDescriptorSetLayout(
-    LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-    : lveDevice{lveDevice}, bindings{bindings} {
+    LveDevice &lveDevice,
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    std::unordered_map<uint32_t, std::vector<VkSampler>> immutableSamplers)
+    : lveDevice{lveDevice}, bindings{bindings}, immutableSamplers{std::move(immutableSamplers)} {
+  for (auto &kv : this->immutableSamplers) {
+    this->bindings[kv.first].pImmutableSamplers = kv.second.data();
+  }
+
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
-  for (auto kv : bindings) {
+  for (auto kv : this->bindings) {
     setLayoutBindings.push_back(kv.second);
   }
 
@@ -20,15 +20,25 @@ class LveDescriptorSetLayout {
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
         uint32_t count = 1);
+    // combined image sampler whose sampler is baked into the layout, e.g. from LveDevice::getSampler
+    // the sampler of the image infos written to it is ignored
+    Builder &addImmutableSamplerBinding(
+        uint32_t binding,
+        VkShaderStageFlags stageFlags,
+        VkSampler sampler,
+        uint32_t count = 1);
     std::unique_ptr<LveDescriptorSetLayout> build() const;
 
    private:
     LveDevice &lveDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, std::vector<VkSampler>> immutableSamplers{};
   };
 
   LveDescriptorSetLayout(
-      LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      LveDevice &lveDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      std::unordered_map<uint32_t, std::vector<VkSampler>> immutableSamplers = {});
   ~LveDescriptorSetLayout();
   LveDescriptorSetLayout(const LveDescriptorSetLayout &) = delete;
   LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
@@ -39,6 +49,8 @@ class LveDescriptorSetLayout {
   LveDevice &lveDevice;
   VkDescriptorSetLayout descriptorSetLayout;
   std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+  // pImmutableSamplers of bindings points in here
+  std::unordered_map<uint32_t, std::vector<VkSampler>> immutableSamplers;
 
   friend class LveDescriptorWriter;
 };
@@ -1,6 +1,9 @@
 #include "Device.hpp"
+#include "MipGenerator.hpp"
 
 // std headers
+#include <array>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -57,6 +60,10 @@ LveDevice::LveDevice(Window &window) : window{window} {
 }
 
 LveDevice::~LveDevice() {
+  mipGenerator_.reset();
+  for (auto &kv : samplerCache_) {
+    vkDestroySampler(device_, kv.second, nullptr);
+  }
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -149,9 +156,17 @@ void LveDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  // optional, without it KTX2 textures in BCn formats are rejected at load
+  textureCompressionBC_ = supportedFeatures.textureCompressionBC == VK_TRUE;
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
   deviceFeatures.fillModeNonSolid = VK_TRUE;
+  // virtual texture feedback is written from pbr.frag
+  deviceFeatures.fragmentStoresAndAtomics = VK_TRUE;
+  deviceFeatures.textureCompressionBC = textureCompressionBC_ ? VK_TRUE : VK_FALSE;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -211,7 +226,7 @@ bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && supportedFeatures.fragmentStoresAndAtomics;
 }
 
 void LveDevice::populateDebugMessengerCreateInfo(
@@ -391,6 +406,94 @@ VkFormat LveDevice::findSupportedFormat(
   throw std::runtime_error("failed to find supported format!");
 }
 
+VkFormatProperties LveDevice::getFormatProperties(VkFormat format) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+  return props;
+}
+
+bool LveDevice::isFormatSupported(VkFormat format, VkFormatFeatureFlags features) {
+  if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK && !textureCompressionBC_) {
+    return false;
+  }
+  return (getFormatProperties(format).optimalTilingFeatures & features) == features;
+}
+
+MipGenerator &LveDevice::mipGenerator() {
+  if (!mipGenerator_) {
+    mipGenerator_ = std::make_unique<MipGenerator>(*this);
+  }
+  return *mipGenerator_;
+}
+
+namespace {
+// every field of the create info that selects a different sampler, floats by their bits
+std::array<uint32_t, 16> samplerKey(const VkSamplerCreateInfo &info) {
+  auto bits = [](float value) {
+    uint32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    return word;
+  };
+  return {
+      info.flags,
+      static_cast<uint32_t>(info.magFilter),
+      static_cast<uint32_t>(info.minFilter),
+      static_cast<uint32_t>(info.mipmapMode),
+      static_cast<uint32_t>(info.addressModeU),
+      static_cast<uint32_t>(info.addressModeV),
+      static_cast<uint32_t>(info.addressModeW),
+      bits(info.mipLodBias),
+      info.anisotropyEnable,
+      bits(info.maxAnisotropy),
+      info.compareEnable,
+      static_cast<uint32_t>(info.compareOp),
+      bits(info.minLod),
+      bits(info.maxLod),
+      static_cast<uint32_t>(info.borderColor),
+      info.unnormalizedCoordinates};
+}
+}  // namespace
+
+size_t LveDevice::SamplerInfoHash::operator()(const VkSamplerCreateInfo &info) const {
+  // fnv-1a over the key words
+  uint64_t hash = 14695981039346656037ull;
+  for (uint32_t word : samplerKey(info)) {
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  return static_cast<size_t>(hash);
+}
+
+bool LveDevice::SamplerInfoEqual::operator()(const VkSamplerCreateInfo &a, const VkSamplerCreateInfo &b) const {
+  return samplerKey(a) == samplerKey(b);
+}
+
+VkSampler LveDevice::getSampler(const VkSamplerCreateInfo &samplerInfo) {
+  assert(samplerInfo.pNext == nullptr && "Cached samplers can't have extension structs");
+  auto it = samplerCache_.find(samplerInfo);
+  if (it != samplerCache_.end()) {
+    return it->second;
+  }
+
+  VkSampler sampler;
+  if (vkCreateSampler(device_, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create sampler!");
+  }
+  samplerCache_.emplace(samplerInfo, sampler);
+  return sampler;
+}
+
+bool LveDevice::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return true;
+    }
+  }
+  return false;
+}
+
 uint32_t LveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
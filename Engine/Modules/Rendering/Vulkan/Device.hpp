@@ -3,11 +3,15 @@
 #include "../../Window/REWindow.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace RenderingEngine {
 
+class MipGenerator;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -47,9 +51,14 @@ class LveDevice {
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  // e.g. whether lazily allocated memory exists before asking findMemoryType for it
+  bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+  VkFormatProperties getFormatProperties(VkFormat format);
+  // optimal tiling features, block compressed formats also need the device feature that was enabled
+  bool isFormatSupported(VkFormat format, VkFormatFeatureFlags features);
 
   // Buffer Helper Functions
   void createBuffer(
@@ -72,6 +81,13 @@ class LveDevice {
 
   void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount);
 
+  // records texture mip chains into upload command buffers, created on first use
+  MipGenerator &mipGenerator();
+
+  // one sampler per distinct create info (pNext must be null), shared by every caller and usable as an
+  // immutable sampler, it lives as long as the device and must not be destroyed by the caller
+  VkSampler getSampler(const VkSamplerCreateInfo &samplerInfo);
+
   VkPhysicalDeviceProperties properties;
 
  private:
@@ -103,6 +119,17 @@ class LveDevice {
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
 
+  std::unique_ptr<MipGenerator> mipGenerator_;
+
+  struct SamplerInfoHash {
+    size_t operator()(const VkSamplerCreateInfo &info) const;
+  };
+  struct SamplerInfoEqual {
+    bool operator()(const VkSamplerCreateInfo &a, const VkSamplerCreateInfo &b) const;
+  };
+  std::unordered_map<VkSamplerCreateInfo, VkSampler, SamplerInfoHash, SamplerInfoEqual> samplerCache_;
+  bool textureCompressionBC_ = false;
+
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
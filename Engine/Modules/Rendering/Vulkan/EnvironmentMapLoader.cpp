@@ -0,0 +1,261 @@
+#include "EnvironmentMapLoader.hpp"
+#include "MipGenerator.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint32_t GROUP_SIZE = 8;
+        constexpr VkFormat CUBE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+        struct PushConstants
+        {
+            float equirectLod;
+        };
+
+        std::vector<char> readFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to open file: " + filename);
+            }
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), buffer.size());
+            return buffer;
+        }
+    }
+
+    EnvironmentMapLoader::EnvironmentMapLoader(LveDevice& device) : mDevice{device} {}
+
+    EnvironmentMapLoader::~EnvironmentMapLoader()
+    {
+        vkDestroyDescriptorPool(mDevice.device(), descriptorPool, nullptr);
+        vkDestroyPipeline(mDevice.device(), pipeline, nullptr);
+        vkDestroyShaderModule(mDevice.device(), shaderModule, nullptr);
+        vkDestroyPipelineLayout(mDevice.device(), pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice.device(), setLayout, nullptr);
+    }
+
+    std::shared_ptr<LveTexture> EnvironmentMapLoader::load(const std::string& filepath, uint32_t faceSize)
+    {
+        return createCube(LveTexture::loadImageData(filepath), faceSize);
+    }
+
+    std::shared_ptr<LveTexture> EnvironmentMapLoader::createCube(const LveTexture::ImageData& equirect, uint32_t faceSize)
+    {
+        if (equirect.layerCount != 1 || equirect.levelOffsets.size() > 1)
+        {
+            throw std::runtime_error("environment maps are single equirectangular images");
+        }
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            createPipeline();
+        }
+        if (faceSize == 0)
+        {
+            faceSize = std::max(equirect.width / 4, 1u);
+        }
+
+        // the source's own mips are what keeps the projection from aliasing when the faces are smaller,
+        // .hdr data carries its RGBA16F format, 8 bit images are taken as srgb color
+        LveTexture source{
+            mDevice, equirect, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {},
+            MipFilter::Box};
+
+        // wraps around horizontally, the poles clamp
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+        VkSampler sampler = mDevice.getSampler(samplerInfo);
+
+        uint32_t mipLevels =
+            mDevice.mipGenerator().supports(CUBE_FORMAT) ? MipGenerator::mipLevelCount(faceSize, faceSize) : 1;
+        auto cube = std::make_shared<LveTexture>(
+            mDevice, CUBE_FORMAT, VkExtent2D{faceSize, faceSize}, mipLevels, 6, VK_IMAGE_VIEW_TYPE_CUBE,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // the shader writes the faces of level 0 as array layers
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = cube->getImage();
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = CUBE_FORMAT;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+        VkImageView faceView;
+        if (vkCreateImageView(mDevice.device(), &viewInfo, nullptr, &faceView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create cube face view");
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+        VkDescriptorSet descriptorSet;
+        if (vkAllocateDescriptorSets(mDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS)
+        {
+            vkDestroyImageView(mDevice.device(), faceView, nullptr);
+            throw std::runtime_error("failed to allocate environment map descriptor set");
+        }
+
+        VkDescriptorImageInfo imageInfos[2]{
+            {sampler, source.getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+            {VK_NULL_HANDLE, faceView, VK_IMAGE_LAYOUT_GENERAL},
+        };
+        VkWriteDescriptorSet writes[2]{};
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = descriptorSet;
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].pImageInfo = &imageInfos[binding];
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        vkUpdateDescriptorSets(mDevice.device(), 2, writes, 0, nullptr);
+
+        // a cube texel spans (pi / 2) / faceSize radians at the face center, an equirect texel 2 pi / width
+        PushConstants push{};
+        push.equirectLod = std::max(std::log2(static_cast<float>(equirect.width) / (4.0f * faceSize)), 0.0f);
+
+        // projection, the cube's mip chain and the layout change go into one submission
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+
+        MipGenerator::imageBarrier(
+            commandBuffer, cube->getImage(), 0, 1, 6,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            0, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+        uint32_t groups = (faceSize + GROUP_SIZE - 1) / GROUP_SIZE;
+        vkCmdDispatch(commandBuffer, groups, groups, 6);
+
+        // MipGenerator expects every level as a transfer destination
+        MipGenerator::imageBarrier(
+            commandBuffer, cube->getImage(), 0, 1, 6,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        if (mipLevels > 1)
+        {
+            MipGenerator::imageBarrier(
+                commandBuffer, cube->getImage(), 1, mipLevels - 1, 6,
+                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            mDevice.mipGenerator().record(
+                commandBuffer, cube->getImage(), CUBE_FORMAT, {faceSize, faceSize}, mipLevels, 6, MipFilter::Box,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        else
+        {
+            MipGenerator::imageBarrier(
+                commandBuffer, cube->getImage(), 0, 1, 6,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
+        // waits for the queue, the source texture, the face view and the set are free after this
+        mDevice.endSingleTimeCommands(commandBuffer);
+        mDevice.mipGenerator().releaseTransientResources();
+        vkDestroyImageView(mDevice.device(), faceView, nullptr);
+        vkResetDescriptorPool(mDevice.device(), descriptorPool, 0);
+        return cube;
+    }
+
+    void EnvironmentMapLoader::createPipeline()
+    {
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 2;
+        layoutInfo.pBindings = bindings;
+        if (vkCreateDescriptorSetLayout(mDevice.device(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create environment map descriptor set layout");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstants);
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create environment map pipeline layout");
+        }
+
+        // one cube at a time, the pool is reset after each
+        VkDescriptorPoolSize poolSizes[2]{
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 2;
+        poolInfo.pPoolSizes = poolSizes;
+        if (vkCreateDescriptorPool(mDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create environment map descriptor pool");
+        }
+
+        std::vector<char> code = readFile(EQUIRECT_TO_CUBE_SHADER);
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = code.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        if (vkCreateShaderModule(mDevice.device(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shader module");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName = "main";
+        if (vkCreateComputePipelines(mDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create environment map compute pipeline");
+        }
+    }
+}
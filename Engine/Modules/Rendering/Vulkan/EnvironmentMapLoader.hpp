@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Texture.hpp"
+
+// std
+#include <memory>
+#include <string>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    Turns equirectangular HDR images into cube maps for image based lighting
+    - the image is decoded to RGBA16F on the CPU (LveTexture::loadImageData) and uploaded as a 2D texture with mips
+    - equirect_to_cube.comp samples it once per cube texel into the 6 layers of level 0, the equirect level
+      whose texel density matches the face is sampled so large sources don't alias
+    - the cube's mip chain is blitted from level 0
+    The result is an RGBA16F cube in SHADER_READ_ONLY_OPTIMAL, a quarter of the float32 equirect's size at the default
+    face size. Builds on the caller's thread and waits for the graphics queue, meant for load time.
+    *************************************************/
+    class EnvironmentMapLoader
+    {
+    public:
+        // part of the IBL bake key, the cube the bake starts from is made by it
+        static constexpr const char* EQUIRECT_TO_CUBE_SHADER = "E:/Projects/VulkanEngine/build/ShaderBin/equirect_to_cube.comp.spv";
+
+        explicit EnvironmentMapLoader(LveDevice& device);
+        ~EnvironmentMapLoader();
+
+        EnvironmentMapLoader(const EnvironmentMapLoader&) = delete;
+        EnvironmentMapLoader& operator=(const EnvironmentMapLoader&) = delete;
+
+        // faceSize 0 picks a quarter of the image width, the equirect's texel density around the equator
+        std::shared_ptr<LveTexture> load(const std::string& filepath, uint32_t faceSize = 0);
+        std::shared_ptr<LveTexture> createCube(const LveTexture::ImageData& equirect, uint32_t faceSize = 0);
+
+    private:
+        void createPipeline();
+
+        LveDevice& mDevice;
+
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    };
+}
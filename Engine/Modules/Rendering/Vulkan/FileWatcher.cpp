@@ -0,0 +1,188 @@
+#include "FileWatcher.hpp"
+
+// std
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        bool endsWith(const std::string& text, const char* suffix)
+        {
+            size_t length = std::char_traits<char>::length(suffix);
+            return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+        }
+    }
+
+    std::string normalizePath(const std::string& path)
+    {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return (error ? std::filesystem::path{path} : absolute).lexically_normal().generic_string();
+    }
+
+    FileWatcher::FileWatcher(const std::vector<std::string>& directories)
+    {
+        for (const std::string& directory : directories)
+        {
+            std::error_code error;
+            if (!std::filesystem::is_directory(directory, error))
+            {
+                std::cout << "FileWatcher: skipping missing directory " << directory << std::endl;
+                continue;
+            }
+            mDirectories.push_back(normalizePath(directory));
+        }
+
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0)
+        {
+            throw std::runtime_error("Failed to initialize inotify");
+        }
+        for (const std::string& directory : mDirectories)
+        {
+            addWatches(directory);
+        }
+#else
+        scan(false);
+#endif
+        thread = std::thread{[this]() { run(); }};
+    }
+
+    FileWatcher::~FileWatcher()
+    {
+        running = false;
+        thread.join();
+#ifdef __linux__
+        close(inotifyFd);
+#endif
+    }
+
+    std::vector<std::string> FileWatcher::poll()
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        std::vector<std::string> result{changed.begin(), changed.end()};
+        changed.clear();
+        return result;
+    }
+
+    void FileWatcher::record(const std::string& path)
+    {
+        // files we write ourselves while importing (mesh caches and their temporaries) are not sources
+        if (endsWith(path, ".tmp") || endsWith(path, ".remc"))
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        changed.insert(path);
+    }
+
+#ifdef __linux__
+    void FileWatcher::addWatches(const std::string& directory)
+    {
+        constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF;
+        int watch = inotify_add_watch(inotifyFd, directory.c_str(), mask);
+        if (watch >= 0)
+        {
+            watches[watch] = directory;
+        }
+
+        std::error_code error;
+        for (auto it = std::filesystem::directory_iterator{directory, error}; !error && it != std::filesystem::directory_iterator{};
+             it.increment(error))
+        {
+            if (it->is_directory(error))
+            {
+                addWatches(it->path().generic_string());
+            }
+        }
+    }
+
+    void FileWatcher::run()
+    {
+        // events are variable sized, aligned like the struct itself
+        alignas(inotify_event) char buffer[4096];
+        while (running)
+        {
+            pollfd descriptor{inotifyFd, POLLIN, 0};
+            if (::poll(&descriptor, 1, 100) <= 0) continue;
+
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* p = buffer; p < buffer + length;)
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    auto watch = watches.find(event->wd);
+                    if (watch == watches.end()) continue;
+                    if (event->mask & IN_IGNORED)
+                    {
+                        watches.erase(watch);
+                        continue;
+                    }
+                    if (event->len == 0) continue;
+
+                    std::string path = watch->second + "/" + event->name;
+                    if (event->mask & IN_ISDIR)
+                    {
+                        // new subdirectories are watched as well
+                        if (event->mask & (IN_CREATE | IN_MOVED_TO)) addWatches(path);
+                    }
+                    else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                    {
+                        record(path);
+                    }
+                }
+            }
+        }
+    }
+#else
+    void FileWatcher::scan(bool report)
+    {
+        for (const std::string& directory : mDirectories)
+        {
+            std::error_code error;
+            for (auto it = std::filesystem::recursive_directory_iterator{directory, error};
+                 !error && it != std::filesystem::recursive_directory_iterator{}; it.increment(error))
+            {
+                if (!it->is_regular_file(error)) continue;
+                auto time = it->last_write_time(error);
+                if (error) continue;
+
+                std::string path = it->path().generic_string();
+                auto known = timestamps.find(path);
+                if (known == timestamps.end() || known->second != time)
+                {
+                    timestamps[path] = time;
+                    if (report) record(path);
+                }
+            }
+        }
+    }
+
+    void FileWatcher::run()
+    {
+        while (running)
+        {
+            // sleep in short steps so the destructor does not wait a whole interval
+            for (int i = 0; i < 5 && running; i++)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+            }
+            scan(true);
+        }
+    }
+#endif
+}
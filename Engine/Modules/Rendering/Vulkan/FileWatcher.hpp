@@ -0,0 +1,65 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef __linux__
+#include <filesystem>
+#endif
+
+namespace RenderingEngine
+{
+    // absolute, lexically normal, forward slashes: the form watcher events and asset ids are compared in
+    std::string normalizePath(const std::string& path);
+
+    /*************************************************
+    Watches directory trees for files that were written
+    - Linux: inotify on every subdirectory, a file is reported once it is closed after writing or moved in,
+      so half written files never show up
+    - elsewhere: the tree is rescanned for newer modification times twice a second
+    The watching runs on its own thread, poll() hands the changes to the main thread.
+    *************************************************/
+    class FileWatcher
+    {
+    public:
+        explicit FileWatcher(const std::vector<std::string>& directories);
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // normalized paths of the files changed since the last call, each once
+        std::vector<std::string> poll();
+
+    private:
+        void run();
+        void record(const std::string& path);
+
+        std::vector<std::string> mDirectories;
+
+        std::mutex mutex;
+        std::set<std::string> changed;
+
+        std::atomic<bool> running{true};
+
+#ifdef __linux__
+        void addWatches(const std::string& directory);
+
+        int inotifyFd = -1;
+        std::unordered_map<int, std::string> watches;
+#else
+        void scan(bool report);
+
+        std::unordered_map<std::string, std::filesystem::file_time_type> timestamps;
+#endif
+
+        // last, it starts running once everything above is initialized
+        std::thread thread;
+    };
+}
@@ -0,0 +1,768 @@
+#include "GltfLoader.hpp"
+#include "Json.hpp"
+#include "MappedFile.hpp"
+
+// libs
+#include <glm/gtc/quaternion.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+        constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+        constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+        constexpr uint32_t COMPONENT_BYTE = 5120;
+        constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+        constexpr uint32_t COMPONENT_SHORT = 5122;
+        constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+        constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+        constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+        constexpr uint32_t MODE_TRIANGLES = 4;
+        // doubles hold every integer below this exactly
+        constexpr double MAX_EXACT_INTEGER = 9007199254740992.0;
+
+        struct GltfBuffer
+        {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+        };
+
+        struct GltfDocument
+        {
+            std::string path;
+            std::filesystem::path directory;
+            JsonValue json;
+            MappedFile file;
+            std::vector<std::unique_ptr<MappedFile>> externalFiles;
+            std::vector<std::vector<uint8_t>> decodedBuffers;
+            std::vector<GltfBuffer> buffers;
+        };
+
+        // strided window into a buffer, elements are componentCount values of componentType
+        struct AccessorView
+        {
+            const uint8_t* data = nullptr;
+            size_t count = 0;
+            size_t stride = 0;
+            uint32_t componentType = 0;
+            uint32_t componentCount = 0;
+            bool normalized = false;
+        };
+
+        [[noreturn]] void fail(const GltfDocument& document, const std::string& message)
+        {
+            throw std::runtime_error("Failed to load glTF " + document.path + ": " + message);
+        }
+
+        // an index, count or byte size: casting a negative, fractional or missing number would be undefined
+        size_t toSize(const GltfDocument& document, const JsonValue& value, const char* what, double fallback = -1.0)
+        {
+            double number = value.asNumber(fallback);
+            if (!(number >= 0.0 && number < MAX_EXACT_INTEGER) || number != std::floor(number))
+            {
+                fail(document, std::string{"invalid "} + what);
+            }
+            return static_cast<size_t>(number);
+        }
+
+        uint32_t readU32(const uint8_t* p)
+        {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        size_t componentSize(uint32_t componentType)
+        {
+            switch (componentType)
+            {
+                case COMPONENT_BYTE:
+                case COMPONENT_UNSIGNED_BYTE: return 1;
+                case COMPONENT_SHORT:
+                case COMPONENT_UNSIGNED_SHORT: return 2;
+                case COMPONENT_UNSIGNED_INT:
+                case COMPONENT_FLOAT: return 4;
+                default: return 0;
+            }
+        }
+
+        uint32_t componentCount(const std::string& type)
+        {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            if (type == "MAT2") return 4;
+            if (type == "MAT3") return 9;
+            if (type == "MAT4") return 16;
+            return 0;
+        }
+
+        std::string percentDecode(std::string_view uri)
+        {
+            std::string out;
+            for (size_t i = 0; i < uri.size(); i++)
+            {
+                if (uri[i] == '%' && i + 2 < uri.size())
+                {
+                    out += static_cast<char>(std::stoi(std::string{uri.substr(i + 1, 2)}, nullptr, 16));
+                    i += 2;
+                }
+                else
+                {
+                    out += uri[i];
+                }
+            }
+            return out;
+        }
+
+        bool isDataUri(const std::string& uri)
+        {
+            return uri.rfind("data:", 0) == 0;
+        }
+
+        std::vector<uint8_t> decodeDataUri(const GltfDocument& document, const std::string& uri)
+        {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos || uri.find(";base64") > comma)
+            {
+                fail(document, "only base64 data uris are supported");
+            }
+
+            auto decodeChar = [](char c) -> int {
+                if (c >= 'A' && c <= 'Z') return c - 'A';
+                if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+                if (c >= '0' && c <= '9') return c - '0' + 52;
+                if (c == '+') return 62;
+                if (c == '/') return 63;
+                return -1;
+            };
+
+            std::vector<uint8_t> out;
+            out.reserve((uri.size() - comma) * 3 / 4);
+            uint32_t bits = 0;
+            int bitCount = 0;
+            for (size_t i = comma + 1; i < uri.size(); i++)
+            {
+                int value = decodeChar(uri[i]);
+                if (value < 0) continue; // padding
+                bits = (bits << 6) | static_cast<uint32_t>(value);
+                bitCount += 6;
+                if (bitCount >= 8)
+                {
+                    bitCount -= 8;
+                    out.push_back(static_cast<uint8_t>(bits >> bitCount));
+                }
+            }
+            return out;
+        }
+
+        void loadDocument(GltfDocument& document)
+        {
+            document.file = MappedFile{document.path};
+            if (!document.file.isOpen())
+            {
+                fail(document, "cannot open file");
+            }
+            const uint8_t* data = document.file.data();
+            size_t size = document.file.size();
+
+            GltfBuffer binChunk{};
+            std::string_view jsonText;
+            if (size >= 12 && readU32(data) == GLB_MAGIC)
+            {
+                if (readU32(data + 4) != 2)
+                {
+                    fail(document, "unsupported GLB version");
+                }
+                size_t offset = 12;
+                while (offset + 8 <= size)
+                {
+                    uint32_t chunkLength = readU32(data + offset);
+                    uint32_t chunkType = readU32(data + offset + 4);
+                    offset += 8;
+                    if (chunkLength > size - offset)
+                    {
+                        fail(document, "truncated GLB chunk");
+                    }
+                    if (chunkType == GLB_CHUNK_JSON && jsonText.empty())
+                    {
+                        jsonText = std::string_view{reinterpret_cast<const char*>(data + offset), chunkLength};
+                    }
+                    else if (chunkType == GLB_CHUNK_BIN && binChunk.data == nullptr)
+                    {
+                        binChunk = GltfBuffer{data + offset, chunkLength};
+                    }
+                    // chunks are 4 byte aligned
+                    offset += (chunkLength + 3u) & ~3u;
+                }
+                if (jsonText.empty())
+                {
+                    fail(document, "GLB has no JSON chunk");
+                }
+            }
+            else
+            {
+                jsonText = std::string_view{reinterpret_cast<const char*>(data), size};
+            }
+            document.json = JsonValue::parse(jsonText);
+
+            const JsonValue& buffers = document.json["buffers"];
+            for (size_t i = 0; i < buffers.size(); i++)
+            {
+                const JsonValue& buffer = buffers[i];
+                size_t byteLength = toSize(document, buffer["byteLength"], "buffer byteLength");
+                GltfBuffer view{};
+                if (!buffer.has("uri"))
+                {
+                    // the GLB BIN chunk, read in place
+                    if (i != 0 || binChunk.data == nullptr)
+                    {
+                        fail(document, "buffer without uri outside of a GLB");
+                    }
+                    view = binChunk;
+                }
+                else if (isDataUri(buffer["uri"].asString()))
+                {
+                    document.decodedBuffers.push_back(decodeDataUri(document, buffer["uri"].asString()));
+                    view = GltfBuffer{document.decodedBuffers.back().data(), document.decodedBuffers.back().size()};
+                }
+                else
+                {
+                    auto path = document.directory / percentDecode(buffer["uri"].asString());
+                    document.externalFiles.push_back(std::make_unique<MappedFile>(path.string()));
+                    if (!document.externalFiles.back()->isOpen())
+                    {
+                        fail(document, "cannot open buffer " + path.string());
+                    }
+                    view = GltfBuffer{document.externalFiles.back()->data(), document.externalFiles.back()->size()};
+                }
+                if (view.size < byteLength)
+                {
+                    fail(document, "buffer " + std::to_string(i) + " is shorter than its byteLength");
+                }
+                document.buffers.push_back(view);
+            }
+        }
+
+        // bytes of a buffer view, bounds checked against its buffer
+        GltfBuffer bufferView(const GltfDocument& document, size_t index, size_t* byteStride = nullptr)
+        {
+            const JsonValue& view = document.json["bufferViews"][index];
+            if (!view.isObject())
+            {
+                fail(document, "invalid bufferView " + std::to_string(index));
+            }
+            size_t bufferIndex = toSize(document, view["buffer"], "bufferView buffer");
+            if (bufferIndex >= document.buffers.size())
+            {
+                fail(document, "invalid bufferView " + std::to_string(index));
+            }
+            const GltfBuffer& buffer = document.buffers[bufferIndex];
+            size_t offset = toSize(document, view["byteOffset"], "bufferView byteOffset", 0.0);
+            size_t length = toSize(document, view["byteLength"], "bufferView byteLength");
+            if (offset > buffer.size || length > buffer.size - offset)
+            {
+                fail(document, "bufferView " + std::to_string(index) + " is out of range");
+            }
+            if (byteStride)
+            {
+                *byteStride = toSize(document, view["byteStride"], "bufferView byteStride", 0.0);
+            }
+            return GltfBuffer{buffer.data + offset, length};
+        }
+
+        AccessorView accessor(const GltfDocument& document, const JsonValue& indexValue)
+        {
+            size_t index = toSize(document, indexValue, "accessor index");
+            const JsonValue& json = document.json["accessors"][index];
+            if (!json.isObject())
+            {
+                fail(document, "invalid accessor " + std::to_string(index));
+            }
+            if (json.has("sparse") || !json.has("bufferView"))
+            {
+                fail(document, "sparse accessors are not supported");
+            }
+
+            AccessorView view{};
+            view.count = toSize(document, json["count"], "accessor count");
+            // anything out of uint32 range is an unknown type below as well
+            view.componentType = static_cast<uint32_t>(std::min<size_t>(toSize(document, json["componentType"], "accessor componentType"), UINT32_MAX));
+            view.componentCount = componentCount(json["type"].asString());
+            view.normalized = json["normalized"].asBool();
+            size_t elementSize = componentSize(view.componentType) * view.componentCount;
+            if (elementSize == 0)
+            {
+                fail(document, "accessor " + std::to_string(index) + " has an unknown type");
+            }
+
+            size_t byteStride = 0;
+            GltfBuffer bytes = bufferView(document, toSize(document, json["bufferView"], "accessor bufferView"), &byteStride);
+            view.stride = byteStride != 0 ? byteStride : elementSize;
+            size_t offset = toSize(document, json["byteOffset"], "accessor byteOffset", 0.0);
+            if (view.count > 0 && (offset > bytes.size || (view.count - 1) * view.stride + elementSize > bytes.size - offset))
+            {
+                fail(document, "accessor " + std::to_string(index) + " is out of range");
+            }
+            view.data = bytes.data + offset;
+            return view;
+        }
+
+        // element i as floats, normalized integers are mapped to [0, 1] / [-1, 1], missing components are 0
+        void readFloats(const AccessorView& view, size_t i, float* out, uint32_t count)
+        {
+            const uint8_t* element = view.data + i * view.stride;
+            for (uint32_t c = 0; c < count; c++)
+            {
+                if (c >= view.componentCount)
+                {
+                    out[c] = 0.0f;
+                    continue;
+                }
+                switch (view.componentType)
+                {
+                    case COMPONENT_FLOAT:
+                        std::memcpy(&out[c], element + c * 4, 4);
+                        break;
+                    case COMPONENT_UNSIGNED_BYTE:
+                        out[c] = element[c] * (view.normalized ? 1.0f / 255.0f : 1.0f);
+                        break;
+                    case COMPONENT_BYTE:
+                    {
+                        float value = static_cast<float>(static_cast<int8_t>(element[c]));
+                        out[c] = view.normalized ? std::max(value / 127.0f, -1.0f) : value;
+                        break;
+                    }
+                    case COMPONENT_UNSIGNED_SHORT:
+                    {
+                        uint16_t value;
+                        std::memcpy(&value, element + c * 2, 2);
+                        out[c] = value * (view.normalized ? 1.0f / 65535.0f : 1.0f);
+                        break;
+                    }
+                    case COMPONENT_SHORT:
+                    {
+                        int16_t value;
+                        std::memcpy(&value, element + c * 2, 2);
+                        out[c] = view.normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+                        break;
+                    }
+                    case COMPONENT_UNSIGNED_INT:
+                    {
+                        uint32_t value;
+                        std::memcpy(&value, element + c * 4, 4);
+                        out[c] = static_cast<float>(value);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // copies a float vector attribute into one member of a run of vertices
+        // matching float accessors take the memcpy path, everything else is converted
+        template <size_t N>
+        void copyAttribute(const AccessorView& view, LveModel::Vertex* vertices, size_t memberOffset)
+        {
+            bool matches = view.componentType == COMPONENT_FLOAT && view.componentCount == N;
+            for (size_t i = 0; i < view.count; i++)
+            {
+                float* member = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(&vertices[i]) + memberOffset);
+                if (matches)
+                {
+                    std::memcpy(member, view.data + i * view.stride, N * sizeof(float));
+                }
+                else
+                {
+                    readFloats(view, i, member, N);
+                }
+            }
+        }
+
+        glm::mat4 localTransform(const JsonValue& node)
+        {
+            const JsonValue& matrix = node["matrix"];
+            if (matrix.size() == 16)
+            {
+                glm::mat4 result{1.0f};
+                for (int column = 0; column < 4; column++)
+                {
+                    for (int row = 0; row < 4; row++)
+                    {
+                        result[column][row] = static_cast<float>(matrix[column * 4 + row].asNumber());
+                    }
+                }
+                return result;
+            }
+
+            const JsonValue& t = node["translation"];
+            const JsonValue& r = node["rotation"];
+            const JsonValue& s = node["scale"];
+            glm::vec3 translation{t[0].asNumber(), t[1].asNumber(), t[2].asNumber()};
+            glm::quat rotation{
+                static_cast<float>(r[3].asNumber(1.0)), static_cast<float>(r[0].asNumber()),
+                static_cast<float>(r[1].asNumber()), static_cast<float>(r[2].asNumber())};
+            glm::vec3 scale{s[0].asNumber(1.0), s[1].asNumber(1.0), s[2].asNumber(1.0)};
+
+            glm::mat4 result = glm::mat4_cast(rotation);
+            result[0] *= scale.x;
+            result[1] *= scale.y;
+            result[2] *= scale.z;
+            result[3] = glm::vec4{translation, 1.0f};
+            return result;
+        }
+
+        struct DrawItem
+        {
+            glm::mat4 world;
+            const JsonValue* primitive;
+            uint32_t material;
+        };
+
+        void collectDrawItems(
+            const GltfDocument& document, size_t nodeIndex, const glm::mat4& parent, uint32_t defaultMaterial,
+            std::vector<DrawItem>& items, int depth)
+        {
+            const JsonValue& node = document.json["nodes"][nodeIndex];
+            if (!node.isObject() || depth > 64)
+            {
+                fail(document, "invalid node hierarchy");
+            }
+            glm::mat4 world = parent * localTransform(node);
+
+            if (node.has("mesh"))
+            {
+                const JsonValue& primitives = document.json["meshes"][toSize(document, node["mesh"], "node mesh")]["primitives"];
+                for (size_t p = 0; p < primitives.size(); p++)
+                {
+                    const JsonValue& primitive = primitives[p];
+                    if (toSize(document, primitive["mode"], "primitive mode", MODE_TRIANGLES) != MODE_TRIANGLES)
+                    {
+                        std::cout << "Skipping non triangle primitive in " << document.path << std::endl;
+                        continue;
+                    }
+                    size_t material = defaultMaterial;
+                    if (primitive.has("material"))
+                    {
+                        // defaultMaterial is the slot after the last material of the document
+                        material = toSize(document, primitive["material"], "primitive material");
+                        if (material >= defaultMaterial)
+                        {
+                            fail(document, "primitive references a missing material");
+                        }
+                    }
+                    items.push_back(DrawItem{world, &primitive, static_cast<uint32_t>(material)});
+                }
+            }
+
+            const JsonValue& children = node["children"];
+            for (size_t c = 0; c < children.size(); c++)
+            {
+                collectDrawItems(document, toSize(document, children[c], "node child"), world, defaultMaterial, items, depth + 1);
+            }
+        }
+
+        void appendPrimitive(const GltfDocument& document, const DrawItem& item, LveModel::Builder& builder)
+        {
+            const JsonValue& attributes = (*item.primitive)["attributes"];
+            if (!attributes.has("POSITION"))
+            {
+                fail(document, "primitive without POSITION");
+            }
+            AccessorView positions = accessor(document, attributes["POSITION"]);
+
+            size_t baseVertex = builder.vertices.size();
+            builder.vertices.resize(baseVertex + positions.count);
+            LveModel::Vertex* vertices = builder.vertices.data() + baseVertex;
+
+            copyAttribute<3>(positions, vertices, offsetof(LveModel::Vertex, position));
+            bool hasNormals = attributes.has("NORMAL");
+            if (hasNormals)
+            {
+                AccessorView normals = accessor(document, attributes["NORMAL"]);
+                if (normals.count != positions.count) fail(document, "NORMAL count mismatch");
+                copyAttribute<3>(normals, vertices, offsetof(LveModel::Vertex, normal));
+            }
+            if (attributes.has("TEXCOORD_0"))
+            {
+                AccessorView texcoords = accessor(document, attributes["TEXCOORD_0"]);
+                if (texcoords.count != positions.count) fail(document, "TEXCOORD_0 count mismatch");
+                copyAttribute<2>(texcoords, vertices, offsetof(LveModel::Vertex, uv));
+            }
+            if (attributes.has("TANGENT"))
+            {
+                AccessorView tangents = accessor(document, attributes["TANGENT"]);
+                if (tangents.count != positions.count) fail(document, "TANGENT count mismatch");
+                for (size_t i = 0; i < tangents.count; i++)
+                {
+                    float tangent[4];
+                    readFloats(tangents, i, tangent, 4);
+                    vertices[i].tangent = glm::vec3{tangent[0], tangent[1], tangent[2]};
+                    // w is the handedness of the tangent frame
+                    vertices[i].bitangent = glm::cross(vertices[i].normal, vertices[i].tangent) * (tangent[3] < 0.0f ? -1.0f : 1.0f);
+                }
+            }
+
+            // indices: uint32 accessors are copied as is, only rebased when this is not the first primitive
+            size_t firstIndex = builder.indices.size();
+            if (item.primitive->has("indices"))
+            {
+                AccessorView indices = accessor(document, (*item.primitive)["indices"]);
+                builder.indices.resize(firstIndex + indices.count);
+                uint32_t* out = builder.indices.data() + firstIndex;
+                if (indices.componentType == COMPONENT_UNSIGNED_INT && indices.stride == sizeof(uint32_t))
+                {
+                    std::memcpy(out, indices.data, indices.count * sizeof(uint32_t));
+                }
+                else
+                {
+                    for (size_t i = 0; i < indices.count; i++)
+                    {
+                        const uint8_t* element = indices.data + i * indices.stride;
+                        if (indices.componentType == COMPONENT_UNSIGNED_BYTE)
+                        {
+                            out[i] = element[0];
+                        }
+                        else if (indices.componentType == COMPONENT_UNSIGNED_SHORT)
+                        {
+                            uint16_t value;
+                            std::memcpy(&value, element, sizeof(value));
+                            out[i] = value;
+                        }
+                        else
+                        {
+                            std::memcpy(&out[i], element, sizeof(uint32_t));
+                        }
+                    }
+                }
+                for (size_t i = 0; i < indices.count; i++)
+                {
+                    if (out[i] >= positions.count) fail(document, "index out of range");
+                    out[i] += static_cast<uint32_t>(baseVertex);
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < positions.count; i++)
+                {
+                    builder.indices.push_back(static_cast<uint32_t>(baseVertex + i));
+                }
+            }
+            builder.indices.resize(firstIndex + (builder.indices.size() - firstIndex) / 3 * 3);
+
+            if (!hasNormals)
+            {
+                // smooth area weighted normals, the spec asks for flat ones but shared vertices would need splitting
+                for (size_t i = firstIndex; i + 2 < builder.indices.size(); i += 3)
+                {
+                    LveModel::Vertex& v0 = builder.vertices[builder.indices[i]];
+                    LveModel::Vertex& v1 = builder.vertices[builder.indices[i + 1]];
+                    LveModel::Vertex& v2 = builder.vertices[builder.indices[i + 2]];
+                    glm::vec3 n = glm::cross(v1.position - v0.position, v2.position - v0.position);
+                    v0.normal += n;
+                    v1.normal += n;
+                    v2.normal += n;
+                }
+                for (size_t i = 0; i < positions.count; i++)
+                {
+                    float length = glm::length(vertices[i].normal);
+                    vertices[i].normal = length > 0.0f ? vertices[i].normal / length : glm::vec3{0.0f, 1.0f, 0.0f};
+                }
+            }
+
+            // mirrored transforms flip the winding
+            if (glm::determinant(glm::mat3{item.world}) < 0.0f)
+            {
+                for (size_t i = firstIndex; i + 2 < builder.indices.size(); i += 3)
+                {
+                    std::swap(builder.indices[i + 1], builder.indices[i + 2]);
+                }
+            }
+
+            if (item.world != glm::mat4{1.0f})
+            {
+                glm::mat3 linear{item.world};
+                glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+                for (size_t i = 0; i < positions.count; i++)
+                {
+                    LveModel::Vertex& vertex = vertices[i];
+                    vertex.position = glm::vec3{item.world * glm::vec4{vertex.position, 1.0f}};
+                    vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+                    if (glm::dot(vertex.tangent, vertex.tangent) > 0.0f)
+                    {
+                        vertex.tangent = glm::normalize(linear * vertex.tangent);
+                        vertex.bitangent = glm::normalize(linear * vertex.bitangent);
+                    }
+                }
+            }
+        }
+
+        // resolves a texture index to a file, embedded images are extracted next to the model once
+        std::string texturePath(const GltfDocument& document, const JsonValue& textureInfo)
+        {
+            if (!textureInfo.has("index"))
+            {
+                return {};
+            }
+            const JsonValue& texture = document.json["textures"][toSize(document, textureInfo["index"], "texture index")];
+            if (!texture.has("source"))
+            {
+                return {};
+            }
+            size_t imageIndex = toSize(document, texture["source"], "texture source");
+            const JsonValue& image = document.json["images"][imageIndex];
+
+            if (image.has("uri") && !isDataUri(image["uri"].asString()))
+            {
+                return (document.directory / percentDecode(image["uri"].asString())).string();
+            }
+
+            std::vector<uint8_t> decoded;
+            GltfBuffer bytes{};
+            if (image.has("uri"))
+            {
+                decoded = decodeDataUri(document, image["uri"].asString());
+                bytes = GltfBuffer{decoded.data(), decoded.size()};
+            }
+            else if (image.has("bufferView"))
+            {
+                bytes = bufferView(document, toSize(document, image["bufferView"], "image bufferView"));
+            }
+            else
+            {
+                return {};
+            }
+
+            std::string mimeType = image["mimeType"].asString();
+            if (mimeType.empty() && image.has("uri"))
+            {
+                const std::string& uri = image["uri"].asString();
+                mimeType = uri.substr(5, uri.find(';') - 5);
+            }
+            std::string extension = mimeType == "image/jpeg" ? ".jpg" : ".png";
+            auto path = document.directory /
+                        (std::filesystem::path{document.path}.stem().string() + "_image" + std::to_string(imageIndex) + extension);
+
+            std::error_code error;
+            if (!std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) != bytes.size)
+            {
+                std::ofstream file{path, std::ios::binary | std::ios::trunc};
+                file.write(reinterpret_cast<const char*>(bytes.data), static_cast<std::streamsize>(bytes.size));
+                if (!file)
+                {
+                    std::cout << "Failed to extract embedded image " << path.string() << std::endl;
+                    return {};
+                }
+            }
+            return path.string();
+        }
+
+        LveModel::Material loadMaterial(const GltfDocument& document, const JsonValue& json)
+        {
+            LveModel::Material material{};
+            const JsonValue& pbr = json["pbrMetallicRoughness"];
+            const JsonValue& baseColor = pbr["baseColorFactor"];
+            if (baseColor.size() == 4)
+            {
+                material.baseColorFactor = glm::vec4{
+                    baseColor[0].asNumber(), baseColor[1].asNumber(), baseColor[2].asNumber(), baseColor[3].asNumber()};
+            }
+            material.metallicFactor = static_cast<float>(pbr["metallicFactor"].asNumber(1.0));
+            material.roughnessFactor = static_cast<float>(pbr["roughnessFactor"].asNumber(1.0));
+            material.albedoTexture = texturePath(document, pbr["baseColorTexture"]);
+            material.metallicRoughnessTexture = texturePath(document, pbr["metallicRoughnessTexture"]);
+            material.normalTexture = texturePath(document, json["normalTexture"]);
+            material.occlusionTexture = texturePath(document, json["occlusionTexture"]);
+            return material;
+        }
+    }
+
+    void parseGltfFile(const std::string& filePath, LveModel::Builder& builder)
+    {
+        GltfDocument document{};
+        document.path = filePath;
+        document.directory = std::filesystem::path{filePath}.parent_path();
+        loadDocument(document);
+
+        const JsonValue& json = document.json;
+        uint32_t materialCount = static_cast<uint32_t>(json["materials"].size());
+
+        // primitives without a material use an extra default material at the end of the table
+        std::vector<DrawItem> items;
+        const JsonValue& nodes = json["nodes"];
+        if (json["scenes"].size() > 0)
+        {
+            const JsonValue& scene = json["scenes"][toSize(document, json["scene"], "scene", 0.0)];
+            const JsonValue& roots = scene["nodes"];
+            for (size_t i = 0; i < roots.size(); i++)
+            {
+                collectDrawItems(document, toSize(document, roots[i], "scene node"), glm::mat4{1.0f}, materialCount, items, 0);
+            }
+        }
+        else
+        {
+            // no scene: every node that is nobody's child is a root
+            std::vector<bool> isChild(nodes.size(), false);
+            for (size_t n = 0; n < nodes.size(); n++)
+            {
+                const JsonValue& children = nodes[n]["children"];
+                for (size_t c = 0; c < children.size(); c++)
+                {
+                    size_t child = toSize(document, children[c], "node child");
+                    if (child < isChild.size()) isChild[child] = true;
+                }
+            }
+            for (size_t n = 0; n < nodes.size(); n++)
+            {
+                if (!isChild[n]) collectDrawItems(document, n, glm::mat4{1.0f}, materialCount, items, 0);
+            }
+        }
+
+        std::stable_sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.material < b.material; });
+
+        builder.vertices.clear();
+        builder.indices.clear();
+        builder.submeshes.clear();
+        builder.materials.clear();
+
+        for (const DrawItem& item : items)
+        {
+            uint32_t firstIndex = static_cast<uint32_t>(builder.indices.size());
+            appendPrimitive(document, item, builder);
+            uint32_t indexCount = static_cast<uint32_t>(builder.indices.size()) - firstIndex;
+
+            if (!builder.submeshes.empty() && builder.submeshes.back().materialIndex == item.material)
+            {
+                builder.submeshes.back().indexCount += indexCount;
+            }
+            else
+            {
+                builder.submeshes.push_back(LveModel::Submesh{firstIndex, indexCount, item.material});
+            }
+        }
+
+        for (uint32_t m = 0; m < materialCount; m++)
+        {
+            builder.materials.push_back(loadMaterial(document, json["materials"][m]));
+        }
+        if (!items.empty() && items.back().material == materialCount)
+        {
+            builder.materials.push_back(LveModel::Material{});
+        }
+    }
+}
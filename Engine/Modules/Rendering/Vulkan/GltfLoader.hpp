@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Model.hpp"
+
+// std
+#include <string>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    glTF 2.0 reader for .gltf (external or data uri buffers) and .glb files
+    - GLB binary chunks and external .bin files are read in place from the memory mapping
+    - accessors whose layout already matches ours (float vectors, uint32 indices) are copied without conversion,
+      normalized and narrower integer accessors are converted per element
+    - the default scene is flattened like assimp's PreTransformVertices, primitives are grouped into one
+      submesh per material and materials fill builder.materials
+    - images embedded in the GLB or in data uris are written once next to the model as <model>_image<N>.<ext>
+      so every texture is a plain file path afterwards
+    Sparse accessors and non triangle primitives are not supported.
+    *************************************************/
+    void parseGltfFile(const std::string& filePath, LveModel::Builder& builder);
+}
@@ -0,0 +1,493 @@
+#include "IBLBaker.hpp"
+#include "Buffer.hpp"
+#include "IBLCache.hpp"
+#include "MipGenerator.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        const char* STAGE_SHADERS[] = {
+            "E:/Projects/VulkanEngine/build/ShaderBin/spmap.comp.spv",
+            "E:/Projects/VulkanEngine/build/ShaderBin/specular_brdf.comp.spv",
+        };
+        // the LUT depends on nothing but its shader, one cache serves every environment
+        const char* BRDF_LUT_CACHE = "E:/Projects/VulkanEngine/build/ShaderBin/specular_brdf_lut.reibl";
+        // local sizes of the shaders above
+        constexpr uint32_t GROUP_SIZES[] = {8, 32};
+        constexpr VkFormat IBL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+        constexpr VkDeviceSize IBL_TEXEL_SIZE = 8;
+        // a set per specular level, a MAX_SPECULAR_SIZE chain has 9
+        constexpr uint32_t MAX_SETS = 16;
+
+        struct PushConstants
+        {
+            float roughness;
+        };
+
+        std::vector<char> readFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to open file: " + filename);
+            }
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), buffer.size());
+            return buffer;
+        }
+
+        VkImageView createLevelView(LveDevice& device, const LveTexture& texture, VkImageViewType viewType, uint32_t level)
+        {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = texture.getImage();
+            viewInfo.viewType = viewType;
+            viewInfo.format = texture.getFormat();
+            viewInfo.subresourceRange = {
+                VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, viewType == VK_IMAGE_VIEW_TYPE_CUBE ? 6u : 1u};
+            VkImageView view;
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &view) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create IBL storage view");
+            }
+            return view;
+        }
+    }
+
+    IBLBaker::IBLBaker(LveDevice& device, SHProjector& shProjector)
+        : mDevice{device}, mSHProjector{shProjector}, environmentLoader{device}
+    {
+    }
+
+    IBLBaker::~IBLBaker()
+    {
+        vkDestroyDescriptorPool(mDevice.device(), descriptorPool, nullptr);
+        for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            vkDestroyPipeline(mDevice.device(), pipelines[stage], nullptr);
+            vkDestroyShaderModule(mDevice.device(), shaderModules[stage], nullptr);
+        }
+        vkDestroyPipelineLayout(mDevice.device(), pipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice.device(), setLayout, nullptr);
+    }
+
+    IBLMaps IBLBaker::bake(const LveTexture& environment)
+    {
+        if (environment.getLayerCount() != 6 || environment.getImageLayout() != VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        {
+            throw std::runtime_error("image based lighting is baked from a sampled cube map");
+        }
+        if (pipelines[SPECULAR] == VK_NULL_HANDLE)
+        {
+            createPipelines();
+        }
+
+        IBLMaps maps{};
+        maps.brdfLut = getBrdfLut();
+        maps.irradianceSH = mSHProjector.project(environment);
+
+        // the specular filter picks the environment level whose texels match each sample's solid angle
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+        VkDescriptorImageInfo input{
+            mDevice.getSampler(samplerInfo), environment.getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+        // no point in filtering to more texels than the environment has
+        uint32_t specularSize = std::min(environment.getExtent().width, MAX_SPECULAR_SIZE);
+        uint32_t specularLevels = MipGenerator::mipLevelCount(specularSize, specularSize);
+        maps.specular = std::make_shared<LveTexture>(
+            mDevice, IBL_FORMAT, VkExtent2D{specularSize, specularSize}, specularLevels, 6, VK_IMAGE_VIEW_TYPE_CUBE,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // storage images are bound one level at a time
+        std::vector<VkImageView> views;
+        for (uint32_t level = 0; level < specularLevels; level++)
+        {
+            views.push_back(createLevelView(mDevice, *maps.specular, VK_IMAGE_VIEW_TYPE_CUBE, level));
+        }
+
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+
+        MipGenerator::imageBarrier(
+            commandBuffer, maps.specular->getImage(), 0, specularLevels, 6,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            0, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        for (uint32_t level = 0; level < specularLevels; level++)
+        {
+            // the last level is fully rough, a single level chain is a mirror
+            float roughness = specularLevels > 1 ? static_cast<float>(level) / (specularLevels - 1) : 0.0f;
+            dispatch(
+                commandBuffer, SPECULAR, allocateSet(input, views[level]), roughness,
+                std::max(specularSize >> level, 1u), 6);
+        }
+
+        MipGenerator::imageBarrier(
+            commandBuffer, maps.specular->getImage(), 0, specularLevels, 6,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        // waits for the queue, the views and sets are free after this
+        mDevice.endSingleTimeCommands(commandBuffer);
+        for (VkImageView view : views)
+        {
+            vkDestroyImageView(mDevice.device(), view, nullptr);
+        }
+        vkResetDescriptorPool(mDevice.device(), descriptorPool, 0);
+        return maps;
+    }
+
+    IBLMaps IBLBaker::bakeEmpty()
+    {
+        auto black = std::make_shared<LveTexture>(
+            mDevice, IBL_FORMAT, VkExtent2D{1, 1}, 1, 6, VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        MipGenerator::imageBarrier(
+            commandBuffer, black->getImage(), 0, 1, 6,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkClearColorValue clearColor{};
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6};
+        vkCmdClearColorImage(
+            commandBuffer, black->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+        MipGenerator::imageBarrier(
+            commandBuffer, black->getImage(), 0, 1, 6,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mDevice.endSingleTimeCommands(commandBuffer);
+
+        return IBLMaps{SHCoefficients{}, black, getBrdfLut()};
+    }
+
+    IBLMaps IBLBaker::load(const std::string& environmentPath, uint32_t faceSize)
+    {
+        // the maps depend on the source, the requested face size, the map sizes and what the bake shaders do
+        std::string cachePath = IBLCache::cachePathFor(environmentPath);
+        uint64_t sourceHash = IBLCache::hashFile(environmentPath);
+        uint64_t bakeKey = IBLCache::hashCombine(IBLCache::VERSION, faceSize);
+        bakeKey = IBLCache::hashCombine(bakeKey, SHProjector::MAX_FACE_SIZE);
+        bakeKey = IBLCache::hashCombine(bakeKey, MAX_SPECULAR_SIZE);
+        bakeKey = IBLCache::hashCombine(bakeKey, IBL_FORMAT);
+        bakeKey = IBLCache::hashCombine(bakeKey, IBLCache::hashFile(EnvironmentMapLoader::EQUIRECT_TO_CUBE_SHADER));
+        bakeKey = IBLCache::hashCombine(bakeKey, IBLCache::hashFile(SHProjector::PROJECT_SHADER));
+        bakeKey = IBLCache::hashCombine(bakeKey, IBLCache::hashFile(SHProjector::REDUCE_SHADER));
+        bakeKey = IBLCache::hashCombine(bakeKey, IBLCache::hashFile(STAGE_SHADERS[SPECULAR]));
+
+        IBLCache cache;
+        if (cache.open(cachePath, sourceHash, bakeKey) && cache.imageCount() == 2 &&
+            cache.image(1).size == sizeof(SHCoefficients))
+        {
+            IBLMaps maps{};
+            maps.specular = std::make_shared<LveTexture>(
+                mDevice, cache.image(0), IBL_FORMAT, VK_IMAGE_VIEW_TYPE_CUBE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VkComponentMapping{}, MipFilter::None);
+            std::memcpy(maps.irradianceSH.data(), cache.image(1).pixels.get(), sizeof(SHCoefficients));
+            maps.brdfLut = getBrdfLut();
+            return maps;
+        }
+
+        // the environment cube itself is only needed for the bake
+        IBLMaps maps = bake(*environmentLoader.load(environmentPath, faceSize));
+        // the coefficients are stored as a 9 x 1 float image
+        std::vector<LveTexture::ImageData> images = readBack({maps.specular.get()});
+        LveTexture::ImageData& sh = images.emplace_back();
+        sh.width = static_cast<uint32_t>(maps.irradianceSH.size());
+        sh.height = 1;
+        sh.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        sh.size = sizeof(SHCoefficients);
+        sh.pixels = std::shared_ptr<uint8_t>(new uint8_t[sh.size], std::default_delete<uint8_t[]>());
+        std::memcpy(sh.pixels.get(), maps.irradianceSH.data(), sizeof(SHCoefficients));
+        if (!IBLCache::write(cachePath, sourceHash, bakeKey, images))
+        {
+            std::cout << "Failed to write IBL cache: " << cachePath << std::endl;
+        }
+        return maps;
+    }
+
+    std::shared_ptr<LveTexture> IBLBaker::getBrdfLut()
+    {
+        if (brdfLut)
+        {
+            return brdfLut;
+        }
+
+        uint64_t shaderHash = IBLCache::hashFile(STAGE_SHADERS[BRDF_LUT]);
+        uint64_t lutKey = IBLCache::hashCombine(IBLCache::hashCombine(IBLCache::VERSION, BRDF_LUT_SIZE), IBL_FORMAT);
+        IBLCache cache;
+        if (cache.open(BRDF_LUT_CACHE, shaderHash, lutKey) && cache.imageCount() == 1)
+        {
+            brdfLut = std::make_shared<LveTexture>(
+                mDevice, cache.image(0), IBL_FORMAT, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VkComponentMapping{}, MipFilter::None);
+            return brdfLut;
+        }
+
+        brdfLut = bakeBrdfLut();
+        if (!IBLCache::write(BRDF_LUT_CACHE, shaderHash, lutKey, readBack({brdfLut.get()})))
+        {
+            std::cout << "Failed to write IBL cache: " << BRDF_LUT_CACHE << std::endl;
+        }
+        return brdfLut;
+    }
+
+    std::shared_ptr<LveTexture> IBLBaker::bakeBrdfLut()
+    {
+        if (pipelines[BRDF_LUT] == VK_NULL_HANDLE)
+        {
+            createPipelines();
+        }
+
+        auto lut = std::make_shared<LveTexture>(
+            mDevice, IBL_FORMAT, VkExtent2D{BRDF_LUT_SIZE, BRDF_LUT_SIZE}, 1, 1, VK_IMAGE_VIEW_TYPE_2D,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        // specular_brdf.comp only writes binding 1
+        VkDescriptorSet descriptorSet = allocateSet({}, lut->getImageView());
+
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        MipGenerator::imageBarrier(
+            commandBuffer, lut->getImage(), 0, 1, 1,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            0, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        dispatch(commandBuffer, BRDF_LUT, descriptorSet, 0.0f, BRDF_LUT_SIZE, 1);
+        MipGenerator::imageBarrier(
+            commandBuffer, lut->getImage(), 0, 1, 1,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mDevice.endSingleTimeCommands(commandBuffer);
+        vkResetDescriptorPool(mDevice.device(), descriptorPool, 0);
+        return lut;
+    }
+
+    std::vector<LveTexture::ImageData> IBLBaker::readBack(const std::vector<const LveTexture*>& textures)
+    {
+        std::vector<LveTexture::ImageData> images(textures.size());
+        VkDeviceSize totalSize = 0;
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            const LveTexture& texture = *textures[i];
+            LveTexture::ImageData& image = images[i];
+            image.width = texture.getExtent().width;
+            image.height = texture.getExtent().height;
+            image.format = texture.getFormat();
+            image.layerCount = texture.getLayerCount();
+            for (uint32_t level = 0; level < texture.getMipLevels(); level++)
+            {
+                VkDeviceSize levelSize = VkDeviceSize{std::max(image.width >> level, 1u)} *
+                                         std::max(image.height >> level, 1u) * image.layerCount * IBL_TEXEL_SIZE;
+                image.levelOffsets.push_back(image.size);
+                image.levelSizes.push_back(levelSize);
+                image.size += levelSize;
+            }
+            totalSize += image.size;
+        }
+
+        LveBuffer readbackBuffer{
+            mDevice, totalSize, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        readbackBuffer.map();
+
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        VkDeviceSize bufferOffset = 0;
+        for (size_t i = 0; i < textures.size(); i++)
+        {
+            const LveTexture& texture = *textures[i];
+            const LveTexture::ImageData& image = images[i];
+            uint32_t levels = texture.getMipLevels();
+
+            MipGenerator::imageBarrier(
+                commandBuffer, texture.getImage(), 0, levels, image.layerCount,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            std::vector<VkBufferImageCopy> regions;
+            for (uint32_t level = 0; level < levels; level++)
+            {
+                VkBufferImageCopy region{};
+                region.bufferOffset = bufferOffset + image.levelOffsets[level];
+                region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, image.layerCount};
+                region.imageExtent = {std::max(image.width >> level, 1u), std::max(image.height >> level, 1u), 1};
+                regions.push_back(region);
+            }
+            vkCmdCopyImageToBuffer(
+                commandBuffer, texture.getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.getBuffer(),
+                static_cast<uint32_t>(regions.size()), regions.data());
+            MipGenerator::imageBarrier(
+                commandBuffer, texture.getImage(), 0, levels, image.layerCount,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            bufferOffset += image.size;
+        }
+
+        VkMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0, nullptr, 0,
+            nullptr);
+        // waits for the queue, the copies are visible to the host after this
+        mDevice.endSingleTimeCommands(commandBuffer);
+
+        const uint8_t* mapped = static_cast<const uint8_t*>(readbackBuffer.getMappedMemory());
+        for (LveTexture::ImageData& image : images)
+        {
+            image.pixels = std::shared_ptr<uint8_t>(new uint8_t[image.size], std::default_delete<uint8_t[]>());
+            std::memcpy(image.pixels.get(), mapped, static_cast<size_t>(image.size));
+            mapped += image.size;
+        }
+        return images;
+    }
+
+    VkDescriptorSet IBLBaker::allocateSet(VkDescriptorImageInfo input, VkImageView output)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+        VkDescriptorSet descriptorSet;
+        if (vkAllocateDescriptorSets(mDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate IBL descriptor set");
+        }
+
+        VkDescriptorImageInfo imageInfos[2]{
+            input,
+            {VK_NULL_HANDLE, output, VK_IMAGE_LAYOUT_GENERAL},
+        };
+        VkWriteDescriptorSet writes[2]{};
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[binding].dstSet = descriptorSet;
+            writes[binding].dstBinding = binding;
+            writes[binding].descriptorCount = 1;
+            writes[binding].pImageInfo = &imageInfos[binding];
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        // a stage without an input never reads binding 0, it stays unwritten
+        uint32_t first = input.imageView == VK_NULL_HANDLE ? 1 : 0;
+        vkUpdateDescriptorSets(mDevice.device(), 2 - first, writes + first, 0, nullptr);
+        return descriptorSet;
+    }
+
+    void IBLBaker::dispatch(
+        VkCommandBuffer commandBuffer, Stage stage, VkDescriptorSet descriptorSet, float roughness, uint32_t size,
+        uint32_t layers)
+    {
+        PushConstants push{roughness};
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[stage]);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+        uint32_t groups = (size + GROUP_SIZES[stage] - 1) / GROUP_SIZES[stage];
+        vkCmdDispatch(commandBuffer, groups, groups, layers);
+    }
+
+    void IBLBaker::createPipelines()
+    {
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 2;
+        layoutInfo.pBindings = bindings;
+        if (vkCreateDescriptorSetLayout(mDevice.device(), &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create IBL descriptor set layout");
+        }
+
+        // only spmap.comp reads the roughness, the layout is shared by all three stages
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstants);
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create IBL pipeline layout");
+        }
+
+        // one bake at a time, the pool is reset after each
+        VkDescriptorPoolSize poolSizes[2]{
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SETS},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_SETS},
+        };
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = MAX_SETS;
+        poolInfo.poolSizeCount = 2;
+        poolInfo.pPoolSizes = poolSizes;
+        if (vkCreateDescriptorPool(mDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create IBL descriptor pool");
+        }
+
+        for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            std::vector<char> code = readFile(STAGE_SHADERS[stage]);
+            VkShaderModuleCreateInfo moduleInfo{};
+            moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            moduleInfo.codeSize = code.size();
+            moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+            if (vkCreateShaderModule(mDevice.device(), &moduleInfo, nullptr, &shaderModules[stage]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create shader module");
+            }
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.layout = pipelineLayout;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = shaderModules[stage];
+            pipelineInfo.stage.pName = "main";
+            if (vkCreateComputePipelines(mDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipelines[stage]) !=
+                VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create IBL compute pipeline");
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Device.hpp"
+#include "EnvironmentMapLoader.hpp"
+#include "SHProjector.hpp"
+#include "Texture.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    // what pbr.frag uses for image based lighting, the textures are RGBA16F in SHADER_READ_ONLY_OPTIMAL
+    struct IBLMaps
+    {
+        // diffuse, goes into GlobalUbo::irradianceSH
+        SHCoefficients irradianceSH{};
+        // level i is prefiltered for roughness i / (levels - 1)
+        std::shared_ptr<LveTexture> specular;
+        // split sum scale / bias indexed by (cosLo, roughness), the same for every environment
+        std::shared_ptr<LveTexture> brdfLut;
+    };
+
+    /*************************************************
+    Precomputes the image based lighting of an environment cube (see EnvironmentMapLoader) once, nothing runs per frame
+    - SHProjector: diffuse irradiance as L2 spherical harmonics
+    - spmap.comp: GGX prefiltered radiance, one dispatch per level of the specular cube's mip chain
+    - specular_brdf.comp: the split sum BRDF LUT, baked on first use and shared by every result
+    load reads the maps from an IBLCache next to the environment file when it matches, and writes one after
+    baking otherwise; the LUT has its own cache beside the shader binaries, it doesn't depend on the environment.
+    Bakes on the caller's thread and waits for the graphics queue, meant for load time or environment changes.
+    *************************************************/
+    class IBLBaker
+    {
+    public:
+        static constexpr uint32_t MAX_SPECULAR_SIZE = 256;
+        static constexpr uint32_t BRDF_LUT_SIZE = 256;
+
+        IBLBaker(LveDevice& device, SHProjector& shProjector);
+        ~IBLBaker();
+
+        IBLBaker(const IBLBaker&) = delete;
+        IBLBaker& operator=(const IBLBaker&) = delete;
+
+        // environment: a cube in SHADER_READ_ONLY_OPTIMAL, its mips are what the specular filter reads from
+        IBLMaps bake(const LveTexture& environment);
+        // no ambient light: zero coefficients and a black 1x1 specular cube
+        IBLMaps bakeEmpty();
+        // environmentPath: an equirectangular image, see EnvironmentMapLoader::load for faceSize;
+        // a cache hit skips decoding the image as well as the bake
+        IBLMaps load(const std::string& environmentPath, uint32_t faceSize = 0);
+
+    private:
+        enum Stage
+        {
+            SPECULAR,
+            BRDF_LUT,
+            STAGE_COUNT
+        };
+
+        void createPipelines();
+        std::shared_ptr<LveTexture> getBrdfLut();
+        std::shared_ptr<LveTexture> bakeBrdfLut();
+        // every level and layer of textures copied to the cpu, laid out the way IBLCache stores them
+        std::vector<LveTexture::ImageData> readBack(const std::vector<const LveTexture*>& textures);
+        VkDescriptorSet allocateSet(VkDescriptorImageInfo input, VkImageView output);
+        void dispatch(
+            VkCommandBuffer commandBuffer, Stage stage, VkDescriptorSet descriptorSet, float roughness, uint32_t size,
+            uint32_t layers);
+
+        LveDevice& mDevice;
+        SHProjector& mSHProjector;
+        EnvironmentMapLoader environmentLoader;
+
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        std::array<VkShaderModule, STAGE_COUNT> shaderModules{};
+        std::array<VkPipeline, STAGE_COUNT> pipelines{};
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+        std::shared_ptr<LveTexture> brdfLut;
+    };
+}
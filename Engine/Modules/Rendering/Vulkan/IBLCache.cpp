@@ -0,0 +1,215 @@
+#include "IBLCache.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint32_t MAX_LEVELS = 16;
+        // far beyond what a bake writes, keeps the level size arithmetic from overflowing
+        constexpr uint32_t MAX_DIMENSION = 1u << 16;
+        constexpr uint32_t MAX_LAYERS = 6;
+
+        struct IBLCacheHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t sourceHash;
+            uint64_t bakeKey;
+            uint32_t imageCount;
+            uint32_t reserved;
+        };
+
+        // level offsets are relative to dataOffset
+        struct IBLCacheImage
+        {
+            uint32_t vkFormat;
+            uint32_t width;
+            uint32_t height;
+            uint32_t layerCount;
+            uint32_t levelCount;
+            uint32_t reserved;
+            uint64_t dataOffset;
+            uint64_t dataSize;
+            uint64_t levelOffsets[MAX_LEVELS];
+            uint64_t levelSizes[MAX_LEVELS];
+        };
+
+        constexpr char MAGIC[4] = {'R', 'E', 'I', 'B'};
+        constexpr uint64_t BLOB_ALIGNMENT = 16;
+        constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+        constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+        uint64_t fnv1a(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+            }
+            return hash;
+        }
+
+        uint64_t alignUp(uint64_t value)
+        {
+            return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+        }
+
+        // the formats a bake writes, 0 for anything else
+        uint64_t texelSize(VkFormat format)
+        {
+            switch (format)
+            {
+            case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+            case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+            default: return 0;
+            }
+        }
+    }
+
+    std::string IBLCache::cachePathFor(const std::string& sourcePath)
+    {
+        return sourcePath + ".reibl";
+    }
+
+    uint64_t IBLCache::hashFile(const std::string& path)
+    {
+        MappedFile file{path};
+        if (!file.isOpen()) return 0;
+        uint64_t size = file.size();
+        return fnv1a(file.data(), file.size(), fnv1a(&size, sizeof(size)));
+    }
+
+    uint64_t IBLCache::hashCombine(uint64_t hash, uint64_t value)
+    {
+        return fnv1a(&value, sizeof(value), hash);
+    }
+
+    bool IBLCache::open(const std::string& cachePath, uint64_t sourceHash, uint64_t bakeKey)
+    {
+        mImages.clear();
+        mFile = std::make_shared<MappedFile>(cachePath);
+        if (!mFile->isOpen() || mFile->size() < sizeof(IBLCacheHeader)) return false;
+
+        IBLCacheHeader header;
+        std::memcpy(&header, mFile->data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.sourceHash != sourceHash || header.bakeKey != bakeKey)
+        {
+            return false;
+        }
+        if (uint64_t(header.imageCount) * sizeof(IBLCacheImage) > mFile->size() - sizeof(header)) return false;
+
+        auto fits = [&](uint64_t offset, uint64_t size) {
+            return offset <= mFile->size() && size <= mFile->size() - offset;
+        };
+        for (uint32_t i = 0; i < header.imageCount; i++)
+        {
+            IBLCacheImage entry;
+            std::memcpy(&entry, mFile->data() + sizeof(header) + i * sizeof(IBLCacheImage), sizeof(entry));
+            uint64_t texelBytes = texelSize(static_cast<VkFormat>(entry.vkFormat));
+            if (entry.levelCount == 0 || entry.levelCount > MAX_LEVELS || entry.layerCount == 0 ||
+                entry.layerCount > MAX_LAYERS || entry.width == 0 || entry.width > MAX_DIMENSION || entry.height == 0 ||
+                entry.height > MAX_DIMENSION || texelBytes == 0 || !fits(entry.dataOffset, entry.dataSize))
+            {
+                return false;
+            }
+
+            LveTexture::ImageData image{};
+            image.width = entry.width;
+            image.height = entry.height;
+            image.format = static_cast<VkFormat>(entry.vkFormat);
+            image.layerCount = entry.layerCount;
+            image.size = entry.dataSize;
+            for (uint32_t level = 0; level < entry.levelCount; level++)
+            {
+                // the upload copies as many bytes as the extent implies, whatever the table says
+                uint64_t expectedSize = uint64_t(std::max(entry.width >> level, 1u)) * std::max(entry.height >> level, 1u) *
+                                        entry.layerCount * texelBytes;
+                if (entry.levelSizes[level] != expectedSize || entry.levelOffsets[level] > entry.dataSize ||
+                    entry.levelSizes[level] > entry.dataSize - entry.levelOffsets[level])
+                {
+                    return false;
+                }
+                image.levelOffsets.push_back(entry.levelOffsets[level]);
+                image.levelSizes.push_back(entry.levelSizes[level]);
+            }
+            // the upload only reads the pixels, the mapping stays read only
+            image.pixels = std::shared_ptr<uint8_t>(mFile, const_cast<uint8_t*>(mFile->data() + entry.dataOffset));
+            mImages.push_back(std::move(image));
+        }
+        return true;
+    }
+
+    bool IBLCache::write(
+        const std::string& cachePath, uint64_t sourceHash, uint64_t bakeKey, const std::vector<LveTexture::ImageData>& images)
+    {
+        IBLCacheHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.bakeKey = bakeKey;
+        header.imageCount = static_cast<uint32_t>(images.size());
+
+        std::vector<IBLCacheImage> entries(images.size());
+        uint64_t offset = alignUp(sizeof(header) + entries.size() * sizeof(IBLCacheImage));
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            const LveTexture::ImageData& image = images[i];
+            IBLCacheImage& entry = entries[i];
+            if (image.levelOffsets.size() > MAX_LEVELS) return false;
+            entry.vkFormat = static_cast<uint32_t>(image.format);
+            entry.width = image.width;
+            entry.height = image.height;
+            entry.layerCount = image.layerCount;
+            entry.levelCount = std::max(static_cast<uint32_t>(image.levelOffsets.size()), 1u);
+            entry.dataOffset = offset;
+            entry.dataSize = image.size;
+            for (size_t level = 0; level < image.levelOffsets.size(); level++)
+            {
+                entry.levelOffsets[level] = image.levelOffsets[level];
+                entry.levelSizes[level] = image.levelSizes.size() > level ? image.levelSizes[level] : 0;
+            }
+            if (image.levelOffsets.empty())
+            {
+                entry.levelSizes[0] = image.size;
+            }
+            offset = alignUp(offset + image.size);
+        }
+
+        // write beside the final path and rename, a crash never leaves a half written cache behind
+        std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file) return false;
+
+            const char zeros[BLOB_ALIGNMENT] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(IBLCacheImage)));
+            uint64_t written = sizeof(header) + entries.size() * sizeof(IBLCacheImage);
+            for (size_t i = 0; i < images.size(); i++)
+            {
+                file.write(zeros, static_cast<std::streamsize>(entries[i].dataOffset - written));
+                file.write(reinterpret_cast<const char*>(images[i].pixels.get()), static_cast<std::streamsize>(images[i].size));
+                written = entries[i].dataOffset + images[i].size;
+            }
+            if (!file) return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "Texture.hpp"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*************************************************
+Binary cache of baked image based lighting (IBLBaker), written next to the environment as <source>.reibl
+header | image table | images, every image stored level 0 first with the layers of a level packed,
+the layout vkCmdCopyBufferToImage reads, so a cache hit is uploaded straight from the mapping
+A cache is only used if version, source hash and bake key all match; the bake key covers the map sizes
+and the SPIR-V of the bake shaders including equirect_to_cube, a changed shader invalidates every cache.
+*************************************************/
+namespace RenderingEngine
+{
+    class IBLCache
+    {
+    public:
+        static constexpr uint32_t VERSION = 2;
+
+        static std::string cachePathFor(const std::string& sourcePath);
+        // 0 if the file can't be read
+        static uint64_t hashFile(const std::string& path);
+        static uint64_t hashCombine(uint64_t hash, uint64_t value);
+
+        // returns false if the cache is missing, truncated, stale, or a level's size does not match its extent and format
+        bool open(const std::string& cachePath, uint64_t sourceHash, uint64_t bakeKey);
+        size_t imageCount() const { return mImages.size(); }
+        // pixels point into the mapping and keep it alive
+        const LveTexture::ImageData& image(size_t index) const { return mImages[index]; }
+
+        // images need their levelOffsets, a single level ones may leave them empty
+        static bool write(
+            const std::string& cachePath, uint64_t sourceHash, uint64_t bakeKey,
+            const std::vector<LveTexture::ImageData>& images);
+
+    private:
+        std::shared_ptr<MappedFile> mFile;
+        std::vector<LveTexture::ImageData> mImages;
+    };
+}
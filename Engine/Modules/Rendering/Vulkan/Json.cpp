@@ -0,0 +1,287 @@
+#include "Json.hpp"
+
+// std
+#include <charconv>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    class JsonValue::Parser
+    {
+    public:
+        explicit Parser(std::string_view text) : text{text} {}
+
+        JsonValue parseDocument()
+        {
+            JsonValue value = parseValue(0);
+            skipWhitespace();
+            if (position != text.size())
+            {
+                fail("trailing characters");
+            }
+            return value;
+        }
+
+    private:
+        // glTF nests a handful of levels, this only guards against hostile input
+        static constexpr int MAX_DEPTH = 256;
+
+        [[noreturn]] void fail(const char* message)
+        {
+            throw std::runtime_error(std::string{"JSON parse error at offset "} + std::to_string(position) + ": " + message);
+        }
+
+        void skipWhitespace()
+        {
+            while (position < text.size() &&
+                   (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+            {
+                position++;
+            }
+        }
+
+        bool consume(char c)
+        {
+            skipWhitespace();
+            if (position < text.size() && text[position] == c)
+            {
+                position++;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            if (!consume(c))
+            {
+                fail("unexpected character");
+            }
+        }
+
+        bool consumeLiteral(std::string_view literal)
+        {
+            if (text.substr(position, literal.size()) == literal)
+            {
+                position += literal.size();
+                return true;
+            }
+            return false;
+        }
+
+        JsonValue parseValue(int depth)
+        {
+            if (depth > MAX_DEPTH)
+            {
+                fail("nesting too deep");
+            }
+            skipWhitespace();
+            if (position >= text.size())
+            {
+                fail("unexpected end of input");
+            }
+
+            JsonValue value;
+            char c = text[position];
+            if (c == '{')
+            {
+                position++;
+                value.mType = Type::Object;
+                if (consume('}')) return value;
+                do
+                {
+                    skipWhitespace();
+                    std::string key = parseString();
+                    expect(':');
+                    value.mMembers.emplace_back(std::move(key), parseValue(depth + 1));
+                } while (consume(','));
+                expect('}');
+            }
+            else if (c == '[')
+            {
+                position++;
+                value.mType = Type::Array;
+                if (consume(']')) return value;
+                do
+                {
+                    value.mElements.push_back(parseValue(depth + 1));
+                } while (consume(','));
+                expect(']');
+            }
+            else if (c == '"')
+            {
+                value.mType = Type::String;
+                value.mString = parseString();
+            }
+            else if (consumeLiteral("true"))
+            {
+                value.mType = Type::Bool;
+                value.mBool = true;
+            }
+            else if (consumeLiteral("false"))
+            {
+                value.mType = Type::Bool;
+                value.mBool = false;
+            }
+            else if (consumeLiteral("null"))
+            {
+                value.mType = Type::Null;
+            }
+            else
+            {
+                value.mType = Type::Number;
+                const char* begin = text.data() + position;
+                const char* end = text.data() + text.size();
+                auto result = std::from_chars(begin, end, value.mNumber);
+                if (result.ec != std::errc{})
+                {
+                    fail("invalid value");
+                }
+                position += static_cast<size_t>(result.ptr - begin);
+            }
+            return value;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t codepoint)
+        {
+            if (codepoint < 0x80)
+            {
+                out += static_cast<char>(codepoint);
+            }
+            else if (codepoint < 0x800)
+            {
+                out += static_cast<char>(0xC0 | (codepoint >> 6));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+            else if (codepoint < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | (codepoint >> 12));
+                out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | (codepoint >> 18));
+                out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (codepoint & 0x3F));
+            }
+        }
+
+        uint32_t parseHex4()
+        {
+            if (position + 4 > text.size())
+            {
+                fail("truncated unicode escape");
+            }
+            uint32_t codepoint = 0;
+            auto result = std::from_chars(text.data() + position, text.data() + position + 4, codepoint, 16);
+            if (result.ec != std::errc{} || result.ptr != text.data() + position + 4)
+            {
+                fail("invalid unicode escape");
+            }
+            position += 4;
+            return codepoint;
+        }
+
+        std::string parseString()
+        {
+            if (position >= text.size() || text[position] != '"')
+            {
+                fail("expected string");
+            }
+            position++;
+
+            std::string out;
+            while (true)
+            {
+                if (position >= text.size())
+                {
+                    fail("unterminated string");
+                }
+                char c = text[position++];
+                if (c == '"') break;
+                if (c != '\\')
+                {
+                    out += c;
+                    continue;
+                }
+                if (position >= text.size())
+                {
+                    fail("unterminated escape");
+                }
+                char escape = text[position++];
+                switch (escape)
+                {
+                    case '"': out += '"'; break;
+                    case '\\': out += '\\'; break;
+                    case '/': out += '/'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'n': out += '\n'; break;
+                    case 'r': out += '\r'; break;
+                    case 't': out += '\t'; break;
+                    case 'u':
+                    {
+                        uint32_t codepoint = parseHex4();
+                        // surrogate pair
+                        if (codepoint >= 0xD800 && codepoint < 0xDC00 && consumeLiteral("\\u"))
+                        {
+                            uint32_t low = parseHex4();
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(out, codepoint);
+                        break;
+                    }
+                    default:
+                        fail("invalid escape");
+                }
+            }
+            return out;
+        }
+
+        std::string_view text;
+        size_t position = 0;
+    };
+
+    JsonValue JsonValue::parse(std::string_view text)
+    {
+        return Parser{text}.parseDocument();
+    }
+
+    static const JsonValue& nullValue()
+    {
+        static const JsonValue value{};
+        return value;
+    }
+
+    bool JsonValue::has(std::string_view key) const
+    {
+        for (const auto& member : mMembers)
+        {
+            if (member.first == key) return true;
+        }
+        return false;
+    }
+
+    const JsonValue& JsonValue::operator[](std::string_view key) const
+    {
+        for (const auto& member : mMembers)
+        {
+            if (member.first == key) return member.second;
+        }
+        return nullValue();
+    }
+
+    const JsonValue& JsonValue::operator[](size_t index) const
+    {
+        return index < mElements.size() ? mElements[index] : nullValue();
+    }
+
+    size_t JsonValue::size() const
+    {
+        if (mType == Type::Array) return mElements.size();
+        if (mType == Type::Object) return mMembers.size();
+        return 0;
+    }
+}
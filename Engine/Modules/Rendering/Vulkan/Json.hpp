@@ -0,0 +1,49 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace RenderingEngine
+{
+    // minimal read only JSON document, enough for glTF
+    // missing keys and out of range indices return a shared null value instead of throwing
+    class JsonValue
+    {
+    public:
+        enum class Type { Null, Bool, Number, String, Array, Object };
+
+        // throws std::runtime_error on malformed input
+        static JsonValue parse(std::string_view text);
+
+        Type type() const { return mType; }
+        bool isNull() const { return mType == Type::Null; }
+        bool isNumber() const { return mType == Type::Number; }
+        bool isString() const { return mType == Type::String; }
+        bool isArray() const { return mType == Type::Array; }
+        bool isObject() const { return mType == Type::Object; }
+
+        bool asBool(bool fallback = false) const { return mType == Type::Bool ? mBool : fallback; }
+        double asNumber(double fallback = 0.0) const { return mType == Type::Number ? mNumber : fallback; }
+        const std::string& asString() const { return mString; }
+
+        bool has(std::string_view key) const;
+        const JsonValue& operator[](std::string_view key) const;
+        const JsonValue& operator[](size_t index) const;
+        // element count of arrays and objects, 0 otherwise
+        size_t size() const;
+
+    private:
+        class Parser;
+
+        Type mType = Type::Null;
+        bool mBool = false;
+        double mNumber = 0.0;
+        std::string mString;
+        std::vector<JsonValue> mElements;
+        std::vector<std::pair<std::string, JsonValue>> mMembers;
+    };
+}
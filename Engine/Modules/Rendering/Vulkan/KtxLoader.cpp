@@ -0,0 +1,206 @@
+#include "KtxLoader.hpp"
+#include "MappedFile.hpp"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+        struct Header
+        {
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth;
+            uint32_t pixelHeight;
+            uint32_t pixelDepth;
+            uint32_t layerCount;
+            uint32_t faceCount;
+            uint32_t levelCount;
+            uint32_t supercompressionScheme;
+        };
+        static_assert(sizeof(Header) == 36, "KTX2 header layout");
+        // the data format descriptor, key / value data and supercompression global data offsets follow,
+        // none of them is needed to upload the levels
+        constexpr size_t LEVEL_INDEX_OFFSET = 12 + sizeof(Header) + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+        struct LevelIndex
+        {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        // larger than any device supports, keeps the level size arithmetic far from overflowing
+        constexpr uint32_t MAX_DIMENSION = 1u << 16;
+
+        struct FormatBlock
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t bytes;
+        };
+
+        // 0 bytes for formats a texture cannot be uploaded as
+        FormatBlock formatBlock(VkFormat format)
+        {
+            switch (format)
+            {
+            case VK_FORMAT_R8_UNORM:
+            case VK_FORMAT_R8_SRGB:
+                return {1, 1, 1};
+            case VK_FORMAT_R8G8_UNORM:
+            case VK_FORMAT_R8G8_SRGB:
+            case VK_FORMAT_R16_UNORM:
+            case VK_FORMAT_R16_SFLOAT:
+                return {1, 1, 2};
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            case VK_FORMAT_R16G16_UNORM:
+            case VK_FORMAT_R16G16_SFLOAT:
+            case VK_FORMAT_R32_SFLOAT:
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+            case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+                return {1, 1, 4};
+            case VK_FORMAT_R16G16B16A16_UNORM:
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+            case VK_FORMAT_R32G32_SFLOAT:
+                return {1, 1, 8};
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return {1, 1, 16};
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+                return {4, 4, 8};
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return {4, 4, 16};
+            default:
+                return {1, 1, 0};
+            }
+        }
+    }
+
+    bool isKtx2File(const std::string& filePath)
+    {
+        std::string extension = std::filesystem::path{filePath}.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+        return extension == ".ktx2";
+    }
+
+    LveTexture::ImageData parseKtx2File(const std::string& filePath)
+    {
+        auto file = std::make_shared<MappedFile>(filePath);
+        if (!file->isOpen())
+        {
+            throw std::runtime_error("failed to open texture: " + filePath);
+        }
+
+        const uint8_t* data = file->data();
+        Header header;
+        if (file->size() < LEVEL_INDEX_OFFSET || std::memcmp(data, IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+        {
+            throw std::runtime_error("not a KTX2 file: " + filePath);
+        }
+        std::memcpy(&header, data + sizeof(IDENTIFIER), sizeof(Header));
+
+        if (header.supercompressionScheme != 0)
+        {
+            throw std::runtime_error("supercompressed KTX2 is not supported: " + filePath);
+        }
+        if (header.vkFormat == VK_FORMAT_UNDEFINED || header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1)
+        {
+            throw std::runtime_error("unsupported KTX2 image, only 2D textures with a vulkan format: " + filePath);
+        }
+        if (header.faceCount != 1 && header.faceCount != 6)
+        {
+            throw std::runtime_error("invalid KTX2 face count: " + filePath);
+        }
+        if (header.pixelWidth > MAX_DIMENSION || header.pixelHeight > MAX_DIMENSION)
+        {
+            throw std::runtime_error("KTX2 image too large: " + filePath);
+        }
+        FormatBlock block = formatBlock(static_cast<VkFormat>(header.vkFormat));
+        if (block.bytes == 0)
+        {
+            throw std::runtime_error("unsupported KTX2 format " + std::to_string(header.vkFormat) + ": " + filePath);
+        }
+
+        // a level count of 0 asks the loader to generate the mips
+        uint32_t levelCount = std::max(header.levelCount, 1u);
+        if (levelCount > 32 || LEVEL_INDEX_OFFSET + levelCount * sizeof(LevelIndex) > file->size())
+        {
+            throw std::runtime_error("truncated KTX2 level index: " + filePath);
+        }
+
+        std::vector<LevelIndex> levels(levelCount);
+        std::memcpy(levels.data(), data + LEVEL_INDEX_OFFSET, levelCount * sizeof(LevelIndex));
+
+        // the copies to the image read as many bytes as the format and extent imply, whatever the index claims
+        uint64_t layerCount = static_cast<uint64_t>(std::max(header.layerCount, 1u)) * header.faceCount;
+        uint64_t fileSize = file->size();
+
+        // the levels are stored smallest first, upload the span that holds all of them
+        uint64_t begin = UINT64_MAX;
+        uint64_t end = 0;
+        for (uint32_t i = 0; i < levelCount; i++)
+        {
+            const LevelIndex& level = levels[i];
+            // written without the sum, an offset near UINT64_MAX would wrap it below the file size
+            if (level.byteOffset > fileSize || level.byteLength > fileSize - level.byteOffset)
+            {
+                throw std::runtime_error("KTX2 level outside the file: " + filePath);
+            }
+
+            uint64_t blocksX = (std::max(header.pixelWidth >> i, 1u) + block.width - 1) / block.width;
+            uint64_t blocksY = (std::max(header.pixelHeight >> i, 1u) + block.height - 1) / block.height;
+            // at most 2^36 by MAX_DIMENSION, times the layers it can only overflow past the file size
+            uint64_t layerSize = blocksX * blocksY * block.bytes;
+            if (layerSize > fileSize / layerCount || level.byteLength != layerSize * layerCount)
+            {
+                throw std::runtime_error("KTX2 level " + std::to_string(i) + " size does not match its format and extent: " + filePath);
+            }
+            begin = std::min(begin, level.byteOffset);
+            end = std::max(end, level.byteOffset + level.byteLength);
+        }
+
+        LveTexture::ImageData image{};
+        image.width = header.pixelWidth;
+        image.height = header.pixelHeight;
+        image.size = end - begin;
+        image.format = static_cast<VkFormat>(header.vkFormat);
+        // layers of a level are packed layer major, face minor, the same order as vulkan array layers
+        image.layerCount = static_cast<uint32_t>(layerCount);
+        for (const LevelIndex& level : levels)
+        {
+            image.levelOffsets.push_back(level.byteOffset - begin);
+            image.levelSizes.push_back(level.byteLength);
+        }
+        // aliasing handle, the mapping lives as long as the pixels are referenced
+        image.pixels = std::shared_ptr<uint8_t>(file, const_cast<uint8_t*>(data + begin));
+        return image;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Texture.hpp"
+
+// std
+#include <string>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    KTX2 reader for textures that are uploaded as stored, no cpu decode
+    - the file is memory mapped, the returned pixels point into the mapping and keep it alive
+    - every mip level, array layer and cube face in the file is returned, level 0 first
+    - the vkFormat of the file is used as is (BC1-BC7, or a common uncompressed format),
+      LveTexture checks that the device can sample it
+    - every level must hold exactly the bytes its format and extent imply, a broken file throws
+    Supercompressed (BasisLZ / zstd / zlib) and 3D textures are not supported.
+    *************************************************/
+    LveTexture::ImageData parseKtx2File(const std::string& filePath);
+
+    bool isKtx2File(const std::string& filePath);
+}
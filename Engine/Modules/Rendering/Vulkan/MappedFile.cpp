@@ -0,0 +1,115 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// std
+#include <utility>
+
+namespace RenderingEngine
+{
+    MappedFile::MappedFile(const std::string& filePath)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        mFileHandle = file;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            close();
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            close();
+            return;
+        }
+        mMappingHandle = mapping;
+
+        mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (mData == nullptr)
+        {
+            close();
+            return;
+        }
+        mSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        mFileDescriptor = open(filePath.c_str(), O_RDONLY);
+        if (mFileDescriptor < 0) return;
+
+        struct stat fileStat;
+        if (fstat(mFileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            close();
+            return;
+        }
+
+        void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close();
+            return;
+        }
+        mData = static_cast<const uint8_t*>(mapping);
+        mSize = static_cast<size_t>(fileStat.st_size);
+        madvise(mapping, mSize, MADV_SEQUENTIAL);
+#endif
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            std::swap(mData, other.mData);
+            std::swap(mSize, other.mSize);
+#ifdef _WIN32
+            std::swap(mFileHandle, other.mFileHandle);
+            std::swap(mMappingHandle, other.mMappingHandle);
+#else
+            std::swap(mFileDescriptor, other.mFileDescriptor);
+#endif
+        }
+        return *this;
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if (mData) UnmapViewOfFile(mData);
+        if (mMappingHandle) CloseHandle(mMappingHandle);
+        if (mFileHandle) CloseHandle(mFileHandle);
+        mMappingHandle = nullptr;
+        mFileHandle = nullptr;
+#else
+        if (mData) munmap(const_cast<uint8_t*>(mData), mSize);
+        if (mFileDescriptor >= 0) ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace RenderingEngine
+{
+    // read only memory mapping of a whole file, isOpen() is false if the file is missing or empty
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& filePath);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        bool isOpen() const { return mData != nullptr; }
+        const uint8_t* data() const { return mData; }
+        size_t size() const { return mSize; }
+
+    private:
+        void close();
+
+        const uint8_t* mData = nullptr;
+        size_t mSize = 0;
+#ifdef _WIN32
+        void* mFileHandle = nullptr;
+        void* mMappingHandle = nullptr;
+#else
+        int mFileDescriptor = -1;
+#endif
+    };
+}
@@ -0,0 +1,290 @@
+#include "MeshCache.hpp"
+
+// std
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        struct MeshCacheHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint64_t sourceHash;
+            uint64_t importKey;
+            uint32_t vertexFormat;
+            uint32_t vertexSize;
+            uint32_t vertexCount;
+            uint32_t indexType;
+            uint32_t indexCount;
+            uint32_t meshletCount;
+            uint32_t submeshCount;
+            float boundsMin[3];
+            float boundsMax[3];
+            uint32_t materialCount;
+            uint64_t vertexOffset;
+            uint64_t indexOffset;
+            uint64_t meshletOffset;
+            uint64_t submeshOffset;
+            uint64_t materialOffset;
+            uint64_t materialSize;
+        };
+
+        constexpr char MAGIC[4] = {'R', 'E', 'M', 'C'};
+        constexpr uint64_t BLOB_ALIGNMENT = 16;
+        constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+        constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+        uint64_t fnv1a(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash ^= bytes[i];
+                hash *= FNV_PRIME;
+            }
+            return hash;
+        }
+
+        uint64_t alignUp(uint64_t value)
+        {
+            return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+        }
+
+        uint32_t indexSize(uint32_t indexType)
+        {
+            return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        // per material: 6 floats of factors, then four uint32 length prefixed paths
+        void writeString(std::vector<uint8_t>& out, const std::string& value)
+        {
+            uint32_t length = static_cast<uint32_t>(value.size());
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&length);
+            out.insert(out.end(), bytes, bytes + sizeof(length));
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        std::vector<uint8_t> encodeMaterials(const LveModel::Material* materials, uint32_t count)
+        {
+            std::vector<uint8_t> out;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const LveModel::Material& material = materials[i];
+                float factors[6] = {
+                    material.baseColorFactor.r, material.baseColorFactor.g, material.baseColorFactor.b,
+                    material.baseColorFactor.a, material.metallicFactor, material.roughnessFactor};
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(factors);
+                out.insert(out.end(), bytes, bytes + sizeof(factors));
+                writeString(out, material.albedoTexture);
+                writeString(out, material.normalTexture);
+                writeString(out, material.metallicRoughnessTexture);
+                writeString(out, material.occlusionTexture);
+            }
+            return out;
+        }
+
+        bool readString(const uint8_t*& p, const uint8_t* end, std::string& value)
+        {
+            uint32_t length;
+            if (static_cast<size_t>(end - p) < sizeof(length)) return false;
+            std::memcpy(&length, p, sizeof(length));
+            p += sizeof(length);
+            if (static_cast<size_t>(end - p) < length) return false;
+            value.assign(reinterpret_cast<const char*>(p), length);
+            p += length;
+            return true;
+        }
+
+        bool decodeMaterials(const uint8_t* p, const uint8_t* end, uint32_t count, std::vector<LveModel::Material>& materials)
+        {
+            materials.resize(count);
+            for (auto& material : materials)
+            {
+                float factors[6];
+                if (static_cast<size_t>(end - p) < sizeof(factors)) return false;
+                std::memcpy(factors, p, sizeof(factors));
+                p += sizeof(factors);
+                material.baseColorFactor = glm::vec4{factors[0], factors[1], factors[2], factors[3]};
+                material.metallicFactor = factors[4];
+                material.roughnessFactor = factors[5];
+                if (!readString(p, end, material.albedoTexture) ||
+                    !readString(p, end, material.normalTexture) ||
+                    !readString(p, end, material.metallicRoughnessTexture) ||
+                    !readString(p, end, material.occlusionTexture))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    std::string MeshCache::cachePathFor(const std::string& sourcePath)
+    {
+        return sourcePath + ".remc";
+    }
+
+    uint64_t MeshCache::hashSource(const std::string& sourcePath)
+    {
+        MappedFile source{sourcePath};
+        if (!source.isOpen()) return 0;
+        uint64_t size = source.size();
+        return fnv1a(source.data(), source.size(), fnv1a(&size, sizeof(size)));
+    }
+
+    uint64_t MeshCache::hashImportOptions(const LveModel::ImportOptions& options)
+    {
+        // hash field by field, the struct has padding bytes
+        uint64_t hash = fnv1a(&VERSION, sizeof(VERSION));
+        hash = fnv1a(&options.optimizeMesh, sizeof(options.optimizeMesh), hash);
+        hash = fnv1a(&options.buildMeshlets, sizeof(options.buildMeshlets), hash);
+        hash = fnv1a(&options.maxMeshletVertices, sizeof(options.maxMeshletVertices), hash);
+        hash = fnv1a(&options.maxMeshletTriangles, sizeof(options.maxMeshletTriangles), hash);
+        hash = fnv1a(&options.compactVertices, sizeof(options.compactVertices), hash);
+        return hash;
+    }
+
+    bool MeshCache::open(const std::string& cachePath, uint64_t sourceHash, uint64_t importKey)
+    {
+        mFile = MappedFile{cachePath};
+        if (!mFile.isOpen() || mFile.size() < sizeof(MeshCacheHeader)) return false;
+
+        MeshCacheHeader header;
+        std::memcpy(&header, mFile.data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+            header.sourceHash != sourceHash || header.importKey != importKey)
+        {
+            return false;
+        }
+
+        auto fits = [&](uint64_t offset, uint64_t size) {
+            return offset % BLOB_ALIGNMENT == 0 && offset <= mFile.size() && size <= mFile.size() - offset;
+        };
+        if (!fits(header.vertexOffset, uint64_t(header.vertexSize) * header.vertexCount) ||
+            !fits(header.indexOffset, uint64_t(indexSize(header.indexType)) * header.indexCount) ||
+            !fits(header.meshletOffset, uint64_t(sizeof(LveModel::Meshlet)) * header.meshletCount) ||
+            !fits(header.submeshOffset, uint64_t(sizeof(LveModel::Submesh)) * header.submeshCount) ||
+            !fits(header.materialOffset, header.materialSize))
+        {
+            return false;
+        }
+
+        // the culling pass writes each meshlet into its submesh's range of the culled index buffer
+        const auto* meshlets = reinterpret_cast<const LveModel::Meshlet*>(mFile.data() + header.meshletOffset);
+        const auto* submeshes = reinterpret_cast<const LveModel::Submesh*>(mFile.data() + header.submeshOffset);
+        for (uint32_t i = 0; i < header.meshletCount; i++)
+        {
+            const LveModel::Meshlet& meshlet = meshlets[i];
+            if (meshlet.submeshIndex >= header.submeshCount) return false;
+            const LveModel::Submesh& submesh = submeshes[meshlet.submeshIndex];
+            if (meshlet.firstIndex < submesh.firstIndex ||
+                uint64_t(meshlet.firstIndex) + meshlet.indexCount > uint64_t(submesh.firstIndex) + submesh.indexCount)
+            {
+                return false;
+            }
+        }
+
+        const uint8_t* materialData = mFile.data() + header.materialOffset;
+        if (!decodeMaterials(materialData, materialData + header.materialSize, header.materialCount, mMaterials))
+        {
+            return false;
+        }
+
+        mView = LveModel::MeshView{};
+        mView.vertexFormat = static_cast<LveModel::VertexFormat>(header.vertexFormat);
+        mView.vertices = mFile.data() + header.vertexOffset;
+        mView.vertexSize = header.vertexSize;
+        mView.vertexCount = header.vertexCount;
+        mView.indices = mFile.data() + header.indexOffset;
+        mView.indexType = static_cast<VkIndexType>(header.indexType);
+        mView.indexCount = header.indexCount;
+        mView.meshlets = reinterpret_cast<const LveModel::Meshlet*>(mFile.data() + header.meshletOffset);
+        mView.meshletCount = header.meshletCount;
+        mView.submeshes = reinterpret_cast<const LveModel::Submesh*>(mFile.data() + header.submeshOffset);
+        mView.submeshCount = header.submeshCount;
+        mView.materials = mMaterials.data();
+        mView.materialCount = static_cast<uint32_t>(mMaterials.size());
+        mView.boundsMin = glm::vec3{header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]};
+        mView.boundsMax = glm::vec3{header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]};
+        return true;
+    }
+
+    bool MeshCache::write(const std::string& cachePath, uint64_t sourceHash, uint64_t importKey, const LveModel::MeshView& mesh)
+    {
+        MeshCacheHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.sourceHash = sourceHash;
+        header.importKey = importKey;
+        header.vertexFormat = static_cast<uint32_t>(mesh.vertexFormat);
+        header.vertexSize = mesh.vertexSize;
+        header.vertexCount = mesh.vertexCount;
+        header.indexType = static_cast<uint32_t>(mesh.indexType);
+        header.indexCount = mesh.indexCount;
+        header.meshletCount = mesh.meshletCount;
+        header.submeshCount = mesh.submeshCount;
+        header.materialCount = mesh.materialCount;
+        std::vector<uint8_t> materials = encodeMaterials(mesh.materials, mesh.materialCount);
+        header.materialSize = materials.size();
+        for (int i = 0; i < 3; i++)
+        {
+            header.boundsMin[i] = mesh.boundsMin[i];
+            header.boundsMax[i] = mesh.boundsMax[i];
+        }
+
+        struct Blob
+        {
+            const void* data;
+            uint64_t size;
+            uint64_t* offset;
+        };
+        Blob blobs[] = {
+            {mesh.vertices, uint64_t(mesh.vertexSize) * mesh.vertexCount, &header.vertexOffset},
+            {mesh.indices, uint64_t(indexSize(mesh.indexType)) * mesh.indexCount, &header.indexOffset},
+            {mesh.meshlets, uint64_t(sizeof(LveModel::Meshlet)) * mesh.meshletCount, &header.meshletOffset},
+            {mesh.submeshes, uint64_t(sizeof(LveModel::Submesh)) * mesh.submeshCount, &header.submeshOffset},
+            {materials.data(), materials.size(), &header.materialOffset},
+        };
+        uint64_t offset = alignUp(sizeof(MeshCacheHeader));
+        for (Blob& blob : blobs)
+        {
+            *blob.offset = offset;
+            offset = alignUp(offset + blob.size);
+        }
+
+        // write beside the final path and rename, a crash never leaves a half written cache behind
+        std::string tempPath = cachePath + ".tmp";
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file) return false;
+
+            const char zeros[BLOB_ALIGNMENT] = {};
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            uint64_t written = sizeof(header);
+            for (const Blob& blob : blobs)
+            {
+                file.write(zeros, static_cast<std::streamsize>(*blob.offset - written));
+                if (blob.size > 0)
+                {
+                    file.write(static_cast<const char*>(blob.data), static_cast<std::streamsize>(blob.size));
+                }
+                written = *blob.offset + blob.size;
+            }
+            if (!file) return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+}
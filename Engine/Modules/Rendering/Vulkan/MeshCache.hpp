@@ -0,0 +1,41 @@
+#pragma once
+
+#include "MappedFile.hpp"
+#include "Model.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*************************************************
+Binary cache of an imported mesh, written next to the source as <source>.remc
+The file is the final gpu data, so a cache hit is mapped and uploaded without any parsing:
+header | vertices | indices | meshlets | submeshes | materials, every blob 16 byte aligned
+Materials are the only blob that is decoded on open, their texture paths are variable length.
+A cache is only used if version, source hash and import key all match.
+*************************************************/
+namespace RenderingEngine
+{
+    class MeshCache
+    {
+    public:
+        static constexpr uint32_t VERSION = 6;
+
+        static std::string cachePathFor(const std::string& sourcePath);
+        static uint64_t hashSource(const std::string& sourcePath);
+        static uint64_t hashImportOptions(const LveModel::ImportOptions& options);
+
+        // returns false if the cache is missing, truncated or stale
+        bool open(const std::string& cachePath, uint64_t sourceHash, uint64_t importKey);
+        // points into the mapping, valid while this MeshCache is alive
+        const LveModel::MeshView& view() const { return mView; }
+
+        static bool write(const std::string& cachePath, uint64_t sourceHash, uint64_t importKey, const LveModel::MeshView& mesh);
+
+    private:
+        MappedFile mFile;
+        LveModel::MeshView mView{};
+        std::vector<LveModel::Material> mMaterials;
+    };
+}
@@ -0,0 +1,354 @@
+#include "MeshOptimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        // triangles touching each vertex, stored as one flat array
+        struct TriangleAdjacency
+        {
+            std::vector<uint32_t> counts;
+            std::vector<uint32_t> offsets;
+            std::vector<uint32_t> triangles;
+
+            TriangleAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount)
+                : counts(vertexCount, 0), offsets(vertexCount, 0), triangles(indices.size())
+            {
+                for (uint32_t index : indices)
+                {
+                    counts[index]++;
+                }
+                uint32_t offset = 0;
+                for (size_t v = 0; v < vertexCount; v++)
+                {
+                    offsets[v] = offset;
+                    offset += counts[v];
+                }
+                std::vector<uint32_t> fill = offsets;
+                for (size_t i = 0; i < indices.size(); i++)
+                {
+                    triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+        };
+
+        // fifo cache emulated with timestamps, a vertex is resident if it was inserted less than cacheSize misses ago
+        struct FifoCache
+        {
+            std::vector<uint32_t> timestamps;
+            uint32_t time;
+            uint32_t size;
+
+            FifoCache(size_t vertexCount, uint32_t cacheSize)
+                : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+            void reset() { time += size + 1; }
+
+            // returns the number of misses
+            uint32_t addTriangle(uint32_t a, uint32_t b, uint32_t c)
+            {
+                uint32_t misses = 0;
+                for (uint32_t v : {a, b, c})
+                {
+                    if (time - timestamps[v] > size)
+                    {
+                        timestamps[v] = time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            }
+        };
+
+        // Tipsify's next fanning vertex: the candidate that stays in cache longest, else a dead end
+        int64_t getNextVertex(
+            const std::vector<uint32_t>& candidates,
+            const std::vector<uint32_t>& cacheTime,
+            uint32_t timestamp,
+            uint32_t cacheSize,
+            const std::vector<uint32_t>& liveTriangles,
+            std::vector<uint32_t>& deadEnds,
+            size_t& cursor)
+        {
+            int64_t best = -1;
+            uint32_t bestPriority = 0;
+            for (uint32_t v : candidates)
+            {
+                if (liveTriangles[v] == 0) continue;
+
+                // vertices that would still be in cache after fanning them get priority by age
+                uint32_t priority = 0;
+                if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                {
+                    priority = timestamp - cacheTime[v];
+                }
+                if (priority > bestPriority || best < 0)
+                {
+                    bestPriority = priority;
+                    best = v;
+                }
+            }
+            if (best >= 0) return best;
+
+            while (!deadEnds.empty())
+            {
+                uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[v] > 0) return v;
+            }
+            while (cursor < liveTriangles.size())
+            {
+                if (liveTriangles[cursor] > 0) return static_cast<int64_t>(cursor);
+                cursor++;
+            }
+            return -1;
+        }
+    }
+
+    VertexCacheStatistics analyzeVertexCache(
+        const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        assert(indices.size() % 3 == 0);
+        VertexCacheStatistics result{};
+        if (indices.empty()) return result;
+
+        FifoCache cache{vertexCount, cacheSize};
+        std::vector<bool> referenced(vertexCount, false);
+        size_t uniqueVertices = 0;
+        size_t misses = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            misses += cache.addTriangle(indices[i], indices[i + 1], indices[i + 2]);
+            for (size_t k = 0; k < 3; k++)
+            {
+                if (!referenced[indices[i + k]])
+                {
+                    referenced[indices[i + k]] = true;
+                    uniqueVertices++;
+                }
+            }
+        }
+        result.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        result.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+        return result;
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        assert(indices.size() % 3 == 0);
+        if (indices.empty()) return;
+
+        TriangleAdjacency adjacency{indices, vertexCount};
+        std::vector<uint32_t> liveTriangles = adjacency.counts;
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(indices.size() / 3, false);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        uint32_t timestamp = cacheSize + 1;
+        size_t cursor = 0;
+        int64_t fanningVertex = 0;
+        while (liveTriangles[static_cast<size_t>(fanningVertex)] == 0 && fanningVertex + 1 < static_cast<int64_t>(vertexCount))
+        {
+            fanningVertex++;
+        }
+
+        while (fanningVertex >= 0)
+        {
+            candidates.clear();
+            uint32_t f = static_cast<uint32_t>(fanningVertex);
+            for (uint32_t k = 0; k < adjacency.counts[f]; k++)
+            {
+                uint32_t triangle = adjacency.triangles[adjacency.offsets[f] + k];
+                if (emitted[triangle]) continue;
+
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    uint32_t v = indices[triangle * 3 + c];
+                    result.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    liveTriangles[v]--;
+                    if (timestamp - cacheTime[v] > cacheSize)
+                    {
+                        cacheTime[v] = timestamp++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+            fanningVertex = getNextVertex(candidates, cacheTime, timestamp, cacheSize, liveTriangles, deadEnds, cursor);
+        }
+
+        assert(result.size() == indices.size());
+        indices.swap(result);
+    }
+
+    void optimizeOverdraw(
+        std::vector<uint32_t>& indices,
+        const float* positions,
+        size_t vertexCount,
+        size_t positionStride,
+        float threshold,
+        uint32_t cacheSize)
+    {
+        assert(indices.size() % 3 == 0);
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0) return;
+
+        auto position = [&](uint32_t v) {
+            return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * positionStride);
+        };
+
+        // hard boundaries: a triangle that misses on all three vertices starts over with a cold cache
+        std::vector<size_t> hardClusters;
+        {
+            FifoCache cache{vertexCount, cacheSize};
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]) == 3)
+                {
+                    hardClusters.push_back(t);
+                }
+            }
+            if (hardClusters.empty() || hardClusters[0] != 0)
+            {
+                hardClusters.insert(hardClusters.begin(), 0);
+            }
+        }
+
+        // soft boundaries: split a hard cluster wherever the prefix acmr is already within threshold of the whole cluster
+        std::vector<size_t> clusters;
+        {
+            FifoCache cache{vertexCount, cacheSize};
+            for (size_t c = 0; c < hardClusters.size(); c++)
+            {
+                size_t start = hardClusters[c];
+                size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+
+                cache.reset();
+                size_t clusterMisses = 0;
+                for (size_t t = start; t < end; t++)
+                {
+                    clusterMisses += cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+                }
+                float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+                clusters.push_back(start);
+                cache.reset();
+                size_t runningMisses = 0;
+                size_t runningTriangles = 0;
+                for (size_t t = start; t < end; t++)
+                {
+                    runningMisses += cache.addTriangle(indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2]);
+                    runningTriangles++;
+                    if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold && t + 1 < end)
+                    {
+                        clusters.push_back(t + 1);
+                        cache.reset();
+                        runningMisses = 0;
+                        runningTriangles = 0;
+                    }
+                }
+            }
+        }
+
+        // mesh centroid weighted by triangle area
+        double meshCentroid[3] = {0.0, 0.0, 0.0};
+        double meshArea = 0.0;
+        std::vector<float> triangleArea(triangleCount);
+        std::vector<float> triangleNormal(triangleCount * 3);
+        std::vector<float> triangleCentroid(triangleCount * 3);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const float* p0 = position(indices[t * 3]);
+            const float* p1 = position(indices[t * 3 + 1]);
+            const float* p2 = position(indices[t * 3 + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            triangleArea[t] = area;
+            for (int k = 0; k < 3; k++)
+            {
+                triangleNormal[t * 3 + k] = n[k]; // length is twice the area, which is the weight we want
+                triangleCentroid[t * 3 + k] = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                meshCentroid[k] += triangleCentroid[t * 3 + k] * area;
+            }
+            meshArea += area;
+        }
+        if (meshArea > 0.0)
+        {
+            for (double& component : meshCentroid) component /= meshArea;
+        }
+
+        // clusters facing away from the centroid are likely to occlude the rest, draw them first
+        std::vector<float> sortKey(clusters.size());
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            size_t start = clusters[c];
+            size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+            float centroid[3] = {0.0f, 0.0f, 0.0f};
+            float normal[3] = {0.0f, 0.0f, 0.0f};
+            float area = 0.0f;
+            for (size_t t = start; t < end; t++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    centroid[k] += triangleCentroid[t * 3 + k] * triangleArea[t];
+                    normal[k] += triangleNormal[t * 3 + k];
+                }
+                area += triangleArea[t];
+            }
+            float invArea = area > 0.0f ? 1.0f / area : 0.0f;
+            float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+
+            float key = 0.0f;
+            for (int k = 0; k < 3; k++)
+            {
+                key += (centroid[k] * invArea - static_cast<float>(meshCentroid[k])) * normal[k] * invNormalLength;
+            }
+            sortKey[c] = key;
+        }
+
+        std::vector<size_t> order(clusters.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (size_t c : order)
+        {
+            size_t start = clusters[c];
+            size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+        }
+        indices.swap(result);
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+        uint32_t nextVertex = 0;
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == std::numeric_limits<uint32_t>::max())
+            {
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+        return remap;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*************************************************
+Mesh optimization passes run on import, in this order:
+1. optimizeVertexCache  - reorder triangles for post-transform cache hits (Tipsify)
+2. optimizeOverdraw     - reorder clusters of triangles so outer surfaces draw first
+3. optimizeVertexFetch  - reorder vertices by first use for fetch locality
+The passes only touch index order / vertex order, never the rendered result.
+See "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007
+*************************************************/
+namespace RenderingEngine
+{
+    struct VertexCacheStatistics
+    {
+        float acmr = 0.0f; // average cache miss ratio: transformed vertices per triangle, 0.5 - 3.0
+        float atvr = 0.0f; // average transform to vertex ratio: transformed vertices per referenced vertex, >= 1.0
+    };
+
+    // simulate a fifo post-transform cache
+    VertexCacheStatistics analyzeVertexCache(
+        const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+    // expects cache optimized indices, threshold is how much worse than the cache optimized acmr a cluster may get
+    // positions are read as 3 floats every positionStride bytes
+    void optimizeOverdraw(
+        std::vector<uint32_t>& indices,
+        const float* positions,
+        size_t vertexCount,
+        size_t positionStride,
+        float threshold = 1.05f,
+        uint32_t cacheSize = 16);
+
+    // rewrites indices and returns old index -> new index, unreferenced vertices map to UINT32_MAX
+    std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+}
@@ -0,0 +1,329 @@
+#include "MipGenerator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        const char* NORMAL_MAP_SHADER = "E:/Projects/VulkanEngine/build/ShaderBin/mip_normal.comp.spv";
+        constexpr uint32_t GROUP_SIZE = 8;
+        // one texture per upload, a 16k texture has 15 levels below the base
+        constexpr uint32_t MAX_SETS = 32;
+
+        std::vector<char> readFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to open file: " + filename);
+            }
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), buffer.size());
+            return buffer;
+        }
+    }
+
+    MipGenerator::MipGenerator(LveDevice& device) : mDevice{device} {}
+
+    MipGenerator::~MipGenerator()
+    {
+        releaseTransientResources();
+        vkDestroyDescriptorPool(mDevice.device(), descriptorPool, nullptr);
+        vkDestroyPipeline(mDevice.device(), normalPipeline, nullptr);
+        vkDestroyShaderModule(mDevice.device(), normalShaderModule, nullptr);
+        vkDestroyPipelineLayout(mDevice.device(), normalPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(mDevice.device(), normalSetLayout, nullptr);
+    }
+
+    uint32_t MipGenerator::mipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    bool MipGenerator::supports(VkFormat format)
+    {
+        constexpr VkFormatFeatureFlags required =
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (mDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+    }
+
+    void MipGenerator::imageBarrier(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        uint32_t baseMipLevel,
+        uint32_t levelCount,
+        uint32_t layerCount,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkAccessFlags srcAccessMask,
+        VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags srcStageMask,
+        VkPipelineStageFlags dstStageMask)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcAccessMask = srcAccessMask;
+        barrier.dstAccessMask = dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = baseMipLevel;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layerCount;
+
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void MipGenerator::record(
+        VkCommandBuffer commandBuffer,
+        VkImage image,
+        VkFormat format,
+        VkExtent2D extent,
+        uint32_t mipLevels,
+        uint32_t layerCount,
+        MipFilter filter,
+        VkImageLayout finalLayout)
+    {
+        assert(mipLevels > 1 && "Nothing to generate for a single level");
+        // storage image writes need a linear rgba8 image, anything else gets the plain box filter
+        if (filter == MipFilter::NormalMap && format == VK_FORMAT_R8G8B8A8_UNORM)
+        {
+            recordNormalMap(commandBuffer, image, extent, mipLevels, layerCount, finalLayout);
+        }
+        else
+        {
+            recordBlits(commandBuffer, image, extent, mipLevels, layerCount, finalLayout);
+        }
+    }
+
+    void MipGenerator::recordBlits(
+        VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+        VkImageLayout finalLayout)
+    {
+        int32_t width = static_cast<int32_t>(extent.width);
+        int32_t height = static_cast<int32_t>(extent.height);
+
+        for (uint32_t level = 1; level < mipLevels; level++)
+        {
+            // the previous level is complete, read it
+            imageBarrier(
+                commandBuffer, image, level - 1, 1, layerCount,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            int32_t nextWidth = std::max(width / 2, 1);
+            int32_t nextHeight = std::max(height / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[1] = {width, height, 1};
+            blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layerCount};
+            blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+            blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layerCount};
+            // srgb formats are decoded before filtering and encoded again on write
+            vkCmdBlitImage(
+                commandBuffer,
+                image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit, VK_FILTER_LINEAR);
+
+            imageBarrier(
+                commandBuffer, image, level - 1, 1, layerCount,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, finalLayout,
+                VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+            width = nextWidth;
+            height = nextHeight;
+        }
+
+        // the last level was only ever written
+        imageBarrier(
+            commandBuffer, image, mipLevels - 1, 1, layerCount,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    void MipGenerator::recordNormalMap(
+        VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+        VkImageLayout finalLayout)
+    {
+        if (normalPipeline == VK_NULL_HANDLE)
+        {
+            createNormalMapPipeline();
+        }
+
+        // every level is read or written by the shader from here on
+        imageBarrier(
+            commandBuffer, image, 0, mipLevels, layerCount,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, normalPipeline);
+
+        VkImageView srcView = createLevelView(image, 0, layerCount);
+        uint32_t width = extent.width;
+        uint32_t height = extent.height;
+        for (uint32_t level = 1; level < mipLevels; level++)
+        {
+            VkImageView dstView = createLevelView(image, level, layerCount);
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = 1;
+            allocInfo.pSetLayouts = &normalSetLayout;
+            VkDescriptorSet descriptorSet;
+            if (vkAllocateDescriptorSets(mDevice.device(), &allocInfo, &descriptorSet) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to allocate mip descriptor set");
+            }
+
+            VkDescriptorImageInfo imageInfos[2]{
+                {VK_NULL_HANDLE, srcView, VK_IMAGE_LAYOUT_GENERAL},
+                {VK_NULL_HANDLE, dstView, VK_IMAGE_LAYOUT_GENERAL},
+            };
+            VkWriteDescriptorSet writes[2]{};
+            for (uint32_t binding = 0; binding < 2; binding++)
+            {
+                writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[binding].dstSet = descriptorSet;
+                writes[binding].dstBinding = binding;
+                writes[binding].descriptorCount = 1;
+                writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                writes[binding].pImageInfo = &imageInfos[binding];
+            }
+            vkUpdateDescriptorSets(mDevice.device(), 2, writes, 0, nullptr);
+
+            vkCmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, normalPipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+            vkCmdDispatch(commandBuffer, (width + GROUP_SIZE - 1) / GROUP_SIZE, (height + GROUP_SIZE - 1) / GROUP_SIZE, layerCount);
+
+            // the next level reads this one
+            imageBarrier(
+                commandBuffer, image, level, 1, layerCount,
+                VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            srcView = dstView;
+        }
+
+        imageBarrier(
+            commandBuffer, image, 0, mipLevels, layerCount,
+            VK_IMAGE_LAYOUT_GENERAL, finalLayout,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    void MipGenerator::releaseTransientResources()
+    {
+        for (VkImageView view : transientViews)
+        {
+            vkDestroyImageView(mDevice.device(), view, nullptr);
+        }
+        transientViews.clear();
+        if (descriptorPool != VK_NULL_HANDLE)
+        {
+            vkResetDescriptorPool(mDevice.device(), descriptorPool, 0);
+        }
+    }
+
+    VkImageView MipGenerator::createLevelView(VkImage image, uint32_t mipLevel, uint32_t layerCount)
+    {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, mipLevel, 1, 0, layerCount};
+
+        VkImageView view;
+        if (vkCreateImageView(mDevice.device(), &viewInfo, nullptr, &view) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip level view");
+        }
+        transientViews.push_back(view);
+        return view;
+    }
+
+    void MipGenerator::createNormalMapPipeline()
+    {
+        VkDescriptorSetLayoutBinding bindings[2]{};
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            bindings[binding].binding = binding;
+            bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            bindings[binding].descriptorCount = 1;
+            bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 2;
+        layoutInfo.pBindings = bindings;
+        if (vkCreateDescriptorSetLayout(mDevice.device(), &layoutInfo, nullptr, &normalSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip descriptor set layout");
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &normalSetLayout;
+        if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &normalPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip pipeline layout");
+        }
+
+        VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2 * MAX_SETS};
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = MAX_SETS;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        if (vkCreateDescriptorPool(mDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip descriptor pool");
+        }
+
+        std::vector<char> code = readFile(NORMAL_MAP_SHADER);
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = code.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        if (vkCreateShaderModule(mDevice.device(), &moduleInfo, nullptr, &normalShaderModule) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shader module");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.layout = normalPipelineLayout;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = normalShaderModule;
+        pipelineInfo.stage.pName = "main";
+        if (vkCreateComputePipelines(mDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &normalPipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create mip compute pipeline");
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Device.hpp"
+
+// std
+#include <vector>
+
+namespace RenderingEngine
+{
+    // how the levels below the base level of a texture are produced
+    enum class MipFilter
+    {
+        None,      // base level only
+        Box,       // linear blits, sRGB formats are filtered in linear space by the blit itself
+        NormalMap, // compute 2x2 average of the decoded normals, renormalized
+    };
+
+    /*************************************************
+    Records full mip chains on the GPU into the caller's upload command buffer
+    - Box: vkCmdBlitImage level by level
+    - NormalMap: mip_normal.comp per level, averaging unit vectors and renormalizing so the
+      lower levels keep unit length normals; needs R8G8B8A8_UNORM, other formats fall back to Box
+    Owned by LveDevice (LveDevice::mipGenerator), the compute pipeline is only built on first use.
+    *************************************************/
+    class MipGenerator
+    {
+    public:
+        explicit MipGenerator(LveDevice& device);
+        ~MipGenerator();
+
+        MipGenerator(const MipGenerator&) = delete;
+        MipGenerator& operator=(const MipGenerator&) = delete;
+
+        static uint32_t mipLevelCount(uint32_t width, uint32_t height);
+        // whether levels can be generated at all, the format has to support linear filtered blits
+        bool supports(VkFormat format);
+
+        // expects every level in TRANSFER_DST_OPTIMAL with level 0 written, leaves every level in finalLayout
+        void record(
+            VkCommandBuffer commandBuffer,
+            VkImage image,
+            VkFormat format,
+            VkExtent2D extent,
+            uint32_t mipLevels,
+            uint32_t layerCount,
+            MipFilter filter,
+            VkImageLayout finalLayout);
+
+        // views and descriptor sets of the recorded NormalMap chains, call once the command buffer completed
+        void releaseTransientResources();
+
+        static void imageBarrier(
+            VkCommandBuffer commandBuffer,
+            VkImage image,
+            uint32_t baseMipLevel,
+            uint32_t levelCount,
+            uint32_t layerCount,
+            VkImageLayout oldLayout,
+            VkImageLayout newLayout,
+            VkAccessFlags srcAccessMask,
+            VkAccessFlags dstAccessMask,
+            VkPipelineStageFlags srcStageMask,
+            VkPipelineStageFlags dstStageMask);
+
+    private:
+        void recordBlits(
+            VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+            VkImageLayout finalLayout);
+        void recordNormalMap(
+            VkCommandBuffer commandBuffer, VkImage image, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+            VkImageLayout finalLayout);
+        void createNormalMapPipeline();
+        VkImageView createLevelView(VkImage image, uint32_t mipLevel, uint32_t layerCount);
+
+        LveDevice& mDevice;
+
+        VkDescriptorSetLayout normalSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout normalPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline normalPipeline = VK_NULL_HANDLE;
+        VkShaderModule normalShaderModule = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+        std::vector<VkImageView> transientViews;
+    };
+}
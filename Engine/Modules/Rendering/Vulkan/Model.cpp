@@ -1,9 +1,8 @@
 ﻿#include "Model.hpp"
-
-#include "../../../External/utility.hpp"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "../../../External/tiny_obj_loader.h"
+#include "MeshCache.hpp"
+#include "GltfLoader.hpp"
+#include "MeshOptimizer.hpp"
+#include "ObjParser.hpp"
 
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -11,43 +10,94 @@
 #include <assimp/DefaultLogger.hpp>
 #include <assimp/LogStream.hpp>
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
 
 
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
-#include <unordered_map>
-
-namespace std
-{
-    template <>
-    struct hash<RenderingEngine::LveModel::Vertex>
-    {
-        size_t operator()(RenderingEngine::LveModel::Vertex const& vertex) const
-        {
-            size_t seed = 0;
-            RenderingEngine::hashCombine(seed, vertex.position, vertex.normal, vertex.tangent, vertex.bitangent, vertex.uv);
-            return seed;
-        }
-    };
-}
+#include <limits>
 
 namespace RenderingEngine{
 
+    static_assert(sizeof(LveModel::Meshlet) == 48, "Meshlet must match the std430 layout in meshlet_cull.comp");
+
+    static_assert(sizeof(LveModel::CompactVertex) == 20, "CompactVertex must stay tightly packed");
+
+    // 16 bit indices halve index memory and bandwidth for the many props below 65536 vertices
+    static LveModel::MeshView makeMeshView(const LveModel::Builder& builder, std::vector<uint16_t>& narrowIndices){
+        LveModel::MeshView mesh{};
+        mesh.vertexFormat = builder.vertexFormat;
+        if(builder.vertexFormat == LveModel::VertexFormat::Compact){
+            mesh.vertices = builder.compactVertices.data();
+            mesh.vertexSize = sizeof(LveModel::CompactVertex);
+            mesh.vertexCount = static_cast<uint32_t>(builder.compactVertices.size());
+            mesh.boundsMin = builder.boundsMin;
+            mesh.boundsMax = builder.boundsMax;
+        }else{
+            mesh.vertices = builder.vertices.data();
+            mesh.vertexSize = sizeof(LveModel::Vertex);
+            mesh.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        }
+
+        mesh.indexCount = static_cast<uint32_t>(builder.indices.size());
+        if(mesh.vertexCount <= static_cast<uint32_t>(std::numeric_limits<uint16_t>::max()) + 1){
+            narrowIndices.resize(builder.indices.size());
+            std::transform(builder.indices.begin(), builder.indices.end(), narrowIndices.begin(),
+                [](uint32_t index){ return static_cast<uint16_t>(index); });
+            mesh.indices = narrowIndices.data();
+            mesh.indexType = VK_INDEX_TYPE_UINT16;
+        }else{
+            mesh.indices = builder.indices.data();
+            mesh.indexType = VK_INDEX_TYPE_UINT32;
+        }
+
+        mesh.meshlets = builder.meshlets.data();
+        mesh.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+        mesh.submeshes = builder.submeshes.data();
+        mesh.submeshCount = static_cast<uint32_t>(builder.submeshes.size());
+        mesh.materials = builder.materials.data();
+        mesh.materialCount = static_cast<uint32_t>(builder.materials.size());
+        return mesh;
+    }
+
     LveModel::LveModel(LveDevice& device, const Builder& builder): mDevice{device} {
-        createVertexBuffer(builder.vertices);
-        createIndexBuffer(builder.indices);
+        std::vector<uint16_t> narrowIndices;
+        createBuffers(makeMeshView(builder, narrowIndices));
+    }
+
+    LveModel::LveModel(LveDevice& device, const MeshView& mesh): mDevice{device} {
+        createBuffers(mesh);
+    }
+
+    void LveModel::createBuffers(const MeshView& mesh){
+        meshletCount = mesh.meshletCount;
+        vertexFormat = mesh.vertexFormat;
+        if(vertexFormat == VertexFormat::Compact){
+            boundsMin = mesh.boundsMin;
+            boundsMax = mesh.boundsMax;
+        }
+        createVertexBuffer(mesh.vertices, mesh.vertexSize, mesh.vertexCount);
+        createIndexBuffer(mesh.indices, mesh.indexType, mesh.indexCount);
+
+        submeshes.assign(mesh.submeshes, mesh.submeshes + mesh.submeshCount);
+        materials.assign(mesh.materials, mesh.materials + mesh.materialCount);
+        if(submeshes.empty()){
+            submeshes.push_back(Submesh{0, indexCount, 0});
+        }
+        // the culled draws are per submesh
+        createMeshletBuffers(mesh.meshlets);
     }
     LveModel::~LveModel(){}
     
-    void LveModel::createVertexBuffer(const std::vector<Vertex>& vertices){
-        vertexCount = static_cast<uint32_t>(vertices.size());
+    void LveModel::createVertexBuffer(const void* vertices, uint32_t vertexSize, uint32_t count){
+        vertexCount = count;
         assert(vertexCount >= 3 && "Vertex count must be at least 3");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize) * vertexCount;
         
         // create host visible buffer as temporary buffer
         // the final data saves in gpu local memory
@@ -59,7 +109,7 @@ namespace RenderingEngine{
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
         };
         stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
+        stagingBuffer.writeToBuffer(const_cast<void*>(vertices));
 
         vertexBuffer = std::make_unique<LveBuffer>(
             mDevice,
@@ -72,59 +122,229 @@ namespace RenderingEngine{
          mDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
     }
     
-    void LveModel::createIndexBuffer(const std::vector<uint32_t>& indices){
-        indexCount = static_cast<uint32_t>(indices.size());
+    void LveModel::createIndexBuffer(const void* indices, VkIndexType type, uint32_t count){
+        indexCount = count;
+        indexType = type;
         hasIndexBuffer = indexCount > 0;
         if(!hasIndexBuffer){
             return;
         }
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-        uint32_t indexSize = sizeof(indices[0]);
+        uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        VkDeviceSize dataSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
+
+        // meshlet_cull.comp reads the source triangles as 32 bit words, round 16 bit buffers up to a whole word
+        uint32_t bufferIndexCount = indexCount;
+        if(indexType == VK_INDEX_TYPE_UINT16 && hasMeshlets()){
+            bufferIndexCount = (indexCount + 1) & ~1u;
+        }
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * bufferIndexCount;
+
         LveBuffer stagingBuffer{
             mDevice,
             indexSize,
-            indexCount,
+            bufferIndexCount,
             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
         };
         stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
+        stagingBuffer.writeToBuffer(const_cast<void*>(indices), dataSize);
+
+        // the meshlet culling pass reads the source triangles as a storage buffer
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        if(hasMeshlets()){
+            usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        }
 
         indexBuffer = std::make_unique<LveBuffer>(
             mDevice,
             indexSize,
-            indexCount,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            bufferIndexCount,
+            usage,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
         );
         mDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
     }
+
+    void LveModel::createMeshletBuffers(const Meshlet* meshlets){
+        if(!hasMeshlets()){
+            return;
+        }
+        assert(hasIndexBuffer && "Meshlets require an index buffer");
+
+        VkDeviceSize bufferSize = sizeof(meshlets[0]) * meshletCount;
+        uint32_t meshletSize = sizeof(meshlets[0]);
+        LveBuffer stagingBuffer{
+            mDevice,
+            meshletSize,
+            meshletCount,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        };
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer(const_cast<Meshlet*>(meshlets));
+
+        meshletBuffer = std::make_unique<LveBuffer>(
+            mDevice,
+            meshletSize,
+            meshletCount,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        mDevice.copyBuffer(stagingBuffer.getBuffer(), meshletBuffer->getBuffer(), bufferSize);
+
+        // indirect draw i appends to submesh i's own range of the culled index buffer, so each keeps its material
+        std::vector<VkDrawIndexedIndirectCommand> resetCommands;
+        for(const Submesh& submesh : submeshes){
+            resetCommands.push_back(VkDrawIndexedIndirectCommand{0, 1, submesh.firstIndex, 0, 0});
+        }
+        uint32_t commandSize = sizeof(VkDrawIndexedIndirectCommand);
+        uint32_t commandCount = static_cast<uint32_t>(resetCommands.size());
+        LveBuffer resetStagingBuffer{
+            mDevice,
+            commandSize,
+            commandCount,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        };
+        resetStagingBuffer.map();
+        resetStagingBuffer.writeToBuffer(resetCommands.data());
+        drawCommandResetBuffer = std::make_unique<LveBuffer>(
+            mDevice,
+            commandSize,
+            commandCount,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        mDevice.copyBuffer(resetStagingBuffer.getBuffer(), drawCommandResetBuffer->getBuffer(), static_cast<VkDeviceSize>(commandSize) * commandCount);
+
+        // one output per frame in flight, the culling pass of frame N must not overwrite what frame N-1 still draws
+        culledIndexBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+        drawCommandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+        for(int i = 0; i < LveSwapChain::MAX_FRAMES_IN_FLIGHT; i++){
+            culledIndexBuffers[i] = std::make_unique<LveBuffer>(
+                mDevice,
+                sizeof(uint32_t),
+                indexCount,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+            );
+            drawCommandBuffers[i] = std::make_unique<LveBuffer>(
+                mDevice,
+                commandSize,
+                commandCount,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+            );
+        }
+    }
     
-    std::unique_ptr<LveModel> LveModel::createModelFromFile(LveDevice& device, const std::string& filePath){
-        Builder builder{};
-        //builder.loadObjModel(filePath);
-        builder.loadFbxModel(filePath);
+    VkDeviceSize LveModel::getMemorySize() const{
+        VkDeviceSize size = vertexBuffer ? vertexBuffer->getBufferSize() : 0;
+        if(indexBuffer) size += indexBuffer->getBufferSize();
+        if(meshletBuffer) size += meshletBuffer->getBufferSize();
+        if(drawCommandResetBuffer) size += drawCommandResetBuffer->getBufferSize();
+        for(const auto& buffer : culledIndexBuffers){
+            if(buffer) size += buffer->getBufferSize();
+        }
+        for(const auto& buffer : drawCommandBuffers){
+            if(buffer) size += buffer->getBufferSize();
+        }
+        return size;
+    }
+
+    std::unique_ptr<LveModel> LveModel::createModelFromFile(LveDevice& device, const std::string& filePath, const ImportOptions& options){
+        std::unique_ptr<MeshData> data = loadMeshData(filePath, options);
+        return std::make_unique<LveModel>(device, data->view);
+    }
+
+    std::unique_ptr<LveModel::MeshData> LveModel::loadMeshData(const std::string& filePath, const ImportOptions& options, ThreadPool* threadPool){
+        auto data = std::make_unique<MeshData>();
+        // a valid cache skips the importer entirely and uploads straight from the mapping
+        std::string cachePath = MeshCache::cachePathFor(filePath);
+        uint64_t sourceHash = MeshCache::hashSource(filePath);
+        uint64_t importKey = MeshCache::hashImportOptions(options);
+        auto cache = std::make_shared<MeshCache>();
+        if(cache->open(cachePath, sourceHash, importKey)){
+            std::cout << "Loaded mesh cache: " << cachePath << std::endl;
+            data->view = cache->view();
+            data->cache = std::move(cache);
+            return data;
+        }
+
+        Builder& builder = data->builder;
+        std::string extension = std::filesystem::path(filePath).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        if(extension == ".obj"){
+            builder.loadObjModel(filePath, threadPool);
+        }else if(extension == ".gltf" || extension == ".glb"){
+            builder.loadGltfModel(filePath);
+        }else{
+            builder.loadFbxModel(filePath);
+        }
         std::cout << "Vertex count: " << builder.vertices.size() << std::endl;
-        return std::make_unique<LveModel>(device, builder);
+        if(builder.submeshes.empty()){
+            builder.submeshes.push_back(Submesh{0, static_cast<uint32_t>(builder.indices.size()), 0});
+        }
+        // meshlets and compaction both read the final vertex / index order, so optimize first
+        if(options.optimizeMesh){
+            builder.optimize();
+        }
+        if(options.buildMeshlets){
+            builder.buildMeshlets(options.maxMeshletVertices, options.maxMeshletTriangles);
+            std::cout << "Meshlet count: " << builder.meshlets.size() << std::endl;
+        }
+        if(options.compactVertices){
+            builder.compressVertices();
+            std::cout << "Vertex data: " << builder.vertices.size() * sizeof(Vertex) << " -> "
+                      << builder.compactVertices.size() * sizeof(CompactVertex) << " bytes" << std::endl;
+        }
+
+        data->view = makeMeshView(builder, data->narrowIndices);
+        if(!MeshCache::write(cachePath, sourceHash, importKey, data->view)){
+            std::cout << "Failed to write mesh cache: " << cachePath << std::endl;
+        }
+        return data;
     }
 
     void LveModel::draw(VkCommandBuffer commandBuffer){
+        // index width was fixed by bind, see indexType
         if(hasIndexBuffer){
             vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
         }else{
         vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
         }
     }
+    void LveModel::drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex){
+        assert(hasIndexBuffer && submeshIndex < submeshes.size() && "Submesh out of range");
+        const Submesh& submesh = submeshes[submeshIndex];
+        vkCmdDrawIndexed(commandBuffer, submesh.indexCount, 1, submesh.firstIndex, 0, 0);
+    }
+
     void LveModel::bind(VkCommandBuffer commandBuffer){
         VkBuffer vertexBuffers[] = {vertexBuffer->getBuffer()};
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
         if(hasIndexBuffer){
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType);
         }
         
         //draw(commandBuffer);
     }
+
+    void LveModel::bindCulled(VkCommandBuffer commandBuffer, int frameIndex){
+        assert(hasMeshlets() && "Model has no meshlets to cull");
+        VkBuffer vertexBuffers[] = {vertexBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, culledIndexBuffers[frameIndex]->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void LveModel::drawCulled(VkCommandBuffer commandBuffer, int frameIndex, uint32_t submeshIndex){
+        assert(submeshIndex < submeshes.size() && "Submesh out of range");
+        // index count of the draw is written by meshlet_cull.comp, culled indices are always 32 bit
+        VkDeviceSize offset = static_cast<VkDeviceSize>(submeshIndex) * sizeof(VkDrawIndexedIndirectCommand);
+        vkCmdDrawIndexedIndirect(commandBuffer, drawCommandBuffers[frameIndex]->getBuffer(), offset, 1, sizeof(VkDrawIndexedIndirectCommand));
+    }
     
     std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions(){
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
@@ -144,69 +364,128 @@ namespace RenderingEngine{
         return attributeDescriptions;
     }
 
-    void LveModel::Builder::loadObjModel(const std::string& modelPath){
-        // load model from file
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
-            
-        if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, modelPath.c_str())){
-            throw std::runtime_error(warn + err);
-        }
+    std::vector<VkVertexInputBindingDescription> LveModel::CompactVertex::getBindingDescriptions(){
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(CompactVertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+    std::vector<VkVertexInputAttributeDescription> LveModel::CompactVertex::getAttributeDescriptions(){
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        attributeDescriptions.push_back({0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position)});
+        attributeDescriptions.push_back({1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal)});
+        attributeDescriptions.push_back({2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, tangent)});
+        attributeDescriptions.push_back({3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, uv)});
 
+        return attributeDescriptions;
+    }
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    // octahedral mapping of a unit vector onto [-1, 1]^2
+    // see "A Survey of Efficient Representations for Independent Unit Vectors", Cigolle et al. 2014
+    static glm::vec2 octahedralEncode(glm::vec3 n){
+        n /= (glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z));
+        glm::vec2 e{n.x, n.y};
+        if(n.z < 0.0f){
+            glm::vec2 signNotZero{e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f};
+            e = (1.0f - glm::abs(glm::vec2{e.y, e.x})) * signNotZero;
+        }
+        return e;
+    }
 
-        vertices.clear();
-        indices.clear();
-        for(const auto& shape : shapes){
-            for(const auto& index : shape.mesh.indices){
-                Vertex vertex{};
-                if(index.vertex_index >= 0){
-                    vertex.position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2]
-                    };
-
-                    // delete color attribute
-                    //vertex.color = {
-                    //    attrib.colors[3 * index.vertex_index + 0],
-                    //    attrib.colors[3 * index.vertex_index + 1],
-                    //    attrib.colors[3 * index.vertex_index + 2]
-                    //};
-                }
+    void LveModel::Builder::optimize(){
+        if(indices.empty()){
+            return;
+        }
+        VertexCacheStatistics before = analyzeVertexCache(indices, vertices.size());
+
+        // triangles never move across submeshes, the material ranges stay valid
+        std::vector<uint32_t> range;
+        for(const Submesh& submesh : submeshes){
+            auto first = indices.begin() + submesh.firstIndex;
+            range.assign(first, first + submesh.indexCount);
+            optimizeVertexCache(range, vertices.size());
+            optimizeOverdraw(range, &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+            std::copy(range.begin(), range.end(), first);
+        }
 
-                if(index.normal_index >= 0){
-                    vertex.normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2]
-                    };
-                }
+        std::vector<uint32_t> remap = optimizeVertexFetch(indices, vertices.size());
+        std::vector<Vertex> remapped(vertices.size());
+        uint32_t usedVertices = 0;
+        for(size_t i = 0; i < vertices.size(); i++){
+            if(remap[i] != std::numeric_limits<uint32_t>::max()){
+                remapped[remap[i]] = vertices[i];
+                usedVertices++;
+            }
+        }
+        remapped.resize(usedVertices);
+        vertices.swap(remapped);
 
-                if(index.texcoord_index >= 0){
-                    vertex.uv = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                    };
-                }
-                if(uniqueVertices.count(vertex) == 0){
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
+        VertexCacheStatistics after = analyzeVertexCache(indices, vertices.size());
+        std::cout << "Vertex cache ACMR: " << before.acmr << " -> " << after.acmr
+                  << ", ATVR: " << before.atvr << " -> " << after.atvr << std::endl;
+    }
 
-                indices.push_back(uniqueVertices[vertex]);
+    void LveModel::Builder::compressVertices(){
+        assert(!vertices.empty() && "Nothing to compress");
+
+        boundsMin = glm::vec3{std::numeric_limits<float>::max()};
+        boundsMax = glm::vec3{std::numeric_limits<float>::lowest()};
+        for(const auto& vertex : vertices){
+            boundsMin = glm::min(boundsMin, vertex.position);
+            boundsMax = glm::max(boundsMax, vertex.position);
+        }
+        // flat models would divide by zero
+        glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3{std::numeric_limits<float>::epsilon()});
+        boundsMax = boundsMin + extent;
+
+        compactVertices.resize(vertices.size());
+        for(size_t i = 0; i < vertices.size(); i++){
+            const Vertex& vertex = vertices[i];
+            CompactVertex& compact = compactVertices[i];
+
+            glm::vec3 normal = glm::length(vertex.normal) > 0.0f ? glm::normalize(vertex.normal) : glm::vec3{0.0f, 0.0f, 1.0f};
+            glm::vec3 tangent = vertex.tangent - normal * glm::dot(normal, vertex.tangent);
+            if(glm::length(tangent) <= std::numeric_limits<float>::epsilon()){
+                // no uv derived tangent (e.g. obj files), any perpendicular will do
+                tangent = glm::cross(normal, glm::abs(normal.x) < 0.9f ? glm::vec3{1.0f, 0.0f, 0.0f} : glm::vec3{0.0f, 1.0f, 0.0f});
             }
+            tangent = glm::normalize(tangent);
+            float bitangentSign = glm::dot(glm::cross(normal, tangent), vertex.bitangent) < 0.0f ? 0.0f : 1.0f;
+
+            glm::vec3 position = (vertex.position - boundsMin) / extent;
+            compact.position[0] = glm::packUnorm1x16(position.x);
+            compact.position[1] = glm::packUnorm1x16(position.y);
+            compact.position[2] = glm::packUnorm1x16(position.z);
+            compact.position[3] = glm::packUnorm1x16(bitangentSign);
+
+            glm::vec2 octNormal = octahedralEncode(normal);
+            compact.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.x));
+            compact.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(octNormal.y));
+            glm::vec2 octTangent = octahedralEncode(tangent);
+            compact.tangent[0] = static_cast<int16_t>(glm::packSnorm1x16(octTangent.x));
+            compact.tangent[1] = static_cast<int16_t>(glm::packSnorm1x16(octTangent.y));
+
+            compact.uv[0] = glm::packHalf1x16(vertex.uv.x);
+            compact.uv[1] = glm::packHalf1x16(vertex.uv.y);
         }
-        
-    } 
+        vertexFormat = VertexFormat::Compact;
+    }
+
+    void LveModel::Builder::loadObjModel(const std::string& modelPath, ThreadPool* threadPool){
+        parseObjFile(modelPath, *this, threadPool);
+    }
+
+    void LveModel::Builder::loadGltfModel(const std::string& modelPath){
+        parseGltfFile(modelPath, *this);
+    }
 
     void LveModel::Builder::loadFbxModel(const std::string& modelPath){
         Assimp::Importer importer;
+        // JoinIdenticalVertices lets the faces double as our index buffer
         const unsigned int ImportFlags = 
             aiProcess_CalcTangentSpace |
+            aiProcess_JoinIdenticalVertices |
             aiProcess_Triangulate |
             aiProcess_SortByPType |
             aiProcess_PreTransformVertices |
@@ -220,38 +499,181 @@ namespace RenderingEngine{
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode){
             throw std::runtime_error("Failed to load model: " + std::string(importer.GetErrorString()));
         }
-        auto mesh = scene->mMeshes[0];
 
-        assert(mesh->HasPositions());
-        assert(mesh->HasNormals());
+        // group meshes by material so every material ends up as one contiguous submesh
+        std::vector<const aiMesh*> meshes;
+        size_t vertexTotal = 0;
+        size_t indexTotal = 0;
+        for(unsigned int m = 0; m < scene->mNumMeshes; m++){
+            const aiMesh* mesh = scene->mMeshes[m];
+            // SortByPType split points and lines into their own meshes
+            if(!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)){
+                continue;
+            }
+            meshes.push_back(mesh);
+            vertexTotal += mesh->mNumVertices;
+            indexTotal += static_cast<size_t>(mesh->mNumFaces) * 3;
+        }
+        std::stable_sort(meshes.begin(), meshes.end(), [](const aiMesh* a, const aiMesh* b){
+            return a->mMaterialIndex < b->mMaterialIndex;
+        });
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-        vertices.reserve(mesh->mNumVertices);
-        for(size_t i=0; i<vertices.capacity(); ++i) {
-            Vertex vertex;
-            vertex.position = {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z};
-            vertex.normal = {mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z};
+        vertices.clear();
+        indices.clear();
+        submeshes.clear();
+        vertices.reserve(vertexTotal);
+        indices.reserve(indexTotal);
 
-            if(mesh->HasTangentsAndBitangents()) {
-                vertex.tangent = {mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z};
-                vertex.bitangent = {mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z};
-                   
-            }
+        for(const aiMesh* mesh : meshes){
+            assert(mesh->HasPositions());
+            assert(mesh->HasNormals());
 
-            if(mesh->HasTextureCoords(0)) {
-                vertex.uv = {mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y};
-            }
+            uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+            for(unsigned int i = 0; i < mesh->mNumVertices; i++){
+                Vertex vertex{};
+                vertex.position = {mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z};
+                vertex.normal = {mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z};
+
+                if(mesh->HasTangentsAndBitangents()) {
+                    vertex.tangent = {mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z};
+                    vertex.bitangent = {mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z};
+                }
 
-            if(uniqueVertices.count(vertex) == 0){
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+                if(mesh->HasTextureCoords(0)) {
+                    vertex.uv = {mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y};
+                }
                 vertices.push_back(vertex);
             }
 
-            indices.push_back(uniqueVertices[vertex]);
+            uint32_t firstIndex = static_cast<uint32_t>(indices.size());
+            for(unsigned int f = 0; f < mesh->mNumFaces; f++){
+                const aiFace& face = mesh->mFaces[f];
+                if(face.mNumIndices != 3){
+                    continue;
+                }
+                indices.push_back(baseVertex + face.mIndices[0]);
+                indices.push_back(baseVertex + face.mIndices[1]);
+                indices.push_back(baseVertex + face.mIndices[2]);
+            }
+            uint32_t indexCount = static_cast<uint32_t>(indices.size()) - firstIndex;
+
+            if(!submeshes.empty() && submeshes.back().materialIndex == mesh->mMaterialIndex){
+                submeshes.back().indexCount += indexCount;
+            }else{
+                submeshes.push_back(Submesh{firstIndex, indexCount, mesh->mMaterialIndex});
+            }
         }
+        std::cout << "Imported " << meshes.size() << " meshes into " << submeshes.size() << " submeshes" << std::endl;
+    }
 
+    void LveModel::Builder::buildMeshlets(uint32_t maxVertices, uint32_t maxTriangles){
+        assert(maxVertices >= 3 && maxTriangles >= 1 && "Meshlet limits too small");
+        meshlets.clear();
+
+        // id of the last meshlet that referenced each vertex, avoids clearing a set per meshlet
+        std::vector<uint32_t> vertexMeshlet(vertices.size(), std::numeric_limits<uint32_t>::max());
+        uint32_t meshletId = 0;
+        Meshlet meshlet{};
+
+        auto finishMeshlet = [&](){
+            // bounding sphere around the aabb of the cluster
+            glm::vec3 minPos{std::numeric_limits<float>::max()};
+            glm::vec3 maxPos{std::numeric_limits<float>::lowest()};
+            for(uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++){
+                minPos = glm::min(minPos, vertices[indices[i]].position);
+                maxPos = glm::max(maxPos, vertices[indices[i]].position);
+            }
+            meshlet.center = 0.5f * (minPos + maxPos);
+            meshlet.radius = 0.0f;
+            for(uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i++){
+                meshlet.radius = glm::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+            }
 
+            // normal cone from the face normals, see meshoptimizer's meshopt_computeMeshletBounds
+            std::vector<glm::vec3> faceNormals;
+            faceNormals.reserve(meshlet.indexCount / 3);
+            glm::vec3 axis{0.0f};
+            for(uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3){
+                const glm::vec3& p0 = vertices[indices[i + 0]].position;
+                const glm::vec3& p1 = vertices[indices[i + 1]].position;
+                const glm::vec3& p2 = vertices[indices[i + 2]].position;
+                glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(n);
+                if(area <= std::numeric_limits<float>::epsilon()){
+                    continue; // degenerate triangles don't constrain the cone
+                }
+                // rasterization culls nothing, so trust the shading normals over the winding order
+                glm::vec3 shadingNormal = vertices[indices[i + 0]].normal + vertices[indices[i + 1]].normal + vertices[indices[i + 2]].normal;
+                if(glm::dot(n, shadingNormal) < 0.0f){
+                    n = -n;
+                }
+                faceNormals.push_back(n / area);
+                axis += faceNormals.back();
+            }
 
+            meshlet.coneAxis = glm::vec3{0.0f};
+            meshlet.coneCutoff = 1.0f; // never culled
+            float axisLength = glm::length(axis);
+            if(axisLength > 0.0f){
+                axis /= axisLength;
+                float minDot = 1.0f;
+                for(const auto& n : faceNormals){
+                    minDot = glm::min(minDot, glm::dot(axis, n));
+                }
+                // wider than ~84 degrees is too wide to ever reject
+                if(minDot > 0.1f){
+                    meshlet.coneAxis = axis;
+                    meshlet.coneCutoff = glm::sqrt(1.0f - minDot * minDot);
+                }
+            }
+            meshlets.push_back(meshlet);
+        };
+
+        // meshlets never straddle two submeshes
+        size_t nextSubmesh = 0;
+        for(uint32_t i = 0; i + 2 < indices.size(); i += 3){
+            bool submeshStart = false;
+            while(nextSubmesh < submeshes.size() && submeshes[nextSubmesh].firstIndex <= i){
+                submeshStart = submeshStart || submeshes[nextSubmesh].firstIndex == i;
+                nextSubmesh++;
+            }
+
+            auto countNewVertices = [&](){
+                uint32_t count = 0;
+                for(uint32_t k = 0; k < 3; k++){
+                    uint32_t v = indices[i + k];
+                    bool seenInTriangle = (k > 0 && indices[i] == v) || (k > 1 && indices[i + 1] == v);
+                    if(vertexMeshlet[v] != meshletId && !seenInTriangle){
+                        count++;
+                    }
+                }
+                return count;
+            };
+
+            if((submeshStart && meshlet.indexCount > 0) ||
+               meshlet.vertexCount + countNewVertices() > maxVertices || meshlet.indexCount / 3 + 1 > maxTriangles){
+                finishMeshlet();
+                meshletId++;
+                meshlet = Meshlet{};
+                meshlet.firstIndex = i;
+            }
+            if(meshlet.indexCount == 0){
+                meshlet.submeshIndex = nextSubmesh > 0 ? static_cast<uint32_t>(nextSubmesh - 1) : 0;
+            }
+
+            for(uint32_t k = 0; k < 3; k++){
+                uint32_t v = indices[i + k];
+                if(vertexMeshlet[v] != meshletId){
+                    vertexMeshlet[v] = meshletId;
+                    meshlet.vertexCount++;
+                }
+            }
+            meshlet.indexCount += 3;
+        }
+
+        if(meshlet.indexCount > 0){
+            finishMeshlet();
+        }
     }
 
 }
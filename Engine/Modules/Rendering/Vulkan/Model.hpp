@@ -2,6 +2,7 @@
 
 #include "Device.hpp"
 #include "Buffer.hpp"
+#include "SwapChain.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -12,10 +13,14 @@
 
 // std
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace RenderingEngine
 {
+    class MeshCache;
+    class ThreadPool;
+
     class LveModel
     {
     public:
@@ -38,28 +43,170 @@ namespace RenderingEngine
             }
         };
         
+        // 20 byte alternative to Vertex, decoded in pbr_compact.vert
+        // the bitangent is rebuilt from normal and tangent in the shader
+        struct CompactVertex{
+            uint16_t position[4]{}; // unorm16 inside the model bounds, w is the bitangent sign (0 -> -1, 1 -> +1)
+            int16_t normal[2]{};    // octahedral snorm16
+            int16_t tangent[2]{};   // octahedral snorm16
+            uint16_t uv[2]{};       // half float
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        enum class VertexFormat{
+            Standard,
+            Compact
+        };
+
+        // a cluster of triangles that is culled as a whole on the gpu
+        // layout matches the std430 Meshlet struct in meshlet_cull.comp
+        struct Meshlet{
+            glm::vec3 center{};     // bounding sphere
+            float radius{0.0f};
+            glm::vec3 coneAxis{};   // normal cone, cull if dot(normalize(center - eye), axis) >= cutoff
+            float coneCutoff{1.0f};
+            uint32_t firstIndex{0}; // triangle range in the index buffer
+            uint32_t indexCount{0};
+            uint32_t vertexCount{0};
+            uint32_t submeshIndex{0}; // indirect draw the surviving triangles are appended to
+        };
+
+        // a range of the index buffer drawn with one material
+        struct Submesh{
+            uint32_t firstIndex{0};
+            uint32_t indexCount{0};
+            uint32_t materialIndex{0};
+        };
+
+        // texture paths are absolute, an empty path means the default texture
+        struct Material{
+            std::string albedoTexture{};
+            std::string normalTexture{};
+            std::string metallicRoughnessTexture{}; // glTF packing: roughness in G, metallic in B
+            std::string occlusionTexture{}; // R, often the same image as metallicRoughnessTexture (ORM)
+            glm::vec4 baseColorFactor{1.0f};
+            float metallicFactor{1.0f};
+            float roughnessFactor{1.0f};
+        };
+
+        // non owning view of everything the gpu buffers are created from
+        // either points into a Builder or straight into a memory mapped MeshCache
+        struct MeshView{
+            VertexFormat vertexFormat = VertexFormat::Standard;
+            const void* vertices = nullptr;
+            uint32_t vertexSize = 0;
+            uint32_t vertexCount = 0;
+            const void* indices = nullptr;
+            VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+            uint32_t indexCount = 0;
+            const Meshlet* meshlets = nullptr;
+            uint32_t meshletCount = 0;
+            const Submesh* submeshes = nullptr;
+            uint32_t submeshCount = 0;
+            const Material* materials = nullptr;
+            uint32_t materialCount = 0;
+            glm::vec3 boundsMin{0.0f};
+            glm::vec3 boundsMax{1.0f};
+        };
+
+        struct ImportOptions{
+            bool optimizeMesh = true;
+            bool buildMeshlets = false;
+            uint32_t maxMeshletVertices = 64;
+            uint32_t maxMeshletTriangles = 124;
+            bool compactVertices = false;
+        };
+        
         struct Builder
         {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
-            void loadObjModel(const std::string& modelPath);
+            std::vector<Meshlet> meshlets{};
+            std::vector<Submesh> submeshes{};
+            // indexed by Submesh::materialIndex, may be empty when the source has no usable materials
+            std::vector<Material> materials{};
+
+            // filled by compressVertices, vertices is left untouched
+            VertexFormat vertexFormat = VertexFormat::Standard;
+            std::vector<CompactVertex> compactVertices{};
+            glm::vec3 boundsMin{0.0f};
+            glm::vec3 boundsMax{0.0f};
+
+            // threadPool parses large files in parallel, see parseObjFile
+            void loadObjModel(const std::string& modelPath, ThreadPool* threadPool = nullptr);
             void loadFbxModel(const std::string& modelPath);
+            void loadGltfModel(const std::string& modelPath);
+
+            // reorder triangles and vertices for the post-transform cache, overdraw and vertex fetch, see MeshOptimizer.hpp
+            void optimize();
+
+            // encode vertices into the quantized CompactVertex layout and switch vertexFormat to Compact
+            void compressVertices();
+
+            // greedily partition the index buffer into meshlets, each meshlet is a contiguous index range
+            void buildMeshlets(uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
         };
 
-        
+
+        // cpu side result of an import, produced without touching vulkan so it can run on any thread
+        // view points either into builder or into the mapped cache
+        struct MeshData{
+            Builder builder{};
+            std::vector<uint16_t> narrowIndices{};
+            std::shared_ptr<MeshCache> cache{};
+            MeshView view{};
+        };
+        static std::unique_ptr<MeshData> loadMeshData(
+            const std::string& filePath, const ImportOptions& options = {}, ThreadPool* threadPool = nullptr);
+
         LveModel(LveDevice& device, const Builder& builder);
+        LveModel(LveDevice& device, const MeshView& mesh);
         ~LveModel();
         
         LveModel(const LveModel&) = delete;
         LveModel& operator=(const LveModel&) = delete;
         
-        static std::unique_ptr<LveModel> createModelFromFile(LveDevice& device, const std::string& filePath);
+        static std::unique_ptr<LveModel> createModelFromFile(LveDevice& device, const std::string& filePath, const ImportOptions& options = {});
 
         void bind(VkCommandBuffer commandBuffer);
         void draw(VkCommandBuffer commandBuffer);
+        // one batch of a single material, expects bind to have been called
+        void drawSubmesh(VkCommandBuffer commandBuffer, uint32_t submeshIndex);
+
+        const std::vector<Submesh>& getSubmeshes() const { return submeshes; }
+        const std::vector<Material>& getMaterials() const { return materials; }
+        // bytes of device memory held by this model's buffers
+        VkDeviceSize getMemorySize() const;
+
+        VertexFormat getVertexFormat() const { return vertexFormat; }
+        // maps unorm16 compact positions back to model space: position = offset + scale * encoded
+        glm::vec3 getPositionScale() const { return boundsMax - boundsMin; }
+        glm::vec3 getPositionOffset() const { return boundsMin; }
+
+        // meshlet path: the culling pass writes the surviving triangles of each frame into its own index buffer
+        bool hasMeshlets() const { return meshletCount > 0; }
+        uint32_t getMeshletCount() const { return meshletCount; }
+        uint32_t getIndexCount() const { return indexCount; }
+        VkIndexType getIndexType() const { return indexType; }
+        VkDescriptorBufferInfo getMeshletBufferInfo() { return meshletBuffer->descriptorInfo(); }
+        VkDescriptorBufferInfo getIndexBufferInfo() { return indexBuffer->descriptorInfo(); }
+        VkDescriptorBufferInfo getCulledIndexBufferInfo(int frameIndex) { return culledIndexBuffers[frameIndex]->descriptorInfo(); }
+        VkDescriptorBufferInfo getDrawCommandBufferInfo(int frameIndex) { return drawCommandBuffers[frameIndex]->descriptorInfo(); }
+        VkBuffer getDrawCommandBuffer(int frameIndex) const { return drawCommandBuffers[frameIndex]->getBuffer(); }
+        // one empty draw per submesh, copied over the frame's draw commands before culling
+        VkBuffer getDrawCommandResetBuffer() const { return drawCommandResetBuffer->getBuffer(); }
+        VkDeviceSize getDrawCommandsSize() const { return drawCommandResetBuffer->getBufferSize(); }
+
+        void bindCulled(VkCommandBuffer commandBuffer, int frameIndex);
+        // the surviving triangles of one submesh, they keep its range of the culled index buffer
+        void drawCulled(VkCommandBuffer commandBuffer, int frameIndex, uint32_t submeshIndex);
     private:
-        void createVertexBuffer(const std::vector<Vertex>& vertices);
-        void createIndexBuffer(const std::vector<uint32_t>& indices);
+        void createBuffers(const MeshView& mesh);
+        void createVertexBuffer(const void* vertices, uint32_t vertexSize, uint32_t count);
+        void createIndexBuffer(const void* indices, VkIndexType type, uint32_t count);
+        void createMeshletBuffers(const Meshlet* meshlets);
         
         void createIndexBuffer();
         void createUniformBuffers();
@@ -71,9 +218,22 @@ namespace RenderingEngine
         LveDevice& mDevice;
         std::unique_ptr<LveBuffer> vertexBuffer;
         uint32_t vertexCount;
+        VertexFormat vertexFormat = VertexFormat::Standard;
+        glm::vec3 boundsMin{0.0f};
+        glm::vec3 boundsMax{1.0f};
         
         bool hasIndexBuffer = false;
         std::unique_ptr<LveBuffer> indexBuffer;
         uint32_t indexCount;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32; // UINT16 whenever vertexCount allows it
+
+        uint32_t meshletCount = 0;
+        std::unique_ptr<LveBuffer> meshletBuffer;
+        std::vector<std::unique_ptr<LveBuffer>> culledIndexBuffers;
+        std::vector<std::unique_ptr<LveBuffer>> drawCommandBuffers;
+        std::unique_ptr<LveBuffer> drawCommandResetBuffer;
+
+        std::vector<Submesh> submeshes;
+        std::vector<Material> materials;
     };
 }
\ No newline at end of file
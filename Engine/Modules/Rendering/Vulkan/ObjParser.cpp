@@ -0,0 +1,401 @@
+#include "ObjParser.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "VertexWelder.hpp"
+
+// std
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint32_t MISSING = std::numeric_limits<uint32_t>::max();
+        // below this a single thread is faster than handing chunks to workers
+        constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+        // attribute indices of one triangle corner, resolved to 0 based global indices
+        struct ObjCorner
+        {
+            uint32_t position;
+            uint32_t texcoord;
+            uint32_t normal;
+        };
+
+        struct ObjChunk
+        {
+            const char* begin;
+            const char* end;
+
+            size_t positionCount = 0;
+            size_t texcoordCount = 0;
+            size_t normalCount = 0;
+            size_t positionBase = 0;
+            size_t texcoordBase = 0;
+            size_t normalBase = 0;
+
+            std::vector<ObjCorner> corners;
+            // corner offset at which a usemtl switched material
+            std::vector<std::pair<size_t, std::string>> materialRuns;
+            std::string error;
+        };
+
+        // attribute arrays shared by all chunks, each chunk writes its own slice
+        struct ObjAttributes
+        {
+            std::vector<float> positions;
+            std::vector<float> texcoords;
+            std::vector<float> normals;
+        };
+
+        bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+        const char* skipBlanks(const char* p, const char* end)
+        {
+            while (p < end && isBlank(*p)) p++;
+            return p;
+        }
+
+        const char* lineEnd(const char* p, const char* end)
+        {
+            const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+            return newline ? static_cast<const char*>(newline) : end;
+        }
+
+        enum class LineType { Other, Position, Texcoord, Normal, Face, UseMaterial };
+
+        LineType classify(const char* p, const char* end)
+        {
+            if (p + 1 >= end) return LineType::Other;
+            if (p[0] == 'v')
+            {
+                if (isBlank(p[1])) return LineType::Position;
+                if (p[1] == 't' && p + 2 < end && isBlank(p[2])) return LineType::Texcoord;
+                if (p[1] == 'n' && p + 2 < end && isBlank(p[2])) return LineType::Normal;
+                return LineType::Other;
+            }
+            if (p[0] == 'f' && isBlank(p[1])) return LineType::Face;
+            if (end - p > 7 && std::string_view{p, 7} == "usemtl " ) return LineType::UseMaterial;
+            return LineType::Other;
+        }
+
+        const char* parseFloats(const char* p, const char* end, float* out, size_t count, size_t required)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                p = skipBlanks(p, end);
+                if (p < end && *p == '+') p++;
+                auto result = std::from_chars(p, end, out[i]);
+                if (result.ec != std::errc{})
+                {
+                    if (i < required) return nullptr;
+                    out[i] = 0.0f;
+                    continue;
+                }
+                p = result.ptr;
+            }
+            return p;
+        }
+
+        // OBJ indices are 1 based, negative ones count back from the last attribute read so far
+        bool resolveIndex(long long index, size_t readSoFar, uint32_t& out)
+        {
+            if (index > 0)
+            {
+                out = static_cast<uint32_t>(index - 1);
+                return true;
+            }
+            if (index < 0 && static_cast<size_t>(-index) <= readSoFar)
+            {
+                out = static_cast<uint32_t>(static_cast<long long>(readSoFar) + index);
+                return true;
+            }
+            return false;
+        }
+
+        void countChunk(ObjChunk& chunk)
+        {
+            for (const char* p = chunk.begin; p < chunk.end;)
+            {
+                const char* end = lineEnd(p, chunk.end);
+                switch (classify(skipBlanks(p, end), end))
+                {
+                    case LineType::Position: chunk.positionCount++; break;
+                    case LineType::Texcoord: chunk.texcoordCount++; break;
+                    case LineType::Normal: chunk.normalCount++; break;
+                    default: break;
+                }
+                p = end + 1;
+            }
+        }
+
+        void parseChunk(ObjChunk& chunk, ObjAttributes& attributes)
+        {
+            size_t positions = chunk.positionBase;
+            size_t texcoords = chunk.texcoordBase;
+            size_t normals = chunk.normalBase;
+            std::vector<ObjCorner> polygon;
+
+            for (const char* p = chunk.begin; p < chunk.end;)
+            {
+                const char* end = lineEnd(p, chunk.end);
+                // trailing \r of windows line endings
+                const char* contentEnd = end > p && end[-1] == '\r' ? end - 1 : end;
+                const char* line = skipBlanks(p, contentEnd);
+                p = end + 1;
+
+                switch (classify(line, contentEnd))
+                {
+                    case LineType::Position:
+                        if (!parseFloats(line + 1, contentEnd, &attributes.positions[positions * 3], 3, 3))
+                        {
+                            chunk.error = "Malformed vertex position";
+                            return;
+                        }
+                        positions++;
+                        break;
+                    case LineType::Texcoord:
+                        if (!parseFloats(line + 2, contentEnd, &attributes.texcoords[texcoords * 2], 2, 1))
+                        {
+                            chunk.error = "Malformed texture coordinate";
+                            return;
+                        }
+                        texcoords++;
+                        break;
+                    case LineType::Normal:
+                        if (!parseFloats(line + 2, contentEnd, &attributes.normals[normals * 3], 3, 3))
+                        {
+                            chunk.error = "Malformed vertex normal";
+                            return;
+                        }
+                        normals++;
+                        break;
+                    case LineType::Face:
+                    {
+                        polygon.clear();
+                        const char* q = line + 1;
+                        while (true)
+                        {
+                            q = skipBlanks(q, contentEnd);
+                            if (q >= contentEnd) break;
+
+                            long long index = 0;
+                            auto result = std::from_chars(q, contentEnd, index);
+                            ObjCorner corner{MISSING, MISSING, MISSING};
+                            if (result.ec != std::errc{} || !resolveIndex(index, positions, corner.position))
+                            {
+                                chunk.error = "Malformed face";
+                                return;
+                            }
+                            q = result.ptr;
+                            if (q < contentEnd && *q == '/')
+                            {
+                                q++;
+                                if (q < contentEnd && *q != '/')
+                                {
+                                    result = std::from_chars(q, contentEnd, index);
+                                    if (result.ec != std::errc{} || !resolveIndex(index, texcoords, corner.texcoord))
+                                    {
+                                        chunk.error = "Malformed face";
+                                        return;
+                                    }
+                                    q = result.ptr;
+                                }
+                                if (q < contentEnd && *q == '/')
+                                {
+                                    q++;
+                                    result = std::from_chars(q, contentEnd, index);
+                                    if (result.ec != std::errc{} || !resolveIndex(index, normals, corner.normal))
+                                    {
+                                        chunk.error = "Malformed face";
+                                        return;
+                                    }
+                                    q = result.ptr;
+                                }
+                            }
+                            polygon.push_back(corner);
+                        }
+                        // fan triangulation, same as tinyobj's default
+                        for (size_t i = 2; i < polygon.size(); i++)
+                        {
+                            chunk.corners.push_back(polygon[0]);
+                            chunk.corners.push_back(polygon[i - 1]);
+                            chunk.corners.push_back(polygon[i]);
+                        }
+                        break;
+                    }
+                    case LineType::UseMaterial:
+                    {
+                        const char* name = skipBlanks(line + 7, contentEnd);
+                        const char* nameEnd = contentEnd;
+                        while (nameEnd > name && isBlank(nameEnd[-1])) nameEnd--;
+                        chunk.materialRuns.emplace_back(chunk.corners.size(), std::string{name, nameEnd});
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+        }
+
+        template <typename Function>
+        void forEachChunk(std::vector<ObjChunk>& chunks, ThreadPool* threadPool, Function&& function)
+        {
+            if (threadPool == nullptr || chunks.size() == 1)
+            {
+                for (auto& chunk : chunks)
+                {
+                    function(chunk);
+                }
+                return;
+            }
+            threadPool->parallelFor(chunks.size(), [&](size_t index) { function(chunks[index]); });
+        }
+    }
+
+    void parseObjFile(const std::string& filePath, LveModel::Builder& builder, ThreadPool* threadPool)
+    {
+        MappedFile file{filePath};
+        if (!file.isOpen())
+        {
+            throw std::runtime_error("Failed to open model: " + filePath);
+        }
+        const char* data = reinterpret_cast<const char*>(file.data());
+        const char* dataEnd = data + file.size();
+
+        // the workers plus the calling thread
+        size_t threadCount = threadPool ? threadPool->getThreadCount() + 1 : 1;
+        size_t chunkCount = std::clamp<size_t>(file.size() / MIN_CHUNK_SIZE, 1, threadCount);
+
+        // cut at line starts so no line is split between two chunks
+        std::vector<ObjChunk> chunks(chunkCount);
+        const char* begin = data;
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            const char* end = i + 1 == chunkCount ? dataEnd : data + file.size() * (i + 1) / chunkCount;
+            end = std::max(end, begin);
+            if (end < dataEnd)
+            {
+                end = lineEnd(end, dataEnd);
+                end = end < dataEnd ? end + 1 : end;
+            }
+            chunks[i].begin = begin;
+            chunks[i].end = end;
+            begin = end;
+        }
+
+        forEachChunk(chunks, threadPool, countChunk);
+
+        size_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+        for (auto& chunk : chunks)
+        {
+            chunk.positionBase = positionCount;
+            chunk.texcoordBase = texcoordCount;
+            chunk.normalBase = normalCount;
+            positionCount += chunk.positionCount;
+            texcoordCount += chunk.texcoordCount;
+            normalCount += chunk.normalCount;
+        }
+
+        ObjAttributes attributes;
+        attributes.positions.resize(positionCount * 3);
+        attributes.texcoords.resize(texcoordCount * 2);
+        attributes.normals.resize(normalCount * 3);
+
+        forEachChunk(chunks, threadPool, [&attributes](ObjChunk& chunk) { parseChunk(chunk, attributes); });
+        for (const auto& chunk : chunks)
+        {
+            if (!chunk.error.empty())
+            {
+                throw std::runtime_error(chunk.error + " in " + filePath);
+            }
+        }
+
+        // weld in file order, triangles are bucketed by material and concatenated into submeshes afterwards
+        builder.vertices.clear();
+        builder.indices.clear();
+        builder.submeshes.clear();
+        VertexWelder welder{builder.vertices, positionCount};
+
+        // material ids in order of first use, faces before any usemtl get the unnamed material
+        std::unordered_map<std::string, uint32_t> materialIds;
+        std::vector<std::vector<uint32_t>> materialIndices;
+        auto materialId = [&](const std::string& name) {
+            auto [it, inserted] = materialIds.try_emplace(name, static_cast<uint32_t>(materialIndices.size()));
+            if (inserted)
+            {
+                materialIndices.emplace_back();
+            }
+            return it->second;
+        };
+        uint32_t material = MISSING;
+
+        for (auto& chunk : chunks)
+        {
+            size_t run = 0;
+            for (size_t c = 0; c < chunk.corners.size(); c++)
+            {
+                while (run < chunk.materialRuns.size() && chunk.materialRuns[run].first == c)
+                {
+                    material = materialId(chunk.materialRuns[run].second);
+                    run++;
+                }
+                if (material == MISSING)
+                {
+                    material = materialId("");
+                }
+
+                const ObjCorner& corner = chunk.corners[c];
+                if (corner.position >= positionCount ||
+                    (corner.texcoord != MISSING && corner.texcoord >= texcoordCount) ||
+                    (corner.normal != MISSING && corner.normal >= normalCount))
+                {
+                    throw std::runtime_error("Face index out of range in " + filePath);
+                }
+
+                LveModel::Vertex vertex{};
+                const float* position = &attributes.positions[corner.position * 3];
+                vertex.position = {position[0], position[1], position[2]};
+                if (corner.normal != MISSING)
+                {
+                    const float* normal = &attributes.normals[corner.normal * 3];
+                    vertex.normal = {normal[0], normal[1], normal[2]};
+                }
+                if (corner.texcoord != MISSING)
+                {
+                    const float* texcoord = &attributes.texcoords[corner.texcoord * 2];
+                    vertex.uv = {texcoord[0], 1.0f - texcoord[1]};
+                }
+                materialIndices[material].push_back(welder.weld(vertex));
+            }
+            // a usemtl after the chunk's last face applies to the faces of the next chunk
+            for (; run < chunk.materialRuns.size(); run++)
+            {
+                material = materialId(chunk.materialRuns[run].second);
+            }
+            // the corners are no longer needed, release them before the next chunk grows the output
+            std::vector<ObjCorner>{}.swap(chunk.corners);
+        }
+
+        size_t indexCount = 0;
+        for (const auto& list : materialIndices)
+        {
+            indexCount += list.size();
+        }
+        builder.indices.reserve(indexCount);
+        for (uint32_t id = 0; id < materialIndices.size(); id++)
+        {
+            if (materialIndices[id].empty()) continue;
+            builder.submeshes.push_back(LveModel::Submesh{
+                static_cast<uint32_t>(builder.indices.size()), static_cast<uint32_t>(materialIndices[id].size()), id});
+            builder.indices.insert(builder.indices.end(), materialIndices[id].begin(), materialIndices[id].end());
+            std::vector<uint32_t>{}.swap(materialIndices[id]);
+        }
+    }
+}
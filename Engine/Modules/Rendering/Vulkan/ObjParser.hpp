@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Model.hpp"
+
+// std
+#include <string>
+
+namespace RenderingEngine
+{
+    class ThreadPool;
+
+    /*************************************************
+    Wavefront OBJ reader replacing tinyobj::LoadObj
+    The file is memory mapped and cut into line aligned chunks, parsed on threadPool's workers and the calling thread
+    (ThreadPool::parallelFor) or on the calling thread alone without a pool:
+    1. every chunk counts its v / vt / vn lines, a prefix sum gives each chunk its slot in the attribute arrays
+    2. every chunk parses floats with std::from_chars straight into those slots and collects its face corners
+    3. the corners are welded into builder.vertices in file order, one submesh per usemtl material
+    Faces are fan triangulated. Supports v, vt, vn, f (all index forms, negative indices) and usemtl.
+    *************************************************/
+    void parseObjFile(const std::string& filePath, LveModel::Builder& builder, ThreadPool* threadPool = nullptr);
+}
@@ -0,0 +1,207 @@
+#include "PixelConversion.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__F16C__) || defined(__AVX2__)
+#define RE_PIXEL_F16C 1
+#define RE_PIXEL_SSSE3 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RE_PIXEL_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#define RE_PIXEL_SSSE3 1
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr float HALF_MAX = 65504.0f;
+
+        // round to nearest even with the exponent rebias and a magic add for subnormals,
+        // the SSE2 path below is the same sequence on four lanes
+        uint16_t floatToHalf(float value)
+        {
+            value = std::max(std::min(value, HALF_MAX), -HALF_MAX);
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            uint32_t sign = bits & 0x80000000u;
+            bits ^= sign;
+
+            uint32_t half;
+            if (bits > 0x7F800000u)
+            {
+                half = 0x7E00; // nan
+            }
+            else if (bits < (113u << 23))
+            {
+                // the result is subnormal or zero, the float add aligns the mantissa and rounds it
+                const uint32_t magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+                float magic;
+                std::memcpy(&magic, &magicBits, sizeof(magic));
+                float shifted;
+                std::memcpy(&shifted, &bits, sizeof(shifted));
+                shifted += magic;
+                std::memcpy(&bits, &shifted, sizeof(bits));
+                half = bits - magicBits;
+            }
+            else
+            {
+                uint32_t mantissaOdd = (bits >> 13) & 1;
+                bits += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+                bits += mantissaOdd;
+                half = bits >> 13;
+            }
+            return static_cast<uint16_t>(half | (sign >> 16));
+        }
+
+#if RE_PIXEL_SSE2
+        __m128i floatToHalf4(__m128 value)
+        {
+            const __m128 halfMax = _mm_set1_ps(HALF_MAX);
+            const __m128i minNormal = _mm_set1_epi32(113 << 23);
+            const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+            const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+            __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+            __m128 absolute = _mm_xor_ps(value, sign);
+            __m128 isNan = _mm_cmpunord_ps(absolute, absolute);
+            absolute = _mm_min_ps(absolute, halfMax);
+            __m128i absoluteBits = _mm_castps_si128(absolute);
+
+            __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absoluteBits);
+            __m128i subnormal = _mm_sub_epi32(
+                _mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+            __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absoluteBits, 31 - 13), 31);
+            __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absoluteBits, normalBias), mantissaOdd), 13);
+
+            __m128i half = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+            half = _mm_or_si128(
+                _mm_andnot_si128(_mm_castps_si128(isNan), half), _mm_and_si128(_mm_castps_si128(isNan), _mm_set1_epi32(0x7E00)));
+            // sign extended so the signed pack below keeps all 16 bits
+            return _mm_or_si128(half, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+        }
+#endif
+    }
+
+    void convertFloatToHalf(const float* src, uint16_t* dst, size_t count)
+    {
+        size_t i = 0;
+#if RE_PIXEL_F16C
+        const __m256 halfMax = _mm256_set1_ps(HALF_MAX);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 value = _mm256_loadu_ps(src + i);
+            // min / max return their second operand for nan, which keeps a nan input
+            value = _mm256_max_ps(_mm256_sub_ps(_mm256_setzero_ps(), halfMax), _mm256_min_ps(halfMax, value));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+        }
+#elif RE_PIXEL_SSE2
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i low = floatToHalf4(_mm_loadu_ps(src + i));
+            __m128i high = floatToHalf4(_mm_loadu_ps(src + i + 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(low, high));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            dst[i] = floatToHalf(src[i]);
+        }
+    }
+
+    void expandToRgba8(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount)
+    {
+        size_t i = 0;
+        switch (channels)
+        {
+        case 4:
+            std::memcpy(dst, src, pixelCount * 4);
+            return;
+        case 3:
+#if RE_PIXEL_SSSE3
+        {
+            // four pixels per step, the 16 byte load reads 4 bytes past them so the last 6 pixels are scalar
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+            for (; i + 6 <= pixelCount; i += 4)
+            {
+                __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+            }
+        }
+#endif
+            // one unaligned little endian 32 bit load per pixel picks up the next pixel's red as alpha, which is then overwritten;
+            // the last pixel has no byte after it
+            for (; i + 1 < pixelCount; i++)
+            {
+                uint32_t texel;
+                std::memcpy(&texel, src + i * 3, sizeof(texel));
+                texel = (texel & 0x00FFFFFFu) | 0xFF000000u;
+                std::memcpy(dst + i * 4, &texel, sizeof(texel));
+            }
+            for (; i < pixelCount; i++)
+            {
+                dst[i * 4 + 0] = src[i * 3 + 0];
+                dst[i * 4 + 1] = src[i * 3 + 1];
+                dst[i * 4 + 2] = src[i * 3 + 2];
+                dst[i * 4 + 3] = 255;
+            }
+            return;
+        case 2:
+#if RE_PIXEL_F16C || RE_PIXEL_SSE2
+        {
+            // gray alpha pairs as 16 bit lanes: (g | g << 8) in the low half of each pixel, the pair itself in the high half
+            const __m128i lowByte = _mm_set1_epi16(0x00FF);
+            for (; i + 8 <= pixelCount; i += 8)
+            {
+                __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                __m128i gray = _mm_and_si128(pairs, lowByte);
+                gray = _mm_or_si128(gray, _mm_slli_epi16(gray, 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi16(gray, pairs));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), _mm_unpackhi_epi16(gray, pairs));
+            }
+        }
+#endif
+            for (; i < pixelCount; i++)
+            {
+                dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i * 2];
+                dst[i * 4 + 3] = src[i * 2 + 1];
+            }
+            return;
+        case 1:
+#if RE_PIXEL_F16C || RE_PIXEL_SSE2
+        {
+            const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+            for (; i + 16 <= pixelCount; i += 16)
+            {
+                __m128i gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i grayGray[2] = {_mm_unpacklo_epi8(gray, gray), _mm_unpackhi_epi8(gray, gray)};
+                __m128i grayAlpha[2] = {_mm_unpacklo_epi8(gray, opaque), _mm_unpackhi_epi8(gray, opaque)};
+                for (int half = 0; half < 2; half++)
+                {
+                    __m128i* out = reinterpret_cast<__m128i*>(dst + (i + half * 8) * 4);
+                    _mm_storeu_si128(out, _mm_unpacklo_epi16(grayGray[half], grayAlpha[half]));
+                    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayGray[half], grayAlpha[half]));
+                }
+            }
+        }
+#endif
+            for (; i < pixelCount; i++)
+            {
+                dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+                dst[i * 4 + 3] = 255;
+            }
+            return;
+        default:
+            assert(false && "8 bit images have 1 to 4 channels");
+        }
+    }
+}
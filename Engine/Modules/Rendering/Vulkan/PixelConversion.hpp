@@ -0,0 +1,24 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    CPU pixel format conversions used while decoding textures, safe to call from any thread
+    - F16C when the compiler targets it (AVX2 builds), SSE2 on any other x64 build, scalar otherwise;
+      rgb expansion shuffles with SSSE3 when the compiler targets it (every F16C target has it), 32 bit loads otherwise
+    - every path rounds to nearest even and produces the same bits
+    *************************************************/
+
+    // float32 -> IEEE half, values beyond the half range saturate to +-65504 instead of becoming infinity
+    // so a bright sun in an HDR image does not turn into inf in the filtered mips, NaN stays NaN
+    void convertFloatToHalf(const float* src, uint16_t* dst, size_t count);
+
+    // 8 bit gray (1), gray alpha (2), rgb (3) or rgba (4) pixels -> rgba, what stbi_load does when asked for 4 channels:
+    // gray is replicated into rgb and a missing alpha is opaque; bytes are copied as is, so srgb data stays srgb
+    // and is decoded by the sampler of an _SRGB format
+    void expandToRgba8(const uint8_t* src, uint32_t channels, uint8_t* dst, size_t pixelCount);
+}
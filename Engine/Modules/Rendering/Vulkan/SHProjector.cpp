@@ -0,0 +1,239 @@
+#include "SHProjector.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        // local size of sh_project.comp
+        constexpr uint32_t GROUP_SIZE = 8;
+        constexpr uint32_t MAX_GROUPS =
+            (SHProjector::MAX_FACE_SIZE / GROUP_SIZE) * (SHProjector::MAX_FACE_SIZE / GROUP_SIZE) * 6;
+        // 9 coefficients and the covered solid angle
+        constexpr VkDeviceSize PARTIAL_SIZE = 10 * sizeof(glm::vec4);
+
+        struct PushConstants
+        {
+            float level;
+            uint32_t faceSize;
+            uint32_t groupCount;
+        };
+
+        std::vector<char> readFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::ate | std::ios::binary);
+            if (!file.is_open())
+            {
+                throw std::runtime_error("failed to open file: " + filename);
+            }
+            std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(buffer.data(), buffer.size());
+            return buffer;
+        }
+
+        void memoryBarrier(
+            VkCommandBuffer commandBuffer, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+            VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+            vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+    }
+
+    SHProjector::SHProjector(LveDevice& device) : mDevice{device} {}
+
+    SHProjector::~SHProjector()
+    {
+        vkDestroyPipeline(mDevice.device(), projectPipeline, nullptr);
+        vkDestroyPipeline(mDevice.device(), reducePipeline, nullptr);
+        vkDestroyShaderModule(mDevice.device(), projectModule, nullptr);
+        vkDestroyShaderModule(mDevice.device(), reduceModule, nullptr);
+        vkDestroyPipelineLayout(mDevice.device(), pipelineLayout, nullptr);
+    }
+
+    SHCoefficients SHProjector::project(const LveTexture& environment)
+    {
+        if (projectPipeline == VK_NULL_HANDLE)
+        {
+            createPipelines();
+        }
+
+        LveBuffer readback{
+            mDevice, sizeof(SHCoefficients), 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        readback.map();
+
+        // waits for the queue, the set is free and the copy visible to the host after this
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        record(commandBuffer, environment, *bakePool, readback.getBuffer(), 0);
+        mDevice.endSingleTimeCommands(commandBuffer);
+        bakePool->resetPool();
+
+        SHCoefficients result;
+        std::memcpy(result.data(), readback.getMappedMemory(), sizeof(SHCoefficients));
+        return result;
+    }
+
+    void SHProjector::record(
+        VkCommandBuffer commandBuffer, const LveTexture& environment, LveDescriptorPool& descriptorPool, VkBuffer target,
+        VkDeviceSize targetOffset)
+    {
+        if (environment.getLayerCount() != 6)
+        {
+            throw std::runtime_error("spherical harmonics are projected from cube maps");
+        }
+        if (projectPipeline == VK_NULL_HANDLE)
+        {
+            createPipelines();
+        }
+
+        // the finest level small enough, point sampled at a coarser grid if the chain stops above it
+        PushConstants push{};
+        uint32_t level = 0;
+        uint32_t faceSize = environment.getExtent().width;
+        while (faceSize > MAX_FACE_SIZE && level + 1 < environment.getMipLevels())
+        {
+            faceSize = std::max(faceSize / 2, 1u);
+            level++;
+        }
+        push.level = static_cast<float>(level);
+        push.faceSize = std::min(faceSize, MAX_FACE_SIZE);
+        uint32_t groups = (push.faceSize + GROUP_SIZE - 1) / GROUP_SIZE;
+        push.groupCount = groups * groups * 6;
+
+        VkDescriptorImageInfo input{sampler, environment.getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkDescriptorBufferInfo partialsInfo = partials->descriptorInfo();
+        VkDescriptorBufferInfo coefficientsInfo = coefficients->descriptorInfo();
+        VkDescriptorSet descriptorSet;
+        if (!LveDescriptorWriter(*setLayout, descriptorPool)
+                 .writeImage(0, &input)
+                 .writeBuffer(1, &partialsInfo)
+                 .writeBuffer(2, &coefficientsInfo)
+                 .build(descriptorSet))
+        {
+            throw std::runtime_error("failed to allocate spherical harmonics descriptor set");
+        }
+
+        // the previous projection may still be reading the scratch buffers
+        memoryBarrier(
+            commandBuffer, 0, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, projectPipeline);
+        vkCmdDispatch(commandBuffer, groups, groups, 6);
+
+        memoryBarrier(
+            commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline);
+        vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+        memoryBarrier(
+            commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkBufferCopy region{0, targetOffset, sizeof(SHCoefficients)};
+        vkCmdCopyBuffer(commandBuffer, coefficients->getBuffer(), target, 1, &region);
+        // a frame's uniform buffer or project's readback
+        memoryBarrier(
+            commandBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_HOST_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT);
+    }
+
+    void SHProjector::createPipelines()
+    {
+        setLayout = LveDescriptorSetLayout::Builder(mDevice)
+                        .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)   // environment
+                        .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)   // partials
+                        .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)   // coefficients
+                        .build();
+        bakePool = LveDescriptorPool::Builder(mDevice)
+                       .setMaxSets(1)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2)
+                       .build();
+
+        partials = std::make_unique<LveBuffer>(
+            mDevice, PARTIAL_SIZE, MAX_GROUPS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        coefficients = std::make_unique<LveBuffer>(
+            mDevice, sizeof(SHCoefficients), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // texel centers of one level, no filtering across levels
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+        sampler = mDevice.getSampler(samplerInfo);
+
+        // both passes share the layout and the push constants
+        VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PushConstants);
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(mDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create spherical harmonics pipeline layout");
+        }
+
+        struct Stage
+        {
+            const char* path;
+            VkShaderModule& module;
+            VkPipeline& pipeline;
+        };
+        Stage stages[] = {{PROJECT_SHADER, projectModule, projectPipeline}, {REDUCE_SHADER, reduceModule, reducePipeline}};
+        for (Stage& stage : stages)
+        {
+            std::vector<char> code = readFile(stage.path);
+            VkShaderModuleCreateInfo moduleInfo{};
+            moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            moduleInfo.codeSize = code.size();
+            moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+            if (vkCreateShaderModule(mDevice.device(), &moduleInfo, nullptr, &stage.module) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create shader module");
+            }
+
+            VkComputePipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.layout = pipelineLayout;
+            pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfo.stage.module = stage.module;
+            pipelineInfo.stage.pName = "main";
+            if (vkCreateComputePipelines(mDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &stage.pipeline) !=
+                VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create spherical harmonics compute pipeline");
+            }
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+#include "Texture.hpp"
+
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace RenderingEngine
+{
+    // rgb of each L2 coefficient, w unused: the std140 array of GlobalUbo::irradianceSH that sh.glsl evaluates
+    using SHCoefficients = std::array<glm::vec4, 9>;
+
+    /*************************************************
+    Projects an environment cube onto L2 spherical harmonics of its diffuse irradiance (sh.glsl)
+    - sh_project.comp: a workgroup per 8x8 texels of each face of the finest level at most MAX_FACE_SIZE wide,
+      it sums radiance * basis * solid angle in shared memory into one partial
+    - sh_reduce.comp: a single workgroup adds the partials up and convolves them with the clamped cosine
+    project bakes once and reads the 9 coefficients back; record projects on a frame's command buffer straight into
+    a uniform buffer, cheap enough to re-project a dynamic environment every frame.
+    *************************************************/
+    class SHProjector
+    {
+    public:
+        // 384 workgroups, plenty for light of this low a frequency
+        static constexpr uint32_t MAX_FACE_SIZE = 64;
+        static constexpr const char* PROJECT_SHADER = "E:/Projects/VulkanEngine/build/ShaderBin/sh_project.comp.spv";
+        static constexpr const char* REDUCE_SHADER = "E:/Projects/VulkanEngine/build/ShaderBin/sh_reduce.comp.spv";
+
+        explicit SHProjector(LveDevice& device);
+        ~SHProjector();
+
+        SHProjector(const SHProjector&) = delete;
+        SHProjector& operator=(const SHProjector&) = delete;
+
+        // environment: a cube in SHADER_READ_ONLY_OPTIMAL; waits for the graphics queue
+        SHCoefficients project(const LveTexture& environment);
+        // outside a render pass, the set is allocated from descriptorPool; target needs TRANSFER_DST usage,
+        // the coefficients written at targetOffset are visible to uniform reads of the graphics stages afterwards.
+        // Projections share their scratch buffers, one waits for the previous one
+        void record(
+            VkCommandBuffer commandBuffer, const LveTexture& environment, LveDescriptorPool& descriptorPool,
+            VkBuffer target, VkDeviceSize targetOffset);
+
+    private:
+        void createPipelines();
+
+        LveDevice& mDevice;
+
+        std::unique_ptr<LveDescriptorSetLayout> setLayout;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkShaderModule projectModule = VK_NULL_HANDLE;
+        VkShaderModule reduceModule = VK_NULL_HANDLE;
+        VkPipeline projectPipeline = VK_NULL_HANDLE;
+        VkPipeline reducePipeline = VK_NULL_HANDLE;
+        // the set of project, reset after each
+        std::unique_ptr<LveDescriptorPool> bakePool;
+        VkSampler sampler = VK_NULL_HANDLE;
+
+        // 10 vec4 per workgroup of sh_project.comp, the coefficients sh_reduce.comp writes
+        std::unique_ptr<LveBuffer> partials;
+        std::unique_ptr<LveBuffer> coefficients;
+    };
+}
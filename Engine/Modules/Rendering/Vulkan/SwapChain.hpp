@@ -1,5 +1,6 @@
 #pragma once
 
+#include "AttachmentAllocator.hpp"
 #include "Device.hpp"
 
 // vulkan headers
@@ -69,9 +70,9 @@ class LveSwapChain {
   std::vector<VkFramebuffer> swapChainFramebuffers;
   VkRenderPass renderPass;
 
-  std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
-  std::vector<VkImageView> depthImageViews;
+  // render targets that only live inside the render pass, one set shared by every framebuffer
+  std::unique_ptr<AttachmentAllocator> attachmentAllocator;
+  uint32_t depthAttachment = 0;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
@@ -1,15 +1,73 @@
 ﻿#include "Texture.hpp"
+#include "KtxLoader.hpp"
+#include "PixelConversion.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../../External/stb_image.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <stdexcept>
 
 namespace RenderingEngine{
-    LveTexture::LveTexture(LveDevice &device, const std::string &textureFilepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout) : mDevice{device} {
-        createTextureImage(textureFilepath, format, viewType, layout);
-        createTextureImageView(viewType);
+    LveTexture::LveTexture(LveDevice &device, const std::string &textureFilepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+                           VkComponentMapping components, MipFilter mipFilter)
+        : LveTexture(device, loadImageData(textureFilepath), format, viewType, layout, components, mipFilter) {}
+
+    LveTexture::LveTexture(LveDevice &device, const ImageData &image, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+                           VkComponentMapping components, MipFilter mipFilter) : mDevice{device} {
+        createTextureImage(image, format, viewType, layout, mipFilter);
+        createTextureImageView(viewType, components);
+        createTextureSampler();
+        updateDescriptor();
+    }
+
+    LveTexture::LveTexture(LveDevice &device, const ImageData &image, VkImageViewType viewType, VkComponentMapping components,
+                           uint32_t residentLevel) : mDevice{device} {
+        assert(residentLevel < std::max<size_t>(image.levelOffsets.size(), 1) && "Resident level outside the stored chain");
+        createTextureImage(image, image.format, viewType, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, MipFilter::None, residentLevel);
+        createTextureImageView(viewType, components);
+        createTextureSampler();
+        updateDescriptor();
+    }
+
+    LveTexture::LveTexture(LveDevice &device, VkFormat format, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+                           VkImageViewType viewType, VkImageLayout layout) : mDevice{device} {
+        mFormat = format;
+        mTextureLayout = layout;
+        mViewType = viewType;
+        mMipLevels = mipLevels;
+        mLayerCount = layerCount;
+        mExtent = {extent.width, extent.height, 1};
+        mChainExtent = mExtent;
+
+        if (viewType == VK_IMAGE_VIEW_TYPE_CUBE && layerCount % 6 != 0) {
+            throw std::runtime_error("cube views need 6 layers");
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        if (viewType == VK_IMAGE_VIEW_TYPE_CUBE) {
+            imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        }
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = mExtent;
+        imageInfo.mipLevels = mMipLevels;
+        imageInfo.arrayLayers = mLayerCount;
+        imageInfo.format = mFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        // written by compute where the format allows it (block compressed ones don't), by blits and copies otherwise
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        if (mDevice.isFormatSupported(mFormat, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+            imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        }
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        mDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mTextureImage, mTextureImageMemory);
+
+        createTextureImageView(viewType, {});
         createTextureSampler();
         updateDescriptor();
     }
@@ -86,9 +144,7 @@ namespace RenderingEngine{
         samplerInfo.maxLod = 1.0f;
         samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
 
-        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &mTextureSampler) != VK_SUCCESS) {
-          throw std::runtime_error("Failed to create sampler!");
-        }
+        mTextureSampler = device.getSampler(samplerInfo);
 
         VkImageLayout samplerImageLayout = imageLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
                                                ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
@@ -100,7 +156,7 @@ namespace RenderingEngine{
     }
 
     LveTexture::~LveTexture() {
-        vkDestroySampler(mDevice.device(), mTextureSampler, nullptr);
+        // the sampler belongs to the device's cache
         vkDestroyImageView(mDevice.device(), mTextureImageView, nullptr);
         vkDestroyImage(mDevice.device(), mTextureImage, nullptr);
         vkFreeMemory(mDevice.device(), mTextureImageMemory, nullptr);
@@ -110,9 +166,17 @@ namespace RenderingEngine{
                                                                   const std::string &filepath,
                                                                   VkFormat format,
                                                                   VkImageViewType viewType,
-                                                                  VkImageLayout layout) {
+                                                                  VkImageLayout layout,
+                                                                  VkComponentMapping components,
+                                                                  MipFilter mipFilter) {
 
-        return std::make_unique<LveTexture>(device, filepath, format, viewType, layout);
+        return std::make_unique<LveTexture>(device, filepath, format, viewType, layout, components, mipFilter);
+    }
+
+    VkDeviceSize LveTexture::getMemorySize() const {
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(mDevice.device(), mTextureImage, &memRequirements);
+        return memRequirements.size;
     }
 
     void LveTexture::updateDescriptor() {
@@ -121,53 +185,138 @@ namespace RenderingEngine{
         mDescriptor.imageLayout = mTextureLayout;
     }
 
-    void LveTexture::createTextureImage(const std::string &filepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout) {
+    LveTexture::ImageData LveTexture::loadImageData(const std::string &filepath, LveDevice *stagingDevice) {
+        // block compressed files go to the gpu as stored
+        if (isKtx2File(filepath)) {
+            return parseKtx2File(filepath);
+        }
+
         int texWidth, texHeight, texChannels;
-        
-        stbi_uc *pixels;
-        // read as default RGBA
+        ImageData image{};
+
+        // where the converted pixels go: mapped staging memory if there is a device to create it on, the heap otherwise
+        auto allocate = [&image, stagingDevice](VkDeviceSize size) {
+            image.size = size;
+            if (stagingDevice) {
+                image.staging = std::make_shared<LveBuffer>(
+                    *stagingDevice, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+                image.staging->map();
+                image.pixels = std::shared_ptr<uint8_t>(image.staging, static_cast<uint8_t*>(image.staging->getMappedMemory()));
+            }
+            else {
+                image.pixels = std::shared_ptr<uint8_t>(new uint8_t[size], std::default_delete<uint8_t[]>());
+            }
+            return image.pixels.get();
+        };
+
         if(stbi_is_hdr(filepath.c_str())) {
-            float *tmp = stbi_loadf(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-            pixels = reinterpret_cast<stbi_uc*>(tmp);
+            float *floats = stbi_loadf(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!floats) {
+                throw std::runtime_error("failed to load texture image: " + filepath);
+            }
+            std::unique_ptr<float, void (*)(void*)> decoded{floats, stbi_image_free};
+            // half floats are plenty for radiance and half the size of what stb decodes,
+            // the image always keeps this format whatever the texture is created with
+            size_t count = static_cast<size_t>(texWidth) * texHeight * 4;
+            convertFloatToHalf(floats, reinterpret_cast<uint16_t*>(allocate(count * sizeof(uint16_t))), count);
+            image.format = VK_FORMAT_R16G16B16A16_SFLOAT;
         }
         else {
-            pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            // decoded with the channels the file has, the expansion to rgba is a SIMD pass instead of stb's per texel one
+            stbi_uc *pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, 0);
+            if (!pixels) {
+                throw std::runtime_error("failed to load texture image: " + filepath);
+            }
+            std::unique_ptr<stbi_uc, void (*)(void*)> decoded{pixels, stbi_image_free};
+            size_t pixelCount = static_cast<size_t>(texWidth) * texHeight;
+            if (texChannels == STBI_rgb_alpha && !stagingDevice) {
+                // already in its final layout, keep stb's buffer
+                image.pixels = std::shared_ptr<uint8_t>(decoded.release(), [](uint8_t *data) { stbi_image_free(data); });
+                image.size = 4 * static_cast<VkDeviceSize>(pixelCount);
+            }
+            else {
+                expandToRgba8(pixels, static_cast<uint32_t>(texChannels), allocate(4 * pixelCount), pixelCount);
+            }
         }
-        
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-        if (!pixels) {
-            throw std::runtime_error("failed to load texture image!");
-        }
-    
-        mMipLevels = 1;
-        
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-
-        mDevice.createBuffer(
-          imageSize,
-          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-          stagingBuffer,
-          stagingBufferMemory);
-        
-        void *data;
-        vkMapMemory(mDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(mDevice.device(), stagingBufferMemory);
-        
-        stbi_image_free(pixels);
 
+        image.width = static_cast<uint32_t>(texWidth);
+        image.height = static_cast<uint32_t>(texHeight);
+        return image;
+    }
 
-        mFormat = format;
+    void LveTexture::createTextureImage(const ImageData &image, VkFormat format, VkImageViewType viewType, VkImageLayout layout, MipFilter mipFilter,
+                                        uint32_t baseLevel) {
+        mFormat = image.format != VK_FORMAT_UNDEFINED ? image.format : format;
         mTextureLayout = layout;
         mViewType = viewType;
-        mExtent = {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1};
+        mBaseLevel = baseLevel;
+        mResidentLevel = baseLevel;
+        mChainExtent = {image.width, image.height, 1};
+        mExtent = {std::max(image.width >> baseLevel, 1u), std::max(image.height >> baseLevel, 1u), 1};
+        mLayerCount = image.layerCount;
+
+        if (!mDevice.isFormatSupported(mFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+            throw std::runtime_error("texture format " + std::to_string(mFormat) + " can't be sampled on this device");
+        }
+        // a single equirectangular or 2D image can't back a cube view
+        if (viewType == VK_IMAGE_VIEW_TYPE_CUBE && mLayerCount % 6 != 0) {
+            throw std::runtime_error("cube views need 6 layers, use EnvironmentMapLoader for equirectangular images");
+        }
+
+        // a stored chain is uploaded as is, storage images and cube maps are written by compute passes
+        // and keep their single level
+        bool generateMips = image.levelOffsets.size() <= 1 && mipFilter != MipFilter::None &&
+                            layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && viewType == VK_IMAGE_VIEW_TYPE_2D &&
+                            mDevice.mipGenerator().supports(mFormat);
+        if (image.levelOffsets.size() > 1) {
+            mMipLevels = static_cast<uint32_t>(image.levelOffsets.size()) - baseLevel;
+        }
+        else {
+            mMipLevels = generateMips ? MipGenerator::mipLevelCount(image.width, image.height) : 1;
+        }
+
+        // only the span holding the uploaded levels goes through the staging buffer
+        VkDeviceSize stagingBegin = 0;
+        VkDeviceSize imageSize = image.size;
+        if (baseLevel > 0 && image.levelSizes.size() == image.levelOffsets.size()) {
+            stagingBegin = image.size;
+            VkDeviceSize stagingEnd = 0;
+            for (size_t level = baseLevel; level < image.levelOffsets.size(); level++) {
+                stagingBegin = std::min(stagingBegin, image.levelOffsets[level]);
+                stagingEnd = std::max(stagingEnd, image.levelOffsets[level] + image.levelSizes[level]);
+            }
+            imageSize = stagingEnd - stagingBegin;
+        }
+        
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+
+        if (image.staging) {
+            // decoded into staging memory by loadImageData, a single level starting at offset 0 the copy reads in place
+            assert(image.levelOffsets.empty() && image.pixels.get() == image.staging->getMappedMemory());
+            stagingBuffer = image.staging->getBuffer();
+        }
+        else {
+            mDevice.createBuffer(
+              imageSize,
+              VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+              stagingBuffer,
+              stagingBufferMemory);
+
+            void *data;
+            vkMapMemory(mDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
+            memcpy(data, image.pixels.get() + stagingBegin, static_cast<size_t>(imageSize));
+            vkUnmapMemory(mDevice.device(), stagingBufferMemory);
+        }
 
         // image create info
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        if (viewType == VK_IMAGE_VIEW_TYPE_CUBE) {
+            imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        }
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent = mExtent;
         imageInfo.mipLevels = mMipLevels;
@@ -175,8 +324,11 @@ namespace RenderingEngine{
         imageInfo.format = mFormat;
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                          VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        // srgb and block compressed formats usually can't be storage images, asking for it would fail the image creation
+        if (mDevice.isFormatSupported(mFormat, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+            imageInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        }
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
@@ -187,46 +339,60 @@ namespace RenderingEngine{
             mTextureImage,
             mTextureImageMemory);
 
-        mDevice.transitionImageLayout(
-          mTextureImage,
-          mFormat,
-          VK_IMAGE_LAYOUT_UNDEFINED,
-          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-          mMipLevels,
-          mLayerCount);
-        
-        mDevice.copyBufferToImage(
-            stagingBuffer,
-            mTextureImage,
-            static_cast<uint32_t>(texWidth),
-            static_cast<uint32_t>(texHeight),
-            mLayerCount);
-       
-        // comment this out if using mips
-        mDevice.transitionImageLayout(
-          mTextureImage,
-          mFormat,
-          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-          mTextureLayout,
-          mMipLevels,
-          mLayerCount);
-        
-        // If we generate mip maps then the final image will alerady be READ_ONLY_OPTIMAL
-        // mDevice.generateMipmaps(mTextureImage, mFormat, texWidth, texHeight, mMipLevels);
-        //mTextureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // base level copy and the whole mip chain go into one submission
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+
+        MipGenerator::imageBarrier(
+            commandBuffer, mTextureImage, 0, mMipLevels, mLayerCount,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        // one region per stored level, generated levels are filled from level 0 below
+        std::vector<VkBufferImageCopy> regions;
+        uint32_t storedLevels = std::max(static_cast<uint32_t>(image.levelOffsets.size()), 1u);
+        for (uint32_t level = baseLevel; level < storedLevels; level++) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = image.levelOffsets.empty() ? 0 : image.levelOffsets[level] - stagingBegin;
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - baseLevel, 0, mLayerCount};
+            region.imageExtent = {std::max(image.width >> level, 1u), std::max(image.height >> level, 1u), 1};
+            regions.push_back(region);
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer, stagingBuffer, mTextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()), regions.data());
 
-        vkDestroyBuffer(mDevice.device(), stagingBuffer, nullptr);
-        vkFreeMemory(mDevice.device(), stagingBufferMemory, nullptr);
-        
+        if (generateMips && mMipLevels > 1) {
+            mDevice.mipGenerator().record(
+                commandBuffer, mTextureImage, mFormat, {image.width, image.height}, mMipLevels, mLayerCount, mipFilter, mTextureLayout);
+        }
+        else {
+            MipGenerator::imageBarrier(
+                commandBuffer, mTextureImage, 0, mMipLevels, mLayerCount,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mTextureLayout,
+                VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        }
+
+        // waits for the queue, the staging buffer and the per level views are free after this
+        mDevice.endSingleTimeCommands(commandBuffer);
+        mDevice.mipGenerator().releaseTransientResources();
 
+        if (stagingBufferMemory != VK_NULL_HANDLE) {
+            vkDestroyBuffer(mDevice.device(), stagingBuffer, nullptr);
+            vkFreeMemory(mDevice.device(), stagingBufferMemory, nullptr);
+        }
     }
 
-    void LveTexture::createTextureImageView(VkImageViewType viewType) {
+    void LveTexture::createTextureImageView(VkImageViewType viewType, VkComponentMapping components) {
+        mComponents = components;
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = mTextureImage;
         viewInfo.viewType = viewType;
-        viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        // the image format, an srgb texture is decoded on sampling
+        viewInfo.format = mFormat;
+        viewInfo.components = components;
         viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
         viewInfo.subresourceRange.baseMipLevel = 0;
         viewInfo.subresourceRange.levelCount = mMipLevels;
@@ -259,12 +425,111 @@ namespace RenderingEngine{
 
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
-        samplerInfo.minLod = 0.0f;
+        // levels of a streamed texture that have no data yet are never sampled
+        samplerInfo.minLod = static_cast<float>(mResidentLevel - mBaseLevel);
         samplerInfo.maxLod = static_cast<float>(mMipLevels);
 
-        if (vkCreateSampler(mDevice.device(), &samplerInfo, nullptr, &mTextureSampler) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create texture sampler!");
+        // textures with the same mip count share one sampler
+        mTextureSampler = mDevice.getSampler(samplerInfo);
+    }
+
+    void LveTexture::reallocateLevels(VkCommandBuffer commandBuffer, uint32_t baseLevel, std::vector<RetiredHandles> &retired) {
+        assert(mTextureLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && "Only sampled textures are streamed");
+        uint32_t levelCount = mBaseLevel + mMipLevels;
+        assert(baseLevel < levelCount && "Base level outside the chain");
+
+        auto levelExtent = [&](uint32_t level) {
+            return VkExtent3D{std::max(mChainExtent.width >> level, 1u), std::max(mChainExtent.height >> level, 1u), 1};
+        };
+
+        VkImage oldImage = mTextureImage;
+        uint32_t oldBaseLevel = mBaseLevel;
+        retired.push_back({mTextureImage, mTextureImageMemory, mTextureImageView});
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = levelExtent(baseLevel);
+        imageInfo.mipLevels = levelCount - baseLevel;
+        imageInfo.arrayLayers = mLayerCount;
+        imageInfo.format = mFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        mDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mTextureImage, mTextureImageMemory);
+
+        mBaseLevel = baseLevel;
+        mMipLevels = levelCount - baseLevel;
+        mExtent = imageInfo.extent;
+        // shrinking drops the finest resident levels
+        mResidentLevel = std::max(mResidentLevel, baseLevel);
+
+        MipGenerator::imageBarrier(
+            commandBuffer, mTextureImage, 0, mMipLevels, mLayerCount,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        // the old image is thrown away after the copy, it does not go back to shader read
+        MipGenerator::imageBarrier(
+            commandBuffer, oldImage, mResidentLevel - oldBaseLevel, levelCount - mResidentLevel, mLayerCount,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        std::vector<VkImageCopy> regions;
+        for (uint32_t level = mResidentLevel; level < levelCount; level++) {
+            VkImageCopy region{};
+            region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - oldBaseLevel, 0, mLayerCount};
+            region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - baseLevel, 0, mLayerCount};
+            region.extent = levelExtent(level);
+            regions.push_back(region);
         }
+        vkCmdCopyImage(
+            commandBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, mTextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()), regions.data());
+
+        // levels without data go to shader read as well, minLod keeps them from being sampled
+        MipGenerator::imageBarrier(
+            commandBuffer, mTextureImage, 0, mMipLevels, mLayerCount,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        mTextureImageView = nullptr;
+        createTextureImageView(mViewType, mComponents);
+    }
+
+    void LveTexture::recordLevelUpload(VkCommandBuffer commandBuffer, VkBuffer staging) {
+        assert(mResidentLevel > mBaseLevel && "Every allocated level is resident");
+        uint32_t level = mResidentLevel - 1;
+        uint32_t mip = level - mBaseLevel;
+
+        // the previous contents of the level are undefined anyway
+        MipGenerator::imageBarrier(
+            commandBuffer, mTextureImage, mip, 1, mLayerCount,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, mLayerCount};
+        region.imageExtent = {std::max(mExtent.width >> mip, 1u), std::max(mExtent.height >> mip, 1u), 1};
+        vkCmdCopyBufferToImage(commandBuffer, staging, mTextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        MipGenerator::imageBarrier(
+            commandBuffer, mTextureImage, mip, 1, mLayerCount,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mResidentLevel = level;
+    }
+
+    void LveTexture::updateResidentSampler() {
+        // cached, the previous sampler stays valid for the frames still using it
+        createTextureSampler();
+        updateDescriptor();
     }
 
     void LveTexture::transitionLayout(
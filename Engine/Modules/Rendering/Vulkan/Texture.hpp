@@ -1,15 +1,52 @@
 ﻿#pragma once
+#include "Buffer.hpp"
 #include "Device.hpp"
+#include "MipGenerator.hpp"
 
 #include <vulkan/vulkan.h>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace RenderingEngine{
     class LveTexture{
     public:
-        LveTexture(LveDevice &device, const std::string &textureFilepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout);
+        // decoded pixels, always 4 channels, produced without touching vulkan so it can run on any thread
+        // .hdr images are R16G16B16A16_SFLOAT, other 8 bit images use the format the texture is created with
+        // KTX2 files keep their stored format, layers and mip chain instead
+        struct ImageData{
+            uint32_t width = 0;
+            uint32_t height = 0;
+            VkDeviceSize size = 0;
+            std::shared_ptr<uint8_t> pixels;
+            // UNDEFINED uses the format the texture is created with
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            uint32_t layerCount = 1;
+            // offset and byte size of each stored mip level into pixels, level 0 first, empty for a single level
+            std::vector<VkDeviceSize> levelOffsets;
+            std::vector<VkDeviceSize> levelSizes;
+            // set when pixels point into this host visible buffer, the upload copies from it without another memcpy
+            std::shared_ptr<LveBuffer> staging;
+        };
+        // with a stagingDevice stb images are decoded straight into a mapped staging buffer of it,
+        // so a worker thread does every cpu pass over the pixels and the upload only records the copy
+        static ImageData loadImageData(const std::string &filepath, LveDevice *stagingDevice = nullptr);
+
+        // components swizzles the view, e.g. to read one channel of a packed texture as .r
+        // shader read only 2D textures get a full mip chain generated on the gpu, mipFilter picks how
+        LveTexture(LveDevice &device, const std::string &textureFilepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+                   VkComponentMapping components = {}, MipFilter mipFilter = MipFilter::Box);
+        LveTexture(LveDevice &device, const ImageData &image, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+                   VkComponentMapping components = {}, MipFilter mipFilter = MipFilter::Box);
+        // stored mip chains only, allocates and uploads levels [residentLevel, levelCount) of the chain,
+        // TextureStreamer moves the resident range afterwards
+        LveTexture(LveDevice &device, const ImageData &image, VkImageViewType viewType, VkComponentMapping components,
+                   uint32_t residentLevel);
+        // an empty image the gpu fills, e.g. the cube EnvironmentMapLoader renders or a virtual texture tile cache;
+        // nothing is uploaded or transitioned, the caller moves every level to layout before it is sampled
+        LveTexture(LveDevice &device, VkFormat format, VkExtent2D extent, uint32_t mipLevels, uint32_t layerCount,
+                   VkImageViewType viewType, VkImageLayout layout);
         LveTexture(
             LveDevice &device,
             VkFormat format,
@@ -29,6 +66,15 @@ namespace RenderingEngine{
         VkImageLayout getImageLayout() const { return mTextureLayout; }
         VkExtent3D getExtent() const { return mExtent; }
         VkFormat getFormat() const { return mFormat; }
+        // levels allocated in the image, the finest one is level getBaseLevel() of the full chain
+        uint32_t getMipLevels() const { return mMipLevels; }
+        uint32_t getLayerCount() const { return mLayerCount; }
+        // streaming, levels of the full chain: [baseLevel, end) are allocated, [residentLevel, end) hold data
+        // and the sampler's minLod keeps sampling on those, both are 0 unless TextureStreamer manages the texture
+        uint32_t getBaseLevel() const { return mBaseLevel; }
+        uint32_t getResidentLevel() const { return mResidentLevel; }
+        // bytes of device memory backing the image
+        VkDeviceSize getMemorySize() const;
 
         void updateDescriptor();
         void transitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
@@ -36,26 +82,50 @@ namespace RenderingEngine{
         static std::unique_ptr<LveTexture> createTextureFromFile(
           LveDevice &device, const std::string &filepath, 
             VkFormat format = VK_FORMAT_R8G8B8A8_UNORM, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
-            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VkComponentMapping components = {},
+            MipFilter mipFilter = MipFilter::Box);
 
 
     private:
-        void createTextureImage(const std::string &filepath, VkFormat format, VkImageViewType viewType, VkImageLayout layout);
-        void createTextureImageView(VkImageViewType viewType);
+        friend class TextureStreamer;
+
+        // handles a streaming step replaced, destroyed once the gpu no longer reads them
+        struct RetiredHandles{
+            VkImage image = VK_NULL_HANDLE;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+        };
+
+        void createTextureImage(const ImageData &image, VkFormat format, VkImageViewType viewType, VkImageLayout layout, MipFilter mipFilter,
+                                uint32_t baseLevel = 0);
+        void createTextureImageView(VkImageViewType viewType, VkComponentMapping components);
         void createTextureSampler();
 
+        // streaming steps, recorded into commandBuffer and valid once it executed
+        // moves the finest allocated level to baseLevel: a new image, the resident levels it keeps are copied over
+        void reallocateLevels(VkCommandBuffer commandBuffer, uint32_t baseLevel, std::vector<RetiredHandles> &retired);
+        // uploads level residentLevel - 1 of the chain from staging, offset 0
+        void recordLevelUpload(VkCommandBuffer commandBuffer, VkBuffer staging);
+        // a sampler clamped to the resident levels, and the descriptor pointing at the current view
+        void updateResidentSampler();
+
         VkDescriptorImageInfo mDescriptor{};
 
         LveDevice &mDevice;
         VkImage mTextureImage = nullptr; // meta data of the image
         VkDeviceMemory mTextureImageMemory = nullptr; // vulkan device memory obj
         VkImageView mTextureImageView = nullptr; // define data format and range 
-        VkSampler mTextureSampler = nullptr; // define sampler's filter mode and so on
+        VkSampler mTextureSampler = nullptr; // define sampler's filter mode and so on, owned by LveDevice::getSampler
         VkFormat mFormat;
         VkImageLayout mTextureLayout;
         VkImageViewType mViewType;
         uint32_t mMipLevels{1};
+        uint32_t mBaseLevel{0};
+        uint32_t mResidentLevel{0};
         uint32_t mLayerCount{1};
+        VkComponentMapping mComponents{};
         VkExtent3D mExtent{};  
+        VkExtent3D mChainExtent{}; // level 0 of the chain, mExtent is level mBaseLevel
     };
 }
\ No newline at end of file
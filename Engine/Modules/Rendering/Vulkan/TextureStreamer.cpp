@@ -0,0 +1,304 @@
+#include "TextureStreamer.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        double toMiB(VkDeviceSize size)
+        {
+            return static_cast<double>(size) / (1024.0 * 1024.0);
+        }
+    }
+
+    TextureStreamer::TextureStreamer(LveDevice& device, ThreadPool& threadPool, VkDeviceSize uploadBudget)
+        : mDevice{device}, mThreadPool{threadPool}, mUploadBudget{uploadBudget}
+    {
+        std::array<VkCommandBuffer, LveSwapChain::MAX_FRAMES_IN_FLIGHT> commandBuffers;
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = mDevice.getCommandPool();
+        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        if (vkAllocateCommandBuffers(mDevice.device(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate texture streaming command buffers!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        for (size_t i = 0; i < submissions.size(); i++)
+        {
+            submissions[i].commandBuffer = commandBuffers[i];
+            if (vkCreateFence(mDevice.device(), &fenceInfo, nullptr, &submissions[i].fence) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create texture streaming fence!");
+            }
+        }
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        for (auto& kv : textures)
+        {
+            releaseStaging(kv.second);
+        }
+        for (Submission& submission : submissions)
+        {
+            if (submission.pending)
+            {
+                vkWaitForFences(mDevice.device(), 1, &submission.fence, VK_TRUE, UINT64_MAX);
+                releaseSubmission(submission);
+            }
+            vkDestroyFence(mDevice.device(), submission.fence, nullptr);
+            vkFreeCommandBuffers(mDevice.device(), mDevice.getCommandPool(), 1, &submission.commandBuffer);
+        }
+    }
+
+    std::shared_ptr<LveTexture> TextureStreamer::createTexture(
+        const LveTexture::ImageData& image, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+        VkComponentMapping components, MipFilter mipFilter)
+    {
+        uint32_t levelCount = static_cast<uint32_t>(image.levelOffsets.size());
+        uint32_t tailLevel = 0;
+        while (tailLevel + 1 < levelCount && std::max(image.width >> tailLevel, image.height >> tailLevel) > TAIL_SIZE)
+        {
+            tailLevel++;
+        }
+
+        bool streamable = levelCount > 1 && image.levelSizes.size() == levelCount && viewType == VK_IMAGE_VIEW_TYPE_2D &&
+                          layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && tailLevel > 0;
+        if (!streamable)
+        {
+            return std::make_shared<LveTexture>(mDevice, image, format, viewType, layout, components, mipFilter);
+        }
+
+        auto texture = std::make_shared<LveTexture>(mDevice, image, viewType, components, tailLevel);
+        // an expired texture may have left its entry at the same address
+        auto stale = textures.find(texture.get());
+        if (stale != textures.end())
+        {
+            releaseStaging(stale->second);
+            textures.erase(stale);
+        }
+
+        StreamedTexture& streamed = textures[texture.get()];
+        streamed.texture = texture;
+        streamed.source = image;
+        streamed.tailLevel = tailLevel;
+        return texture;
+    }
+
+    void TextureStreamer::requestLevel(const LveTexture* texture, uint32_t level)
+    {
+        auto it = textures.find(texture);
+        if (it == textures.end()) return;
+        it->second.requested = std::min(it->second.requested, level);
+    }
+
+    void TextureStreamer::requestScreenSize(const LveTexture* texture, float pixels)
+    {
+        auto it = textures.find(texture);
+        if (it == textures.end() || !(pixels > 0.0f)) return;
+        const LveTexture::ImageData& source = it->second.source;
+        // one texel per pixel, the finest level is level 0
+        float texelsPerPixel = static_cast<float>(std::max(source.width, source.height)) / pixels;
+        uint32_t level = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel))) : 0;
+        requestLevel(texture, std::min(level, it->second.tailLevel));
+    }
+
+    void TextureStreamer::update()
+    {
+        for (Submission& pending : submissions)
+        {
+            if (pending.pending && vkGetFenceStatus(mDevice.device(), pending.fence) == VK_SUCCESS)
+            {
+                releaseSubmission(pending);
+            }
+        }
+        // submitted at least MAX_FRAMES_IN_FLIGHT updates ago, the frames since then waited for older ones, this barely ever blocks
+        Submission& submission = submissions[submissionIndex];
+        if (submission.pending)
+        {
+            vkWaitForFences(mDevice.device(), 1, &submission.fence, VK_TRUE, UINT64_MAX);
+            releaseSubmission(submission);
+        }
+
+        // everything of this update goes into one submission
+        bool recording = false;
+        auto commands = [&]() {
+            if (!recording)
+            {
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                vkResetCommandBuffer(submission.commandBuffer, 0);
+                vkBeginCommandBuffer(submission.commandBuffer, &beginInfo);
+                recording = true;
+            }
+            return submission.commandBuffer;
+        };
+        std::vector<LveTexture::RetiredHandles> retired;
+        std::vector<std::pair<VkBuffer, VkDeviceMemory>> uploadedStaging;
+        VkDeviceSize started = 0;
+
+        for (auto it = textures.begin(); it != textures.end();)
+        {
+            StreamedTexture& streamed = it->second;
+            std::shared_ptr<LveTexture> texture = streamed.texture.lock();
+            if (!texture)
+            {
+                releaseStaging(streamed);
+                it = textures.erase(it);
+                continue;
+            }
+            uint32_t target = std::min(streamed.requested, streamed.tailLevel);
+            streamed.requested = UINT32_MAX;
+
+            bool changed = false;
+            if (streamed.load.valid())
+            {
+                if (streamed.load.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                {
+                    streamed.load.get();
+                    texture->recordLevelUpload(commands(), streamed.staging);
+                    uploadedStaging.emplace_back(streamed.staging, streamed.stagingMemory);
+                    streamed.staging = VK_NULL_HANDLE;
+                    streamed.stagingMemory = VK_NULL_HANDLE;
+                    levelsUploaded++;
+                    changed = true;
+                }
+            }
+            // resizing waits until no level is in flight, the copy would race the upload into the old image
+            else if (target < texture->getBaseLevel())
+            {
+                texture->reallocateLevels(commands(), target, retired);
+                streamed.framesOverAllocated = 0;
+                reallocations++;
+                changed = true;
+            }
+            else if (target > texture->getBaseLevel() && ++streamed.framesOverAllocated >= DEMOTE_FRAMES)
+            {
+                texture->reallocateLevels(commands(), target, retired);
+                streamed.framesOverAllocated = 0;
+                reallocations++;
+                changed = true;
+            }
+            else if (target == texture->getBaseLevel())
+            {
+                streamed.framesOverAllocated = 0;
+            }
+
+            if (changed)
+            {
+                texture->updateResidentSampler();
+            }
+
+            // next level below the resident ones, the worker only copies out of the mapping into mapped staging memory
+            if (!streamed.load.valid() && texture->getResidentLevel() > texture->getBaseLevel() && started < mUploadBudget)
+            {
+                uint32_t level = texture->getResidentLevel() - 1;
+                VkDeviceSize size = streamed.source.levelSizes[level];
+                mDevice.createBuffer(
+                    size,
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    streamed.staging,
+                    streamed.stagingMemory);
+                void* data;
+                vkMapMemory(mDevice.device(), streamed.stagingMemory, 0, size, 0, &data);
+
+                std::shared_ptr<uint8_t> pixels = streamed.source.pixels;
+                const uint8_t* levelData = pixels.get() + streamed.source.levelOffsets[level];
+                streamed.load = mThreadPool.submit([pixels, levelData, data, size]() {
+                    std::memcpy(data, levelData, static_cast<size_t>(size));
+                });
+                started += size;
+            }
+            ++it;
+        }
+
+        if (!recording) return;
+
+        vkEndCommandBuffer(submission.commandBuffer);
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
+        // on the graphics queue ahead of this frame, whose reads the barriers of the copies order after them;
+        // the fence also covers every earlier submission, the frames in flight that still read the replaced handles
+        vkResetFences(mDevice.device(), 1, &submission.fence);
+        if (vkQueueSubmit(mDevice.graphicsQueue(), 1, &submitInfo, submission.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit texture streaming commands!");
+        }
+        submission.pending = true;
+        submission.retired = std::move(retired);
+        submission.staging = std::move(uploadedStaging);
+        submissionIndex = (submissionIndex + 1) % static_cast<uint32_t>(submissions.size());
+    }
+
+    void TextureStreamer::releaseSubmission(Submission& submission)
+    {
+        for (const LveTexture::RetiredHandles& handles : submission.retired)
+        {
+            vkDestroyImageView(mDevice.device(), handles.view, nullptr);
+            vkDestroyImage(mDevice.device(), handles.image, nullptr);
+            vkFreeMemory(mDevice.device(), handles.memory, nullptr);
+        }
+        for (const auto& staging : submission.staging)
+        {
+            vkDestroyBuffer(mDevice.device(), staging.first, nullptr);
+            vkFreeMemory(mDevice.device(), staging.second, nullptr);
+        }
+        submission.retired.clear();
+        submission.staging.clear();
+        submission.pending = false;
+    }
+
+    void TextureStreamer::releaseStaging(StreamedTexture& streamed)
+    {
+        // a load that was never uploaded is not used by the gpu
+        if (streamed.load.valid()) streamed.load.wait();
+        streamed.load = {};
+        if (streamed.staging == VK_NULL_HANDLE) return;
+        vkDestroyBuffer(mDevice.device(), streamed.staging, nullptr);
+        vkFreeMemory(mDevice.device(), streamed.stagingMemory, nullptr);
+        streamed.staging = VK_NULL_HANDLE;
+        streamed.stagingMemory = VK_NULL_HANDLE;
+    }
+
+    VkDeviceSize TextureStreamer::getResidentSize() const
+    {
+        VkDeviceSize size = 0;
+        for (const auto& kv : textures)
+        {
+            if (auto texture = kv.second.texture.lock()) size += texture->getMemorySize();
+        }
+        return size;
+    }
+
+    void TextureStreamer::dumpStats(std::ostream& out) const
+    {
+        out << "TextureStreamer: " << textures.size() << " textures, " << std::fixed << std::setprecision(2)
+            << toMiB(getResidentSize()) << " MiB resident, " << levelsUploaded << " levels uploaded, " << reallocations
+            << " reallocations\n";
+        for (const auto& kv : textures)
+        {
+            auto texture = kv.second.texture.lock();
+            if (!texture) continue;
+            out << "  levels " << texture->getResidentLevel() << " (allocated " << texture->getBaseLevel() << ", tail "
+                << kv.second.tailLevel << ") " << std::setw(9) << toMiB(texture->getMemorySize()) << " MiB  "
+                << kv.second.source.width << "x" << kv.second.source.height << "\n";
+        }
+        out << std::defaultfloat;
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Device.hpp"
+#include "SwapChain.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*************************************************
+Mip streaming of textures with a stored chain (KTX2)
+- createTexture only uploads the mip tail, the levels up to TAIL_SIZE texels, finer levels start out non resident
+- every frame the finest level each texture needs is reported with requestLevel / requestScreenSize,
+  GameObjectManager::requestTextureLevels estimates it from the on-screen size of the objects using the texture
+- update grows the image to the requested level, the missing levels are read from the mapped file on the
+  thread pool into staging buffers and uploaded coarsest first, one level per texture in flight
+- until a level's data arrived the sampler's minLod keeps sampling on the levels that hold data
+- a texture requested coarser than its allocation for DEMOTE_FRAMES updates shrinks again,
+  so device memory follows what is visible rather than what was loaded
+Not thread safe, call update between frames on the thread that owns the device. update records its copies into one
+of MAX_FRAMES_IN_FLIGHT command buffers and submits it with a fence instead of waiting for the queue; the replaced
+images, views and staging buffers are destroyed once that fence signaled, at the latest when the slot comes around again.
+Samplers come from the device's cache, each resident range maps to one shared sampler.
+*************************************************/
+namespace RenderingEngine
+{
+    class TextureStreamer
+    {
+    public:
+        static constexpr uint32_t TAIL_SIZE = 128;
+        // staging bytes a single update starts loading, a level is never split
+        static constexpr VkDeviceSize DEFAULT_UPLOAD_BUDGET = 16ull * 1024 * 1024;
+        static constexpr uint32_t DEMOTE_FRAMES = 120;
+
+        TextureStreamer(LveDevice& device, ThreadPool& threadPool, VkDeviceSize uploadBudget = DEFAULT_UPLOAD_BUDGET);
+        // waits for the loads and submissions in flight
+        ~TextureStreamer();
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // images without a stored chain, views other than 2D and layouts other than shader read only
+        // are created fully resident and not streamed
+        std::shared_ptr<LveTexture> createTexture(
+            const LveTexture::ImageData& image, VkFormat format, VkImageViewType viewType, VkImageLayout layout,
+            VkComponentMapping components, MipFilter mipFilter);
+
+        bool isStreamed(const LveTexture* texture) const { return textures.count(texture) > 0; }
+        // keeps the finest level asked for since the last update, textures that are not streamed are ignored
+        // a sampling feedback readback reports its levels here
+        void requestLevel(const LveTexture* texture, uint32_t level);
+        // pixels: on-screen size of the surface the whole texture is mapped onto once
+        void requestScreenSize(const LveTexture* texture, float pixels);
+
+        void update();
+
+        VkDeviceSize getResidentSize() const;
+        void dumpStats(std::ostream& out = std::cout) const;
+
+    private:
+        struct StreamedTexture
+        {
+            std::weak_ptr<LveTexture> texture;
+            // keeps the file mapped
+            LveTexture::ImageData source;
+            // finest level of the mip tail, never evicted
+            uint32_t tailLevel = 0;
+            // finest level requested since the last update, UINT32_MAX if none
+            uint32_t requested = UINT32_MAX;
+            // consecutive updates the allocation was finer than requested
+            uint32_t framesOverAllocated = 0;
+
+            // the level below the resident ones, copied from the mapping into staging on the pool
+            VkBuffer staging = VK_NULL_HANDLE;
+            VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+            std::future<void> load;
+        };
+
+        // the copies of one update, a slot is recorded again MAX_FRAMES_IN_FLIGHT submissions later
+        struct Submission
+        {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            bool pending = false;
+            // still read by the submission or by frames submitted before it
+            std::vector<LveTexture::RetiredHandles> retired;
+            std::vector<std::pair<VkBuffer, VkDeviceMemory>> staging;
+        };
+
+        void releaseStaging(StreamedTexture& streamed);
+        void releaseSubmission(Submission& submission);
+
+        LveDevice& mDevice;
+        ThreadPool& mThreadPool;
+        VkDeviceSize mUploadBudget;
+
+        std::unordered_map<const LveTexture*, StreamedTexture> textures;
+
+        std::array<Submission, LveSwapChain::MAX_FRAMES_IN_FLIGHT> submissions;
+        uint32_t submissionIndex = 0;
+
+        uint64_t levelsUploaded = 0;
+        uint64_t reallocations = 0;
+    };
+}
@@ -0,0 +1,53 @@
+#include "ThreadPool.hpp"
+
+// std
+#include <algorithm>
+
+namespace RenderingEngine
+{
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                // drain the queue before exiting so no future is left without a value
+                if (jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace RenderingEngine
+{
+    // fixed size pool of worker threads consuming a fifo of jobs
+    // jobs must not touch vulkan objects that are used by the main thread
+    class ThreadPool
+    {
+    public:
+        // 0 uses one thread less than the hardware has, the main thread keeps uploading meanwhile
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+        // exceptions thrown by the job are rethrown from future::get
+        template <typename Function>
+        auto submit(Function&& function) -> std::future<std::invoke_result_t<std::decay_t<Function>>>
+        {
+            using Result = std::invoke_result_t<std::decay_t<Function>>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+            std::future<Result> future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                jobs.emplace([task]() { (*task)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+
+        // calls function(i) for every i in [0, count) on the workers and the calling thread, returns once all are done
+        // the caller works through the indices itself, so a job may use it without waiting on busy workers;
+        // the first exception thrown is rethrown after the rest finished
+        template <typename Function>
+        void parallelFor(size_t count, Function&& function)
+        {
+            struct Shared
+            {
+                std::atomic<size_t> next{0};
+                size_t count = 0;
+                size_t finished = 0;
+                std::exception_ptr error;
+                std::mutex mutex;
+                std::condition_variable done;
+            };
+            auto shared = std::make_shared<Shared>();
+            shared->count = count;
+
+            // a helper the workers only get to after everything finished claims nothing and never touches function
+            auto work = [shared, &function]() {
+                for (size_t index = shared->next++; index < shared->count; index = shared->next++)
+                {
+                    std::exception_ptr error;
+                    try
+                    {
+                        function(index);
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                    std::lock_guard<std::mutex> lock{shared->mutex};
+                    if (error && !shared->error) shared->error = error;
+                    if (++shared->finished == shared->count) shared->done.notify_all();
+                }
+            };
+
+            size_t helpers = std::min(count, workers.size() + 1);
+            if (helpers > 1)
+            {
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    for (size_t i = 1; i < helpers; i++)
+                    {
+                        jobs.emplace(work);
+                    }
+                }
+                condition.notify_all();
+            }
+            work();
+
+            std::unique_lock<std::mutex> lock{shared->mutex};
+            shared->done.wait(lock, [&]() { return shared->finished == shared->count; });
+            if (shared->error) std::rethrow_exception(shared->error);
+        }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+    };
+}
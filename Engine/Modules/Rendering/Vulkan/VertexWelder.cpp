@@ -0,0 +1,134 @@
+#include "VertexWelder.hpp"
+
+// std
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace RenderingEngine
+{
+    static_assert(sizeof(LveModel::Vertex) % sizeof(float) == 0, "Vertex must be made of floats only");
+
+    VertexWelder::VertexWelder(std::vector<LveModel::Vertex>& output, size_t expectedVertices, float tolerance)
+        : mOutput{output}, mInvTolerance{tolerance > 0.0f ? 1.0f / tolerance : 0.0f}
+    {
+        // keep the load factor at or below one half
+        size_t capacity = 64;
+        while (capacity < expectedVertices * 2)
+        {
+            capacity *= 2;
+        }
+        mSlots.assign(capacity, EMPTY);
+        mSlotHashes.assign(capacity, 0);
+        mMask = capacity - 1;
+
+        assert(mOutput.empty() && "VertexWelder only indexes vertices it welded itself");
+    }
+
+    void VertexWelder::makeKey(const LveModel::Vertex& vertex, Key& key) const
+    {
+        float components[COMPONENTS];
+        std::memcpy(components, &vertex, sizeof(components));
+        if (mInvTolerance == 0.0f)
+        {
+            for (size_t i = 0; i < COMPONENTS; i++)
+            {
+                // adding +0 turns -0 into +0, the only float pair that compares equal with different bits
+                key[i] = std::bit_cast<uint32_t>(components[i] + 0.0f);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < COMPONENTS; i++)
+            {
+                key[i] = static_cast<uint32_t>(static_cast<int32_t>(std::floor(components[i] * mInvTolerance + 0.5f)));
+            }
+        }
+    }
+
+    uint32_t VertexWelder::hashKey(const Key& key)
+    {
+        // four independent lanes so the loop vectorizes, folded together at the end
+        uint32_t lanes[4] = {0x9e3779b9u, 0x85ebca6bu, 0xc2b2ae35u, 0x27d4eb2fu};
+        size_t i = 0;
+        for (; i + 4 <= COMPONENTS; i += 4)
+        {
+            for (size_t lane = 0; lane < 4; lane++)
+            {
+                lanes[lane] = (lanes[lane] ^ key[i + lane]) * 0x01000193u;
+                lanes[lane] ^= lanes[lane] >> 15;
+            }
+        }
+        for (; i < COMPONENTS; i++)
+        {
+            lanes[i % 4] = (lanes[i % 4] ^ key[i]) * 0x01000193u;
+        }
+
+        uint32_t hash = lanes[0] ^ std::rotl(lanes[1], 8) ^ std::rotl(lanes[2], 16) ^ std::rotl(lanes[3], 24);
+        // murmur3 finalizer, the table uses the low bits
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    uint32_t VertexWelder::weld(const LveModel::Vertex& vertex)
+    {
+        if ((mCount + 1) * 2 > mSlots.size())
+        {
+            grow();
+        }
+
+        Key key;
+        makeKey(vertex, key);
+        uint32_t hash = hashKey(key);
+
+        for (size_t slot = hash & mMask;; slot = (slot + 1) & mMask)
+        {
+            uint32_t index = mSlots[slot];
+            if (index == EMPTY)
+            {
+                index = static_cast<uint32_t>(mOutput.size());
+                mOutput.push_back(vertex);
+                mSlots[slot] = index;
+                mSlotHashes[slot] = hash;
+                mCount++;
+                return index;
+            }
+            if (mSlotHashes[slot] == hash)
+            {
+                Key other;
+                makeKey(mOutput[index], other);
+                if (std::memcmp(key, other, sizeof(Key)) == 0)
+                {
+                    return index;
+                }
+            }
+        }
+    }
+
+    void VertexWelder::grow()
+    {
+        std::vector<uint32_t> slots(mSlots.size() * 2, EMPTY);
+        std::vector<uint32_t> slotHashes(slots.size(), 0);
+        size_t mask = slots.size() - 1;
+        for (size_t i = 0; i < mSlots.size(); i++)
+        {
+            if (mSlots[i] == EMPTY) continue;
+
+            size_t slot = mSlotHashes[i] & mask;
+            while (slots[slot] != EMPTY)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = mSlots[i];
+            slotHashes[slot] = mSlotHashes[i];
+        }
+        mSlots.swap(slots);
+        mSlotHashes.swap(slotHashes);
+        mMask = mask;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Model.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    Deduplicates vertices into an output array, replacing std::unordered_map<Vertex, uint32_t>
+    - flat open addressing table of vertex indices, linear probing, one probe sequence per weld
+    - exact mode hashes the raw float bits (with -0 folded into +0), so equal vertices always weld
+    - tolerance mode snaps every attribute to a grid of the given size before hashing and comparing,
+      vertices closer than the tolerance weld unless they straddle a grid line
+    *************************************************/
+    class VertexWelder
+    {
+    public:
+        // output must be empty, expectedVertices only presizes the table
+        VertexWelder(std::vector<LveModel::Vertex>& output, size_t expectedVertices = 0, float tolerance = 0.0f);
+
+        VertexWelder(const VertexWelder&) = delete;
+        VertexWelder& operator=(const VertexWelder&) = delete;
+
+        // index of vertex in output, appending it if no equal vertex was welded before
+        uint32_t weld(const LveModel::Vertex& vertex);
+
+    private:
+        static constexpr uint32_t EMPTY = UINT32_MAX;
+        static constexpr size_t COMPONENTS = sizeof(LveModel::Vertex) / sizeof(float);
+
+        using Key = uint32_t[COMPONENTS];
+
+        void makeKey(const LveModel::Vertex& vertex, Key& key) const;
+        static uint32_t hashKey(const Key& key);
+        void grow();
+
+        std::vector<LveModel::Vertex>& mOutput;
+        float mInvTolerance;
+
+        // slot -> output index, plus the full hash to skip most vertex compares
+        std::vector<uint32_t> mSlots;
+        std::vector<uint32_t> mSlotHashes;
+        size_t mMask = 0;
+        size_t mCount = 0;
+    };
+}
@@ -0,0 +1,87 @@
+#include "VirtualTextureFile.hpp"
+
+// std
+#include <cstring>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        bool isPowerOfTwo(uint32_t value)
+        {
+            return value != 0 && (value & (value - 1)) == 0;
+        }
+    }
+
+    VirtualTextureLayout::VirtualTextureLayout(VkFormat format, uint32_t width, uint32_t height, VkDeviceSize tileBytes)
+        : format{format}, width{width}, height{height}, tileBytes{tileBytes}
+    {
+        if (!isPowerOfTwo(width) || !isPowerOfTwo(height) || width < VIRTUAL_TILE_SIZE || height < VIRTUAL_TILE_SIZE)
+        {
+            throw std::runtime_error(
+                "virtual textures need power of two sizes of at least " + std::to_string(VIRTUAL_TILE_SIZE) + " texels");
+        }
+
+        // halve until the whole level is a single page
+        levelCount = 1;
+        while (pagesX(levelCount - 1) > 1 || pagesY(levelCount - 1) > 1)
+        {
+            levelCount++;
+        }
+
+        firstPage.resize(levelCount + 1);
+        firstPage[0] = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            firstPage[level + 1] = firstPage[level] + pagesX(level) * pagesY(level);
+        }
+    }
+
+    uint32_t VirtualTextureLayout::pageLevel(uint32_t page) const
+    {
+        uint32_t level = 0;
+        while (page >= firstPage[level + 1]) level++;
+        return level;
+    }
+
+    uint32_t VirtualTextureLayout::parentPage(uint32_t page) const
+    {
+        uint32_t level = pageLevel(page);
+        uint32_t local = page - firstPage[level];
+        uint32_t x = local % pagesX(level);
+        uint32_t y = local / pagesX(level);
+        return pageIndex(level + 1, std::min(x / 2, pagesX(level + 1) - 1), std::min(y / 2, pagesY(level + 1) - 1));
+    }
+
+    VirtualTextureFile parseVirtualTextureFile(const std::string& filePath)
+    {
+        auto file = std::make_shared<MappedFile>(filePath);
+        if (!file->isOpen())
+        {
+            throw std::runtime_error("failed to open virtual texture: " + filePath);
+        }
+
+        VirtualTextureHeader header;
+        if (file->size() < sizeof(header) ||
+            std::memcmp(file->data(), VIRTUAL_TEXTURE_IDENTIFIER, sizeof(VIRTUAL_TEXTURE_IDENTIFIER)) != 0)
+        {
+            throw std::runtime_error("not a virtual texture file: " + filePath);
+        }
+        std::memcpy(&header, file->data(), sizeof(header));
+
+        VirtualTextureFile result{};
+        result.layout = VirtualTextureLayout{static_cast<VkFormat>(header.vkFormat), header.width, header.height, header.tileBytes};
+        if (header.vkFormat == VK_FORMAT_UNDEFINED || header.tileBytes == 0 || header.levelCount != result.layout.levelCount)
+        {
+            throw std::runtime_error("invalid virtual texture header: " + filePath);
+        }
+        if (header.dataOffset + result.layout.pageCount() * header.tileBytes > file->size())
+        {
+            throw std::runtime_error("truncated virtual texture: " + filePath);
+        }
+        result.dataOffset = header.dataOffset;
+        result.file = std::move(file);
+        return result;
+    }
+}
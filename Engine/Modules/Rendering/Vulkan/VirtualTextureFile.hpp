@@ -0,0 +1,77 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*************************************************
+Tiled file of a virtual texture (.vtex), written by TextureCooker and streamed by VirtualTextureSystem
+- the mip chain is cut into pages of VIRTUAL_TILE_SIZE texels; each page is stored as a tile with
+  VIRTUAL_TILE_BORDER texels of its neighbours around it, so bilinear filtering never leaves the tile
+- width and height are powers of two of at least one page, the chain ends at the first level that fits one page
+- tiles are stored level 0 first, row major within a level, all tileBytes large and encoded in vkFormat,
+  tile i starts at dataOffset + i * tileBytes
+virtual_texture.glsl relies on the same constants, change both together.
+*************************************************/
+namespace RenderingEngine
+{
+    constexpr uint32_t VIRTUAL_TILE_SIZE = 128;
+    constexpr uint32_t VIRTUAL_TILE_BORDER = 4;
+    constexpr uint32_t VIRTUAL_TILE_STRIDE = VIRTUAL_TILE_SIZE + 2 * VIRTUAL_TILE_BORDER;
+
+    struct VirtualTextureHeader
+    {
+        char identifier[8];
+        uint32_t vkFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint64_t tileBytes;
+        uint64_t dataOffset;
+    };
+    static_assert(sizeof(VirtualTextureHeader) == 40, "vtex header layout");
+    constexpr char VIRTUAL_TEXTURE_IDENTIFIER[8] = {'R', 'E', 'V', 'T', 'E', 'X', '0', '1'};
+
+    // where each page of the chain lives, derived from the header alone
+    struct VirtualTextureLayout
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+        VkDeviceSize tileBytes = 0;
+        // index of the first page of each level, the page count of the whole chain last
+        std::vector<uint32_t> firstPage;
+
+        // throws std::runtime_error unless width and height are powers of two of at least one page
+        VirtualTextureLayout(VkFormat format, uint32_t width, uint32_t height, VkDeviceSize tileBytes);
+        VirtualTextureLayout() = default;
+
+        uint32_t pagesX(uint32_t level) const { return std::max((width >> level) / VIRTUAL_TILE_SIZE, 1u); }
+        uint32_t pagesY(uint32_t level) const { return std::max((height >> level) / VIRTUAL_TILE_SIZE, 1u); }
+        uint32_t pageCount() const { return firstPage.back(); }
+        uint32_t pageIndex(uint32_t level, uint32_t x, uint32_t y) const { return firstPage[level] + y * pagesX(level) + x; }
+        // the page covering the same texels one level coarser, level must not be the last one
+        uint32_t parentPage(uint32_t page) const;
+        uint32_t pageLevel(uint32_t page) const;
+    };
+
+    struct VirtualTextureFile
+    {
+        VirtualTextureLayout layout;
+        std::shared_ptr<MappedFile> file;
+        VkDeviceSize dataOffset = 0;
+
+        const uint8_t* tile(uint32_t page) const { return file->data() + dataOffset + page * layout.tileBytes; }
+    };
+
+    // the file stays mapped while the returned value lives, tiles are read straight from the mapping
+    VirtualTextureFile parseVirtualTextureFile(const std::string& filePath);
+}
@@ -0,0 +1,478 @@
+#include "VirtualTextureSystem.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // page table texel, R8G8B8A8_UINT: tile x, tile y, level of the tile
+        uint32_t packEntry(uint32_t tileX, uint32_t tileY, uint32_t level)
+        {
+            return tileX | tileY << 8 | level << 16;
+        }
+
+        double toMiB(VkDeviceSize size)
+        {
+            return static_cast<double>(size) / (1024.0 * 1024.0);
+        }
+    }
+
+    VirtualTextureSystem::VirtualTextureSystem(
+        LveDevice& device, ThreadPool& threadPool, uint32_t cacheTiles, VkDeviceSize feedbackSize)
+        : mDevice{device}, mThreadPool{threadPool}, mCacheTiles{cacheTiles}
+    {
+        feedbackAlignment = std::max<VkDeviceSize>(mDevice.properties.limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+        for (auto& buffer : feedbackBuffers)
+        {
+            buffer = std::make_unique<LveBuffer>(
+                mDevice,
+                feedbackSize,
+                1,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            buffer->map();
+            std::memset(buffer->getMappedMemory(), 0, static_cast<size_t>(feedbackSize));
+        }
+        feedbackUsed = feedbackAlignment;
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        pageTableSampler = mDevice.getSampler(samplerInfo);
+
+        // bilinear within level 0, the borders keep the footprint inside the tile
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.maxLod = 0.0f;
+        tileCacheSampler = mDevice.getSampler(samplerInfo);
+
+        fallbackPageTable = std::make_unique<LveTexture>(
+            mDevice, VK_FORMAT_R8G8B8A8_UINT, VkExtent2D{1, 1}, 1, 1, VK_IMAGE_VIEW_TYPE_2D,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        MipGenerator::imageBarrier(
+            commandBuffer, fallbackPageTable->getImage(), 0, 1, 1,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        VkClearColorValue zero{};
+        VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(
+            commandBuffer, fallbackPageTable->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zero, 1, &range);
+        MipGenerator::imageBarrier(
+            commandBuffer, fallbackPageTable->getImage(), 0, 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        mDevice.endSingleTimeCommands(commandBuffer);
+    }
+
+    VirtualTextureSystem::~VirtualTextureSystem()
+    {
+        // the workers write into the staging buffers
+        for (TileLoad& load : loads)
+        {
+            if (load.load.valid()) load.load.wait();
+        }
+    }
+
+    std::shared_ptr<VirtualTexture> VirtualTextureSystem::load(const std::string& filepath)
+    {
+        std::shared_ptr<VirtualTexture> texture{new VirtualTexture{parseVirtualTextureFile(filepath)}};
+        const VirtualTextureLayout& layout = texture->source.layout;
+        if (!mDevice.isFormatSupported(
+                layout.format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+        {
+            throw std::runtime_error("virtual texture format can't be sampled on this device: " + filepath);
+        }
+
+        VkDeviceSize feedbackSize = layout.pageCount() * sizeof(uint32_t);
+        if (feedbackUsed + feedbackSize > feedbackBuffers[0]->getBufferSize())
+        {
+            throw std::runtime_error("virtual texture feedback buffers are full: " + filepath);
+        }
+        texture->feedbackOffset = feedbackUsed;
+        feedbackUsed = alignUp(feedbackUsed + feedbackSize, feedbackAlignment);
+
+        texture->cache = findCache(layout.format, layout.tileBytes);
+        TileCache& cache = caches[texture->cache];
+        texture->slots.assign(layout.pageCount(), NOT_RESIDENT);
+        texture->pageTable = std::make_unique<LveTexture>(
+            mDevice, VK_FORMAT_R8G8B8A8_UINT, VkExtent2D{layout.pagesX(0), layout.pagesY(0)}, layout.levelCount, 1,
+            VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        for (auto& staging : texture->pageTableStaging)
+        {
+            staging = std::make_unique<LveBuffer>(
+                mDevice,
+                sizeof(uint32_t),
+                layout.pageCount(),
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            staging->map();
+        }
+
+        // the last level is a single page, the fallback of every other page
+        uint32_t lastPage = layout.pageCount() - 1;
+        uint32_t slot = acquireSlot(cache);
+        if (slot == NOT_RESIDENT)
+        {
+            throw std::runtime_error("virtual texture tile cache is full: " + filepath);
+        }
+        cache.slots[slot] = Slot{texture.get(), lastPage, updateCount, true};
+        texture->slots[lastPage] = slot;
+        texture->dirty = true;
+
+        LveBuffer staging{
+            mDevice,
+            layout.tileBytes,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        staging.map();
+        std::memcpy(staging.getMappedMemory(), texture->source.tile(lastPage), static_cast<size_t>(layout.tileBytes));
+
+        VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+        recordAtlasToTransfer(commandBuffer, cache);
+        recordTileCopy(commandBuffer, cache, staging.getBuffer(), 0, slot);
+        recordAtlasToShaderRead(commandBuffer, cache);
+        mDevice.endSingleTimeCommands(commandBuffer);
+        // its page table, and the one of a texture the slot was taken from, are dirty until the next update
+        textures.push_back(texture);
+        return texture;
+    }
+
+    void VirtualTextureSystem::update(int frameIndex, VkCommandBuffer commandBuffer)
+    {
+        // nothing asks for pages, and nothing was recorded by the frame of this index either
+        if (textures.empty()) return;
+        updateCount++;
+
+        // the frame that copied out of these last time has finished
+        for (TileCache& cache : caches)
+        {
+            std::vector<uint32_t>& copied = cache.copiedStaging[frameIndex];
+            cache.freeStaging.insert(cache.freeStaging.end(), copied.begin(), copied.end());
+            copied.clear();
+        }
+
+        // requests of the frame that used this index last, its fence was waited on
+        struct Request
+        {
+            VirtualTexture* texture;
+            uint32_t page;
+            uint32_t level;
+        };
+        std::vector<Request> requests;
+        uint32_t* flags = static_cast<uint32_t*>(feedbackBuffers[frameIndex]->getMappedMemory());
+        for (auto& texture : textures)
+        {
+            const VirtualTextureLayout& layout = texture->source.layout;
+            TileCache& cache = caches[texture->cache];
+            uint32_t* requested = flags + texture->feedbackOffset / sizeof(uint32_t);
+            for (uint32_t page = 0; page < layout.pageCount(); page++)
+            {
+                if (requested[page] == 0) continue;
+                requested[page] = 0;
+
+                // the page and the coarser ones it is drawn with until it arrives, the last level is always resident
+                for (uint32_t current = page;; current = layout.parentPage(current))
+                {
+                    uint32_t slot = texture->slots[current];
+                    if (slot < LOADING)
+                    {
+                        cache.slots[slot].lastUsed = updateCount;
+                        break;
+                    }
+                    if (slot == NOT_RESIDENT)
+                    {
+                        requests.push_back({texture.get(), current, layout.pageLevel(current)});
+                    }
+                }
+            }
+        }
+
+        std::vector<bool> atlasInTransfer(caches.size(), false);
+
+        for (auto it = loads.begin(); it != loads.end();)
+        {
+            if (it->load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            it->load.get();
+            TileCache& cache = caches[it->texture->cache];
+            if (!atlasInTransfer[it->texture->cache])
+            {
+                recordAtlasToTransfer(commandBuffer, cache);
+                atlasInTransfer[it->texture->cache] = true;
+            }
+            recordTileCopy(commandBuffer, cache, cache.staging->getBuffer(), it->staging * cache.tileBytes, it->slot);
+            cache.copiedStaging[frameIndex].push_back(it->staging);
+            it->texture->slots[it->page] = it->slot;
+            it->texture->dirty = true;
+            tilesUploaded++;
+            it = loads.erase(it);
+        }
+
+        // coarse pages first: they cover the most screen and are the fallback of the finer ones
+        std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) { return a.level > b.level; });
+        for (const Request& request : requests)
+        {
+            // pages shared by several requested ones are queued once
+            if (request.texture->slots[request.page] != NOT_RESIDENT) continue;
+            TileCache& cache = caches[request.texture->cache];
+            if (cache.freeStaging.empty()) continue;
+            uint32_t slot = acquireSlot(cache);
+            if (slot == NOT_RESIDENT) continue;
+
+            uint32_t staging = cache.freeStaging.back();
+            cache.freeStaging.pop_back();
+            cache.slots[slot] = Slot{request.texture, request.page, updateCount, false};
+            request.texture->slots[request.page] = LOADING;
+
+            // the worker only copies out of the mapping, which the shared file keeps alive
+            std::shared_ptr<MappedFile> file = request.texture->source.file;
+            const uint8_t* tile = request.texture->source.tile(request.page);
+            uint8_t* destination = static_cast<uint8_t*>(cache.staging->getMappedMemory()) + staging * cache.tileBytes;
+            size_t size = static_cast<size_t>(cache.tileBytes);
+
+            TileLoad load{request.texture, request.page, slot, staging, {}};
+            load.load = mThreadPool.submit([file, tile, destination, size]() { std::memcpy(destination, tile, size); });
+            loads.push_back(std::move(load));
+        }
+
+        for (size_t i = 0; i < caches.size(); i++)
+        {
+            if (atlasInTransfer[i]) recordAtlasToShaderRead(commandBuffer, caches[i]);
+        }
+        // arrived pages, evicted ones and textures loaded since the last update
+        for (auto& texture : textures)
+        {
+            if (texture->dirty) recordPageTableUpload(commandBuffer, *texture, frameIndex);
+        }
+    }
+
+    VkDescriptorImageInfo VirtualTextureSystem::getTileCacheInfo(const VirtualTexture& texture) const
+    {
+        return caches[texture.cache].atlas->getImageInfo();
+    }
+
+    VkDescriptorBufferInfo VirtualTextureSystem::getFeedbackInfo(const VirtualTexture* texture, int frameIndex) const
+    {
+        VkDescriptorBufferInfo info{};
+        info.buffer = feedbackBuffers[frameIndex]->getBuffer();
+        info.offset = texture ? texture->feedbackOffset : 0;
+        info.range = texture ? texture->source.layout.pageCount() * sizeof(uint32_t) : feedbackAlignment;
+        return info;
+    }
+
+    void VirtualTextureSystem::recordFeedbackBarrier(VkCommandBuffer commandBuffer) const
+    {
+        // update reads no feedback before a texture is loaded
+        if (textures.empty()) return;
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr);
+    }
+
+    uint32_t VirtualTextureSystem::findCache(VkFormat format, VkDeviceSize tileBytes)
+    {
+        for (uint32_t i = 0; i < caches.size(); i++)
+        {
+            if (caches[i].format == format)
+            {
+                assert(caches[i].tileBytes == tileBytes && "Tiles of one format have one size");
+                return i;
+            }
+        }
+
+        TileCache cache{};
+        cache.format = format;
+        cache.tileBytes = tileBytes;
+        // page table entries hold 8 bit tile coordinates
+        cache.tilesPerSide = std::min({mCacheTiles, mDevice.properties.limits.maxImageDimension2D / VIRTUAL_TILE_STRIDE, 256u});
+        uint32_t side = cache.tilesPerSide * VIRTUAL_TILE_STRIDE;
+        cache.atlas = std::make_unique<LveTexture>(
+            mDevice, format, VkExtent2D{side, side}, 1, 1, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        cache.slots.resize(static_cast<size_t>(cache.tilesPerSide) * cache.tilesPerSide);
+        cache.staging = std::make_unique<LveBuffer>(
+            mDevice,
+            tileBytes,
+            LOADS_IN_FLIGHT,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        cache.staging->map();
+        for (uint32_t i = LOADS_IN_FLIGHT; i-- > 0;)
+        {
+            cache.freeStaging.push_back(i);
+        }
+        caches.push_back(std::move(cache));
+        return static_cast<uint32_t>(caches.size() - 1);
+    }
+
+    uint32_t VirtualTextureSystem::acquireSlot(TileCache& cache)
+    {
+        uint32_t oldest = NOT_RESIDENT;
+        for (uint32_t i = 0; i < cache.slots.size(); i++)
+        {
+            const Slot& slot = cache.slots[i];
+            if (slot.texture == nullptr) return i;
+            // loading slots are not resident yet, pages used by this update stay
+            if (slot.pinned || slot.lastUsed >= updateCount || slot.texture->slots[slot.page] != i) continue;
+            if (oldest == NOT_RESIDENT || slot.lastUsed < cache.slots[oldest].lastUsed) oldest = i;
+        }
+        if (oldest == NOT_RESIDENT) return NOT_RESIDENT;
+
+        Slot& evicted = cache.slots[oldest];
+        evicted.texture->slots[evicted.page] = NOT_RESIDENT;
+        evicted.texture->dirty = true;
+        evicted = Slot{};
+        tilesEvicted++;
+        return oldest;
+    }
+
+    void VirtualTextureSystem::recordAtlasToTransfer(VkCommandBuffer commandBuffer, TileCache& cache)
+    {
+        // tiles are overwritten once the fragment shaders of the frames still in flight are done with the atlas
+        MipGenerator::imageBarrier(
+            commandBuffer, cache.atlas->getImage(), 0, 1, 1,
+            cache.atlasInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    void VirtualTextureSystem::recordAtlasToShaderRead(VkCommandBuffer commandBuffer, TileCache& cache)
+    {
+        MipGenerator::imageBarrier(
+            commandBuffer, cache.atlas->getImage(), 0, 1, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        cache.atlasInitialized = true;
+    }
+
+    void VirtualTextureSystem::recordTileCopy(
+        VkCommandBuffer commandBuffer, const TileCache& cache, VkBuffer staging, VkDeviceSize stagingOffset, uint32_t slot)
+    {
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingOffset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {
+            static_cast<int32_t>(slot % cache.tilesPerSide * VIRTUAL_TILE_STRIDE),
+            static_cast<int32_t>(slot / cache.tilesPerSide * VIRTUAL_TILE_STRIDE),
+            0};
+        region.imageExtent = {VIRTUAL_TILE_STRIDE, VIRTUAL_TILE_STRIDE, 1};
+        vkCmdCopyBufferToImage(
+            commandBuffer, staging, cache.atlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+
+    void VirtualTextureSystem::recordPageTableUpload(VkCommandBuffer commandBuffer, VirtualTexture& texture, int frameIndex)
+    {
+        const VirtualTextureLayout& layout = texture.source.layout;
+        const TileCache& cache = caches[texture.cache];
+        LveBuffer& staging = *texture.pageTableStaging[frameIndex];
+        uint32_t* entries = static_cast<uint32_t*>(staging.getMappedMemory());
+
+        // coarsest level first, a page that is not resident repeats the entry of its parent
+        for (uint32_t level = layout.levelCount; level-- > 0;)
+        {
+            for (uint32_t y = 0; y < layout.pagesY(level); y++)
+            {
+                for (uint32_t x = 0; x < layout.pagesX(level); x++)
+                {
+                    uint32_t page = layout.pageIndex(level, x, y);
+                    uint32_t slot = texture.slots[page];
+                    if (slot < LOADING)
+                    {
+                        entries[page] = packEntry(slot % cache.tilesPerSide, slot / cache.tilesPerSide, level);
+                    }
+                    else
+                    {
+                        assert(level + 1 < layout.levelCount && "The last level is always resident");
+                        entries[page] = entries[layout.pageIndex(level + 1, x / 2, y / 2)];
+                    }
+                }
+            }
+        }
+
+        // every level is rewritten, the old contents can go
+        VkImage image = texture.pageTable->getImage();
+        MipGenerator::imageBarrier(
+            commandBuffer, image, 0, layout.levelCount, 1,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        std::vector<VkBufferImageCopy> regions(layout.levelCount);
+        for (uint32_t level = 0; level < layout.levelCount; level++)
+        {
+            regions[level].bufferOffset = layout.firstPage[level] * sizeof(uint32_t);
+            regions[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+            regions[level].imageExtent = {layout.pagesX(level), layout.pagesY(level), 1};
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer, staging.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()), regions.data());
+
+        MipGenerator::imageBarrier(
+            commandBuffer, image, 0, layout.levelCount, 1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        texture.dirty = false;
+    }
+
+    void VirtualTextureSystem::dumpStats(std::ostream& out) const
+    {
+        out << "VirtualTextureSystem: " << textures.size() << " textures, " << tilesUploaded << " tiles uploaded, "
+            << tilesEvicted << " evicted, " << loads.size() << " loading\n";
+        for (const TileCache& cache : caches)
+        {
+            size_t used = std::count_if(
+                cache.slots.begin(), cache.slots.end(), [](const Slot& slot) { return slot.texture != nullptr; });
+            out << "  cache format " << cache.format << ": " << used << "/" << cache.slots.size() << " tiles, " << std::fixed
+                << std::setprecision(2) << toMiB(cache.atlas->getMemorySize()) << " MiB\n"
+                << std::defaultfloat;
+        }
+        for (const auto& texture : textures)
+        {
+            const VirtualTextureLayout& layout = texture->source.layout;
+            size_t resident = std::count_if(
+                texture->slots.begin(), texture->slots.end(), [](uint32_t slot) { return slot < LOADING; });
+            out << "  " << layout.width << "x" << layout.height << ", " << layout.levelCount << " levels: " << resident << "/"
+                << layout.pageCount() << " pages resident\n";
+        }
+    }
+}
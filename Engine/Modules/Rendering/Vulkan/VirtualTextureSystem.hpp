@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+#include "SwapChain.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+#include "VirtualTextureFile.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    class VirtualTextureSystem;
+
+    // a texture larger than device memory should hold, only the pages that were sampled recently are resident
+    class VirtualTexture
+    {
+    public:
+        VirtualTexture(const VirtualTexture&) = delete;
+        VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+        const VirtualTextureLayout& getLayout() const { return source.layout; }
+        // one RGBA8_UINT texel per page and level: tile x / y in the cache and the level the tile belongs to,
+        // pages that are not resident point at the finest resident page covering them
+        VkDescriptorImageInfo getPageTableInfo() const { return pageTable->getImageInfo(); }
+
+    private:
+        friend class VirtualTextureSystem;
+        explicit VirtualTexture(VirtualTextureFile file) : source{std::move(file)} {}
+
+        VirtualTextureFile source;
+        uint32_t cache = 0;
+        std::unique_ptr<LveTexture> pageTable;
+        // cache slot of every page, NOT_RESIDENT / LOADING otherwise
+        std::vector<uint32_t> slots;
+        // packed page table texels, written by the cpu and copied into pageTable when dirty,
+        // one per frame index: a frame in flight may still copy out of the one it was recorded with
+        std::array<std::unique_ptr<LveBuffer>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> pageTableStaging;
+        bool dirty = false;
+        // start of this texture's request flags in the feedback buffers, one uint per page
+        VkDeviceSize feedbackOffset = 0;
+    };
+
+    /*************************************************
+    Virtual texturing: huge textures stored as tiles (.vtex, see VirtualTextureFile.hpp) of which only the
+    pages the camera currently sees are kept on the gpu
+    - every format has a tile cache, one atlas of cacheTiles x cacheTiles tiles shared by the textures in it
+    - every texture has a page table with a level per mip level the shader translates virtual uvs through
+      (sampleVirtualTexture in virtual_texture.glsl)
+    - the shader marks the pages it wanted in this frame's feedback buffer; update reads the buffer of the frame
+      whose fence was just waited on, touches the resident pages and queues the missing ones, coarsest level first
+    - missing tiles are copied out of the file mapping into staging slots on the thread pool and uploaded into
+      the least recently used cache slot by a later update, the page tables are rewritten in the same command buffer
+    - update records into the frame's command buffer, a staging slot or page table staging buffer is written again
+      only once the frame that copied out of it finished, when its frame index comes around
+    - the single page of each texture's last level is loaded by load and never evicted, every page has a fallback
+    Not thread safe, call update on the thread that owns the device between beginFrame and the render pass.
+    Until a texture is loaded update and recordFeedbackBarrier record nothing.
+    *************************************************/
+    class VirtualTextureSystem
+    {
+    public:
+        static constexpr uint32_t DEFAULT_CACHE_TILES = 32;
+        // tile loads a cache has in flight at once, each owns a staging slot
+        static constexpr uint32_t LOADS_IN_FLIGHT = 32;
+        static constexpr VkDeviceSize DEFAULT_FEEDBACK_SIZE = 1024 * 1024;
+
+        VirtualTextureSystem(
+            LveDevice& device, ThreadPool& threadPool, uint32_t cacheTiles = DEFAULT_CACHE_TILES,
+            VkDeviceSize feedbackSize = DEFAULT_FEEDBACK_SIZE);
+        // waits for the loads in flight
+        ~VirtualTextureSystem();
+
+        VirtualTextureSystem(const VirtualTextureSystem&) = delete;
+        VirtualTextureSystem& operator=(const VirtualTextureSystem&) = delete;
+
+        // parses the file, creates the page table and uploads the last level, waits for the graphics queue,
+        // the page table is written by the next update
+        std::shared_ptr<VirtualTexture> load(const std::string& filepath);
+
+        // frameIndex: the frame about to be recorded, its previous use has completed
+        // tile copies and page table uploads go into commandBuffer, which has not begun the render pass yet
+        void update(int frameIndex, VkCommandBuffer commandBuffer);
+
+        // the tile cache texture is sampled from, tileCacheSampler is meant as its immutable sampler
+        VkDescriptorImageInfo getTileCacheInfo(const VirtualTexture& texture) const;
+        // request flags of texture in the feedback buffer of frameIndex, nullptr gives a range nothing reads
+        VkDescriptorBufferInfo getFeedbackInfo(const VirtualTexture* texture, int frameIndex) const;
+        // page table of a single resident page, bound when a draw samples no virtual texture
+        VkDescriptorImageInfo getFallbackPageTableInfo() const { return fallbackPageTable->getImageInfo(); }
+
+        // immutable samplers for the descriptor set layouts: nearest for the page tables, bilinear
+        // inside a tile for the caches (tiles have no mips, the level is picked through the page table)
+        VkSampler getPageTableSampler() const { return pageTableSampler; }
+        VkSampler getTileCacheSampler() const { return tileCacheSampler; }
+
+        // makes this frame's feedback writes visible to update, record after the last draw sampling a virtual texture
+        void recordFeedbackBarrier(VkCommandBuffer commandBuffer) const;
+
+        void dumpStats(std::ostream& out = std::cout) const;
+
+    private:
+        static constexpr uint32_t NOT_RESIDENT = UINT32_MAX;
+        static constexpr uint32_t LOADING = UINT32_MAX - 1;
+
+        struct Slot
+        {
+            VirtualTexture* texture = nullptr;
+            uint32_t page = 0;
+            uint64_t lastUsed = 0;
+            bool pinned = false;
+        };
+
+        struct TileCache
+        {
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            VkDeviceSize tileBytes = 0;
+            // slot i is tile (i % tilesPerSide, i / tilesPerSide) of the atlas
+            uint32_t tilesPerSide = 0;
+            std::unique_ptr<LveTexture> atlas;
+            std::vector<Slot> slots;
+            // LOADS_IN_FLIGHT tiles, persistently mapped
+            std::unique_ptr<LveBuffer> staging;
+            std::vector<uint32_t> freeStaging;
+            // slots the frame of each index copied out of, free again once that frame finished
+            std::array<std::vector<uint32_t>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> copiedStaging;
+            bool atlasInitialized = false;
+        };
+
+        struct TileLoad
+        {
+            VirtualTexture* texture = nullptr;
+            uint32_t page = 0;
+            uint32_t slot = 0;
+            uint32_t staging = 0;
+            std::future<void> load;
+        };
+
+        uint32_t findCache(VkFormat format, VkDeviceSize tileBytes);
+        // a free slot, or the least recently used one that was not used in this update, NOT_RESIDENT if none
+        uint32_t acquireSlot(TileCache& cache);
+        void recordAtlasToTransfer(VkCommandBuffer commandBuffer, TileCache& cache);
+        void recordAtlasToShaderRead(VkCommandBuffer commandBuffer, TileCache& cache);
+        void recordTileCopy(
+            VkCommandBuffer commandBuffer, const TileCache& cache, VkBuffer staging, VkDeviceSize stagingOffset, uint32_t slot);
+        void recordPageTableUpload(VkCommandBuffer commandBuffer, VirtualTexture& texture, int frameIndex);
+
+        LveDevice& mDevice;
+        ThreadPool& mThreadPool;
+        uint32_t mCacheTiles;
+
+        std::vector<std::shared_ptr<VirtualTexture>> textures;
+        std::vector<TileCache> caches;
+        std::vector<TileLoad> loads;
+
+        std::array<std::unique_ptr<LveBuffer>, LveSwapChain::MAX_FRAMES_IN_FLIGHT> feedbackBuffers;
+        // the first aligned block is the range bound for draws without a virtual texture
+        VkDeviceSize feedbackUsed = 0;
+        VkDeviceSize feedbackAlignment = 1;
+
+        std::unique_ptr<LveTexture> fallbackPageTable;
+        VkSampler pageTableSampler = VK_NULL_HANDLE;
+        VkSampler tileCacheSampler = VK_NULL_HANDLE;
+
+        uint64_t updateCount = 0;
+        uint64_t tilesUploaded = 0;
+        uint64_t tilesEvicted = 0;
+    };
+}
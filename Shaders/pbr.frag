@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 // Physically Based shading model: Lambetrtian diffuse BRDF + Cook-Torrance microfacet specular BRDF + IBL for ambient.
 
@@ -33,8 +34,18 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     vec4 ambientLightColor;
     PointLight pointLights[10];
     int numLights;
+    // diffuse irradiance of the environment as L2 spherical harmonics, see sh.glsl
+    vec4 irradianceSH[9];
 } ubo;
 
+layout(set = 1, binding = 0) uniform GameObjectBufferData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uvec4 virtualTextures; // x: albedo is sampled through albedoPageTable / albedoTileCache
+} gameObject;
+
 layout(push_constant) uniform Push {
     mat4 modelMatrix; // projection*view
     mat4 normalMatrix;
@@ -42,11 +53,24 @@ layout(push_constant) uniform Push {
 
 layout(set=1, binding=1) uniform sampler2D albedoTexture;
 layout(set=1, binding=2) uniform sampler2D normalTexture;
-layout(set=1, binding=3) uniform sampler2D roughnessTexture;
-layout(set=1, binding=4) uniform sampler2D metalnessTexture;
-layout(set=1, binding=5) uniform samplerCube specularTexture;
-layout(set=1, binding=6) uniform samplerCube irradianceTexture;
-layout(set=1, binding=7) uniform sampler2D specularBRDF_LUT;
+// occlusion in r, roughness in g, metalness in b, the glTF metallicRoughness layout
+layout(set=1, binding=3) uniform sampler2D ormTexture;
+layout(set=1, binding=4) uniform samplerCube specularTexture;
+// binding 5 is unused, diffuse ambient light is ubo.irradianceSH
+layout(set=1, binding=6) uniform sampler2D specularBRDF_LUT;
+// virtual albedo, bound to placeholders unless gameObject.virtualTextures.x is set
+layout(set=1, binding=7) uniform usampler2D albedoPageTable;
+layout(set=1, binding=8) uniform sampler2D albedoTileCache;
+// factors of the material this draw uses, glTF's baseColorFactor / metallicFactor / roughnessFactor
+layout(set=1, binding=10) uniform MaterialBufferData {
+    vec4 baseColorFactor;
+    vec4 factors; // x: metallic, y: roughness
+} material;
+
+#define VT_FEEDBACK_SET 1
+#define VT_FEEDBACK_BINDING 9
+#include "virtual_texture.glsl"
+#include "sh.glsl"
 
 // GGX/Towbridge-Reitz normal distribution function.
 // Uses Disney's reparametrization of alpha = roughness^2.
@@ -82,9 +106,14 @@ vec3 fresnelSchlick(vec3 F0, float cosTheta)
 
 void main(){
     // Sample input textures to get shading model params.
-    vec3 albedo = texture(albedoTexture, fragTexcoord).rgb;
-    float metalness = texture(metalnessTexture, fragTexcoord).r;
-    float roughness = texture(roughnessTexture, fragTexcoord).r;
+    vec3 albedo = gameObject.virtualTextures.x != 0u
+        ? sampleVirtualTexture(albedoPageTable, albedoTileCache, fragTexcoord).rgb
+        : texture(albedoTexture, fragTexcoord).rgb;
+    albedo *= material.baseColorFactor.rgb;
+    vec3 orm = texture(ormTexture, fragTexcoord).rgb;
+    float occlusion = orm.r;
+    float roughness = orm.g * material.factors.y;
+    float metalness = orm.b * material.factors.x;
 
     // Outgoing light direction (vector from world-space fragment position to the "eye").
     vec3 Lo = normalize(ubo.inverseViewMatrix[3].xyz - fragPosWorld);
@@ -142,8 +171,8 @@ void main(){
     // Ambient lighting (IBL).
     vec3 ambientLighting;
     {
-        // Sample diffuse irradiance at normal direction.
-        vec3 irradiance = texture(irradianceTexture, N).rgb;
+        // Evaluate diffuse irradiance at normal direction.
+        vec3 irradiance = shIrradiance(ubo.irradianceSH, N);
 
         // Calculate Fresnel term for ambient lighting.
         // Since we use pre-filtered cubemap(s) and irradiance is coming from many directions
@@ -154,12 +183,12 @@ void main(){
         // Get diffuse contribution factor (as with direct lighting).
         vec3 kd = mix(vec3(1.0) - F, vec3(0.0), metalness);
 
-        // Irradiance map contains exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
+        // The coefficients give exitant radiance assuming Lambertian BRDF, no need to scale by 1/PI here either.
         vec3 diffuseIBL = kd * albedo * irradiance;
 
         // Sample pre-filtered specular reflection environment at correct mipmap level.
         int specularTextureLevels = textureQueryLevels(specularTexture);
-        vec3 specularIrradiance = textureLod(specularTexture, Lr, roughness * specularTextureLevels).rgb;
+        vec3 specularIrradiance = textureLod(specularTexture, Lr, roughness * float(specularTextureLevels - 1)).rgb;
 
         // Split-sum approximation factors for Cook-Torrance specular BRDF.
         vec2 specularBRDF = texture(specularBRDF_LUT, vec2(cosLo, roughness)).rg;
@@ -167,12 +196,12 @@ void main(){
         // Total specular IBL contribution.
         vec3 specularIBL = (F0 * specularBRDF.x + specularBRDF.y) * specularIrradiance;
 
-        // Total ambient lighting contribution.
-        ambientLighting = diffuseIBL + specularIBL;
+        // Total ambient lighting contribution, baked occlusion only darkens the indirect light.
+        ambientLighting = (diffuseIBL + specularIBL) * occlusion;
     }
 
     // Final fragment color.
     //color = vec4(directLighting + ambientLighting, 1.0);
-    color = vec4(texture(albedoTexture, fragTexcoord).rgb, 1.0);
+    color = vec4(albedo, 1.0);
 
 }
\ No newline at end of file
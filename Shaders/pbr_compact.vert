@@ -0,0 +1,63 @@
+#version 450
+
+// pbr.vert for LveModel::CompactVertex: quantized position, octahedral normal/tangent, half float uv
+
+layout(location = 0) in vec4 position;  // unorm16 in model bounds, w is the bitangent sign
+layout(location = 1) in vec2 normal;    // octahedral
+layout(location = 2) in vec2 tangent;   // octahedral
+layout(location = 3) in vec2 texcoord;
+
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec2 fragTexcoord;
+layout(location = 3) out mat3 tangentBasis;
+
+struct PointLight
+{
+    vec4 position; // ignore w
+    vec4 color; // w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColor;
+    PointLight pointLights[10];
+    int numLights;
+} ubo;
+
+layout(set = 1, binding = 0) uniform GameObjectBufferData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 positionScale;
+    vec4 positionOffset;
+} gameObject;
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+} push;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 positionModel = gameObject.positionOffset.xyz + gameObject.positionScale.xyz * position.xyz;
+    vec3 N = octahedralDecode(normal);
+    vec3 T = octahedralDecode(tangent);
+    vec3 B = cross(N, T) * (position.w * 2.0 - 1.0);
+
+    vec4 positionWorld = push.modelMatrix * vec4(positionModel, 1.0);
+    // Output
+    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * gameObject.modelMatrix * vec4(positionModel, 1.0);
+    fragPosWorld = positionWorld.xyz;
+    fragTexcoord = vec2(texcoord.x, 1- texcoord.y);
+    tangentBasis = mat3(gameObject.modelMatrix) * mat3(T, B, N);
+}
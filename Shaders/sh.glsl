@@ -0,0 +1,30 @@
+// L2 spherical harmonics of diffuse irradiance, see SHProjector.hpp
+// not compiled on its own (the .glsl extension is skipped by Shaders/xmake.lua)
+
+// the 9 real basis functions at a unit direction, band 0, band 1 (y, z, x), band 2
+void shBasis(vec3 n, out float basis[9])
+{
+    basis[0] = 0.282095;
+    basis[1] = 0.488603 * n.y;
+    basis[2] = 0.488603 * n.z;
+    basis[3] = 0.488603 * n.x;
+    basis[4] = 1.092548 * n.x * n.y;
+    basis[5] = 1.092548 * n.y * n.z;
+    basis[6] = 0.315392 * (3.0 * n.z * n.z - 1.0);
+    basis[7] = 1.092548 * n.x * n.z;
+    basis[8] = 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// coefficients are projected radiance already convolved with the clamped cosine and divided by pi, so this is
+// irradiance / pi like a cosine weighted irradiance cube; nine terms ring below zero around bright spots
+vec3 shIrradiance(vec4 coefficients[9], vec3 n)
+{
+    float basis[9];
+    shBasis(n, basis);
+    vec3 result = vec3(0.0);
+    for (int i = 0; i < 9; i++)
+    {
+        result += coefficients[i].rgb * basis[i];
+    }
+    return max(result, vec3(0.0));
+}
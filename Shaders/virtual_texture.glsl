@@ -0,0 +1,53 @@
+// Virtual texture sampling, see VirtualTextureSystem.hpp
+// the including shader defines VT_FEEDBACK_SET / VT_FEEDBACK_BINDING for the request flags of the texture it samples
+// and needs GL_GOOGLE_include_directive; not compiled on its own (the .glsl extension is skipped by Shaders/xmake.lua)
+
+// tile layout of the .vtex files, VIRTUAL_TILE_SIZE / VIRTUAL_TILE_BORDER in VirtualTextureFile.hpp
+const int VT_TILE_SIZE = 128;
+const float VT_TILE_BORDER = 4.0;
+const float VT_TILE_STRIDE = float(VT_TILE_SIZE) + 2.0 * VT_TILE_BORDER;
+
+// one flag per page of every level, set for the pages this frame wanted
+layout(set = VT_FEEDBACK_SET, binding = VT_FEEDBACK_BINDING) restrict writeonly buffer VirtualTextureFeedback {
+    uint pageRequests[];
+} vtFeedback;
+
+// texels of a level of the virtual texture, the page table's level 0 has one texel per page
+ivec2 vtLevelSize(usampler2D pageTable, int level)
+{
+    return max((textureSize(pageTable, 0) * VT_TILE_SIZE) >> level, ivec2(1));
+}
+
+// uv repeats like a REPEAT sampler, filtering is bilinear within the level the page table resolves to
+vec4 sampleVirtualTexture(usampler2D pageTable, sampler2D tileCache, vec2 uv)
+{
+    // the level a mip mapped texture would pick, from the derivatives of the unwrapped coordinates
+    vec2 texels = uv * vec2(vtLevelSize(pageTable, 0));
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    int level = clamp(int(floor(lod)), 0, textureQueryLevels(pageTable) - 1);
+
+    vec2 wrapped = fract(uv);
+    ivec2 pages = textureSize(pageTable, level);
+    ivec2 page = min(ivec2(wrapped * vec2(vtLevelSize(pageTable, level))) / VT_TILE_SIZE, pages - 1);
+
+    // a pixel in 16 asks for its page, plenty for pages that span dozens of pixels
+    if (((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) == 0u)
+    {
+        int index = page.y * pages.x + page.x;
+        for (int l = 0; l < level; l++)
+        {
+            ivec2 levelPages = textureSize(pageTable, l);
+            index += levelPages.x * levelPages.y;
+        }
+        vtFeedback.pageRequests[index] = 1u;
+    }
+
+    // the requested page, or the finest resident one covering it: tile x / y in the cache and its level
+    uvec4 entry = texelFetch(pageTable, page, level);
+    vec2 residentTexels = wrapped * vec2(vtLevelSize(pageTable, int(entry.z)));
+    vec2 inTile = mod(residentTexels, float(VT_TILE_SIZE));
+    vec2 cacheTexel = vec2(entry.xy) * VT_TILE_STRIDE + VT_TILE_BORDER + inTile;
+    return textureLod(tileCache, cacheTexel / vec2(textureSize(tileCache, 0)), 0.0);
+}
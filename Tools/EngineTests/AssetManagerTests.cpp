@@ -0,0 +1,50 @@
+#include "TestDevice.hpp"
+#include "TestRegistry.hpp"
+
+#include "AssetManager.hpp"
+
+// std
+#include <memory>
+#include <string>
+
+using RenderingEngine::AssetManager;
+using RenderingEngine::LveTexture;
+using RenderingEngine::MipFilter;
+
+namespace
+{
+    std::shared_ptr<LveTexture> add(AssetManager& manager, const std::string& path, std::shared_ptr<LveTexture> texture)
+    {
+        return manager.addTexture(
+            path, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {}, MipFilter::Box,
+            std::move(texture));
+    }
+
+    std::shared_ptr<LveTexture> find(AssetManager& manager, const std::string& path)
+    {
+        return manager.findTexture(
+            path, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, {}, MipFilter::Box);
+    }
+}
+
+// an asset larger than the whole budget is handed back and stays resident, older unused ones make room
+TEST(AssetManagerKeepsInsertedAssetOverBudget)
+{
+    AssetManager manager{EngineTests::testDevice(), nullptr, 1};
+
+    auto first = EngineTests::makeTestTexture(64);
+    LveTexture* firstTexture = first.get();
+    auto firstHandle = add(manager, "EngineTests/first.png", std::move(first));
+    EXPECT(firstHandle.get() == firstTexture);
+    EXPECT(find(manager, "EngineTests/first.png") == firstHandle);
+
+    // the first one is unused now, adding the second evicts it instead of the second
+    firstHandle.reset();
+    auto second = EngineTests::makeTestTexture(64);
+    LveTexture* secondTexture = second.get();
+    auto secondHandle = add(manager, "EngineTests/second.png", std::move(second));
+    EXPECT(secondHandle.get() == secondTexture);
+    EXPECT(find(manager, "EngineTests/second.png") == secondHandle);
+    EXPECT(find(manager, "EngineTests/first.png") == nullptr);
+    EXPECT(manager.getResidentSize() == secondTexture->getMemorySize());
+}
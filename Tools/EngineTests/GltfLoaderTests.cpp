@@ -0,0 +1,52 @@
+#include "TestRegistry.hpp"
+
+#include "GltfLoader.hpp"
+
+// std
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using RenderingEngine::LveModel;
+
+namespace
+{
+    // true if parsing the document throws the loader's runtime_error
+    bool rejects(const std::string& json)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "EngineTests_invalid.gltf").string();
+        {
+            std::ofstream file{path, std::ios::binary | std::ios::trunc};
+            file << json;
+        }
+        bool threw = false;
+        try
+        {
+            LveModel::Builder builder;
+            RenderingEngine::parseGltfFile(path, builder);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        std::filesystem::remove(path);
+        return threw;
+    }
+
+    std::string documentWithPosition(const std::string& accessor)
+    {
+        return R"({"asset": {"version": "2.0"}, "scenes": [{"nodes": [0]}], "nodes": [{"mesh": 0}],
+                   "meshes": [{"primitives": [{"attributes": {"POSITION": )" + accessor + "}}]}]}";
+    }
+}
+
+// indices that are negative, fractional or out of range are rejected instead of being cast
+TEST(GltfRejectsInvalidIndices)
+{
+    EXPECT(rejects(documentWithPosition("-1")));
+    EXPECT(rejects(documentWithPosition("0.5")));
+    EXPECT(rejects(documentWithPosition("1e300")));
+    EXPECT(rejects(documentWithPosition("\"0\"")));
+    EXPECT(rejects(R"({"asset": {"version": "2.0"}, "nodes": [{"children": [-1]}]})"));
+}
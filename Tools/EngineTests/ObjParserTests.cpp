@@ -0,0 +1,61 @@
+#include "TestRegistry.hpp"
+
+#include "ObjParser.hpp"
+#include "ThreadPool.hpp"
+
+// std
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using RenderingEngine::LveModel;
+
+namespace
+{
+    constexpr size_t CHUNK_SPLIT_SIZE = 4 << 20;
+
+    std::string writeTempFile(const std::string& name, const std::string& contents)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / name).string();
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << contents;
+        return path;
+    }
+
+    std::string commentLines(size_t size)
+    {
+        std::string lines;
+        while (lines.size() + 16 <= size) lines += "# padding line\n";
+        lines.append(size - lines.size() - 1, '#');
+        return lines + "\n";
+    }
+}
+
+// a usemtl that ends the first of two chunks still applies to the faces of the second one
+TEST(ObjUseMaterialAtChunkSplit)
+{
+    std::string head = commentLines(CHUNK_SPLIT_SIZE / 2 - 64) +
+                       "v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+                       "f 1 2 3\n";
+    std::string useMaterial = "usemtl red\n";
+    std::string tail = "f 1 2 3\nf 3 2 1\n";
+    // put the midpoint of the file, where the first chunk ends, inside the usemtl line
+    size_t split = head.size() + useMaterial.size() / 2;
+    std::string contents = head + useMaterial + tail;
+    contents += commentLines(2 * split - contents.size());
+
+    std::string path = writeTempFile("EngineTests_usemtl_split.obj", contents);
+    // one worker and the calling thread, two chunks
+    RenderingEngine::ThreadPool threadPool{1};
+    LveModel::Builder builder;
+    RenderingEngine::parseObjFile(path, builder, &threadPool);
+    std::filesystem::remove(path);
+
+    EXPECT(builder.vertices.size() == 3);
+    EXPECT(builder.submeshes.size() == 2);
+    if (builder.submeshes.size() == 2)
+    {
+        EXPECT(builder.submeshes[0].materialIndex == 0 && builder.submeshes[0].indexCount == 3);
+        EXPECT(builder.submeshes[1].materialIndex == 1 && builder.submeshes[1].indexCount == 6);
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Device.hpp"
+#include "Texture.hpp"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+namespace EngineTests
+{
+    // window and device shared by the tests that need a gpu, created on first use
+    inline RenderingEngine::LveDevice& testDevice()
+    {
+        struct Context
+        {
+            RenderingEngine::Window window{64, 64, "EngineTests"};
+            RenderingEngine::LveDevice device{window};
+        };
+        static Context context;
+        return context.device;
+    }
+
+    // a size x size RGBA8 texture of one color
+    inline std::shared_ptr<RenderingEngine::LveTexture> makeTestTexture(uint32_t size, uint8_t value = 255)
+    {
+        RenderingEngine::LveTexture::ImageData image{};
+        image.width = size;
+        image.height = size;
+        image.size = static_cast<VkDeviceSize>(size) * size * 4;
+        image.pixels = std::shared_ptr<uint8_t>(new uint8_t[image.size], std::default_delete<uint8_t[]>());
+        std::fill(image.pixels.get(), image.pixels.get() + image.size, value);
+        return std::make_shared<RenderingEngine::LveTexture>(
+            testDevice(), image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+}
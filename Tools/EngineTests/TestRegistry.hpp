@@ -0,0 +1,50 @@
+#pragma once
+
+// std
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// minimal self registering tests: TEST(name) { EXPECT(condition); }, run by main.cpp
+namespace EngineTests
+{
+    struct Test
+    {
+        const char* name;
+        std::function<void()> function;
+    };
+
+    inline std::vector<Test>& registry()
+    {
+        static std::vector<Test> tests;
+        return tests;
+    }
+
+    inline int& failureCount()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    struct Registration
+    {
+        Registration(const char* name, std::function<void()> function) { registry().push_back({name, std::move(function)}); }
+    };
+}
+
+#define TEST(name)                                                              \
+    static void name();                                                         \
+    static EngineTests::Registration name##Registration{#name, name};           \
+    static void name()
+
+// a failed expectation is reported and the test continues
+#define EXPECT(condition)                                                                                     \
+    do                                                                                                         \
+    {                                                                                                          \
+        if (!(condition))                                                                                      \
+        {                                                                                                      \
+            EngineTests::failureCount()++;                                                                     \
+            std::cout << "  " << __FILE__ << ":" << __LINE__ << ": expected " << #condition << std::endl;    \
+        }                                                                                                      \
+    } while (false)
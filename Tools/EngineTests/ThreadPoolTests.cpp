@@ -0,0 +1,48 @@
+#include "TestRegistry.hpp"
+
+#include "ThreadPool.hpp"
+
+// std
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+using RenderingEngine::ThreadPool;
+
+// every job of a saturated pool calls parallelFor, the callers finish the work themselves instead of deadlocking
+TEST(ParallelForInsideJobs)
+{
+    ThreadPool threadPool{2};
+    std::atomic<size_t> calls{0};
+    std::vector<std::future<void>> jobs;
+    for (int i = 0; i < 8; i++)
+    {
+        jobs.push_back(threadPool.submit([&]() { threadPool.parallelFor(16, [&](size_t) { calls++; }); }));
+    }
+    for (auto& job : jobs)
+    {
+        job.get();
+    }
+    EXPECT(calls == 8 * 16);
+}
+
+TEST(ParallelForRethrows)
+{
+    ThreadPool threadPool{2};
+    std::atomic<size_t> calls{0};
+    bool threw = false;
+    try
+    {
+        threadPool.parallelFor(32, [&](size_t index) {
+            calls++;
+            if (index == 5) throw std::runtime_error("index 5");
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        threw = true;
+    }
+    EXPECT(threw);
+    EXPECT(calls == 32);
+}
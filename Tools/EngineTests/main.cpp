@@ -0,0 +1,34 @@
+// Runs the engine's regression tests, returns the number of failed expectations
+// usage: EngineTests [name filter]
+
+#include "TestRegistry.hpp"
+
+// std
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : "";
+    int run = 0;
+    for (const EngineTests::Test& test : EngineTests::registry())
+    {
+        if (std::strstr(test.name, filter) == nullptr) continue;
+        std::cout << test.name << std::endl;
+        int failures = EngineTests::failureCount();
+        try
+        {
+            test.function();
+        }
+        catch (const std::exception& e)
+        {
+            EngineTests::failureCount()++;
+            std::cout << "  threw: " << e.what() << std::endl;
+        }
+        std::cout << (EngineTests::failureCount() == failures ? "  passed" : "  FAILED") << std::endl;
+        run++;
+    }
+    std::cout << run << " tests, " << EngineTests::failureCount() << " failed expectations" << std::endl;
+    return EngineTests::failureCount();
+}
@@ -0,0 +1,7 @@
+-- xmake build EngineTests && xmake run EngineTests [name filter]
+target("EngineTests")
+    set_default(false)
+    set_kind("binary")
+    add_files("*.cpp")
+    add_deps("VulkanRHI", "Window")
+    add_includedirs("$(projectdir)/Engine/Modules/Rendering/Vulkan", "$(projectdir)/Engine/Modules/Window", "$(projectdir)/Engine/External")
@@ -0,0 +1,196 @@
+#include "BcEncoder.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        uint16_t packRgb565(const float color[3])
+        {
+            auto quantize = [](float value, float maximum) {
+                return static_cast<uint16_t>(std::clamp(std::lround(value / 255.0f * maximum), 0l, static_cast<long>(maximum)));
+            };
+            return static_cast<uint16_t>(quantize(color[0], 31.0f) << 11 | quantize(color[1], 63.0f) << 5 | quantize(color[2], 31.0f));
+        }
+
+        void unpackRgb565(uint16_t packed, int color[3])
+        {
+            int r = packed >> 11;
+            int g = (packed >> 5) & 63;
+            int b = packed & 31;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        void writeLittleEndian(uint8_t* out, uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; i++)
+            {
+                out[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        // the color half shared by BC1 and BC3, always four color mode
+        void encodeColorBlock(const uint8_t texels[16][4], uint8_t out[8])
+        {
+            float mean[3]{};
+            for (int i = 0; i < 16; i++)
+            {
+                for (int c = 0; c < 3; c++) mean[c] += texels[i][c] / 16.0f;
+            }
+
+            float covariance[6]{};
+            for (int i = 0; i < 16; i++)
+            {
+                float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1], texels[i][2] - mean[2]};
+                covariance[0] += d[0] * d[0];
+                covariance[1] += d[0] * d[1];
+                covariance[2] += d[0] * d[2];
+                covariance[3] += d[1] * d[1];
+                covariance[4] += d[1] * d[2];
+                covariance[5] += d[2] * d[2];
+            }
+
+            // power iteration converges to the principal axis in a few steps for 3x3
+            float axis[3] = {1.0f, 1.0f, 1.0f};
+            for (int iteration = 0; iteration < 8; iteration++)
+            {
+                float next[3] = {
+                    covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                    covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                    covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]};
+                float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+                if (length < 1e-6f) break;
+                for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+            }
+
+            float minT = 0.0f;
+            float maxT = 0.0f;
+            for (int i = 0; i < 16; i++)
+            {
+                float t = (texels[i][0] - mean[0]) * axis[0] + (texels[i][1] - mean[1]) * axis[1] + (texels[i][2] - mean[2]) * axis[2];
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+            // pull the endpoints in a little, the extremes are rarely hit exactly by the interpolated entries
+            float inset = (maxT - minT) / 16.0f;
+            float endpoint0[3];
+            float endpoint1[3];
+            for (int c = 0; c < 3; c++)
+            {
+                endpoint0[c] = std::clamp(mean[c] + axis[c] * (maxT - inset), 0.0f, 255.0f);
+                endpoint1[c] = std::clamp(mean[c] + axis[c] * (minT + inset), 0.0f, 255.0f);
+            }
+
+            uint16_t color0 = packRgb565(endpoint0);
+            uint16_t color1 = packRgb565(endpoint1);
+            if (color0 < color1) std::swap(color0, color1);
+
+            uint32_t indices = 0;
+            if (color0 != color1)
+            {
+                int palette[4][3];
+                unpackRgb565(color0, palette[0]);
+                unpackRgb565(color1, palette[1]);
+                for (int c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                for (int i = 0; i < 16; i++)
+                {
+                    int best = 0;
+                    int bestError = INT32_MAX;
+                    for (int entry = 0; entry < 4; entry++)
+                    {
+                        int error = 0;
+                        for (int c = 0; c < 3; c++)
+                        {
+                            int d = texels[i][c] - palette[entry][c];
+                            error += d * d;
+                        }
+                        if (error < bestError)
+                        {
+                            bestError = error;
+                            best = entry;
+                        }
+                    }
+                    indices |= static_cast<uint32_t>(best) << (2 * i);
+                }
+            }
+
+            writeLittleEndian(out, color0, 2);
+            writeLittleEndian(out + 2, color1, 2);
+            writeLittleEndian(out + 4, indices, 4);
+        }
+    }
+
+    void encodeBlockBC1(const uint8_t texels[16][4], uint8_t out[8])
+    {
+        encodeColorBlock(texels, out);
+    }
+
+    void encodeBlockBC3(const uint8_t texels[16][4], uint8_t out[16])
+    {
+        uint8_t alpha[16];
+        for (int i = 0; i < 16; i++) alpha[i] = texels[i][3];
+        encodeBlockBC4(alpha, out);
+        encodeColorBlock(texels, out + 8);
+    }
+
+    void encodeBlockBC4(const uint8_t values[16], uint8_t out[8])
+    {
+        uint8_t maximum = *std::max_element(values, values + 16);
+        uint8_t minimum = *std::min_element(values, values + 16);
+
+        // endpoint0 > endpoint1 selects the eight entry palette
+        uint64_t indices = 0;
+        if (maximum != minimum)
+        {
+            int palette[8];
+            palette[0] = maximum;
+            palette[1] = minimum;
+            for (int entry = 2; entry < 8; entry++)
+            {
+                palette[entry] = ((8 - entry) * maximum + (entry - 1) * minimum + 3) / 7;
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int best = 0;
+                int bestError = INT32_MAX;
+                for (int entry = 0; entry < 8; entry++)
+                {
+                    int error = std::abs(values[i] - palette[entry]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        best = entry;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+
+        out[0] = maximum;
+        out[1] = minimum;
+        writeLittleEndian(out + 2, indices, 6);
+    }
+
+    void encodeBlockBC5(const uint8_t texels[16][4], uint8_t out[16])
+    {
+        uint8_t red[16];
+        uint8_t green[16];
+        for (int i = 0; i < 16; i++)
+        {
+            red[i] = texels[i][0];
+            green[i] = texels[i][1];
+        }
+        encodeBlockBC4(red, out);
+        encodeBlockBC4(green, out + 8);
+    }
+}
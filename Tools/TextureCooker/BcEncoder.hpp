@@ -0,0 +1,16 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+namespace RenderingEngine
+{
+    // 4x4 block encoders, texels are row major 8 bit rgba
+    // endpoints come from the principal axis (color) or the range (single channel), indices from the nearest palette entry
+    void encodeBlockBC1(const uint8_t texels[16][4], uint8_t out[8]);
+    // BC4 style alpha block followed by a BC1 color block
+    void encodeBlockBC3(const uint8_t texels[16][4], uint8_t out[16]);
+    void encodeBlockBC4(const uint8_t values[16], uint8_t out[8]);
+    // red and green as two BC4 blocks
+    void encodeBlockBC5(const uint8_t texels[16][4], uint8_t out[16]);
+}
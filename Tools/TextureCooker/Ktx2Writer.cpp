@@ -0,0 +1,208 @@
+#include "Ktx2Writer.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        constexpr uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+        // khr_df values used below
+        constexpr uint8_t MODEL_RGBSDA = 1;
+        constexpr uint8_t MODEL_BC1A = 128;
+        constexpr uint8_t MODEL_BC3 = 130;
+        constexpr uint8_t MODEL_BC4 = 131;
+        constexpr uint8_t MODEL_BC5 = 132;
+        constexpr uint8_t PRIMARIES_BT709 = 1;
+        constexpr uint8_t TRANSFER_LINEAR = 1;
+        constexpr uint8_t TRANSFER_SRGB = 2;
+        constexpr uint8_t CHANNEL_ALPHA = 15;
+        constexpr uint8_t QUALIFIER_LINEAR = 0x10;
+        constexpr uint8_t QUALIFIER_SIGNED = 0x40;
+        constexpr uint8_t QUALIFIER_FLOAT = 0x80;
+
+        struct Sample
+        {
+            uint16_t bitOffset;
+            uint8_t bitLength;
+            uint8_t channel;
+            uint32_t lower;
+            uint32_t upper;
+        };
+
+        struct FormatInfo
+        {
+            uint8_t model;
+            uint8_t transfer;
+            bool blockCompressed;
+            uint32_t bytesPerBlock;
+            std::vector<Sample> samples;
+        };
+
+        FormatInfo describeFormat(VkFormat format)
+        {
+            const uint32_t unormMax = 0xFFFFFFFFu;
+            switch (format)
+            {
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            {
+                bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB;
+                // alpha of an srgb format stays linear
+                uint8_t alpha = CHANNEL_ALPHA | (srgb ? QUALIFIER_LINEAR : 0);
+                return {MODEL_RGBSDA, srgb ? TRANSFER_SRGB : TRANSFER_LINEAR, false, 4,
+                        {{0, 7, 0, 0, 255}, {8, 7, 1, 0, 255}, {16, 7, 2, 0, 255}, {24, 7, alpha, 0, 255}}};
+            }
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+            {
+                const uint8_t qualifiers = QUALIFIER_FLOAT | QUALIFIER_SIGNED;
+                // -1.0f and 1.0f
+                const uint32_t lower = 0xBF800000u;
+                const uint32_t upper = 0x3F800000u;
+                return {MODEL_RGBSDA, TRANSFER_LINEAR, false, 8,
+                        {{0, 15, static_cast<uint8_t>(0 | qualifiers), lower, upper},
+                         {16, 15, static_cast<uint8_t>(1 | qualifiers), lower, upper},
+                         {32, 15, static_cast<uint8_t>(2 | qualifiers), lower, upper},
+                         {48, 15, static_cast<uint8_t>(CHANNEL_ALPHA | qualifiers), lower, upper}}};
+            }
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                return {MODEL_BC1A, TRANSFER_LINEAR, true, 8, {{0, 63, 0, 0, unormMax}}};
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                return {MODEL_BC1A, TRANSFER_SRGB, true, 8, {{0, 63, 0, 0, unormMax}}};
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                return {MODEL_BC3, format == VK_FORMAT_BC3_SRGB_BLOCK ? TRANSFER_SRGB : TRANSFER_LINEAR, true, 16,
+                        {{0, 63, CHANNEL_ALPHA, 0, unormMax}, {64, 63, 0, 0, unormMax}}};
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                return {MODEL_BC4, TRANSFER_LINEAR, true, 8, {{0, 63, 0, 0, unormMax}}};
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                return {MODEL_BC5, TRANSFER_LINEAR, true, 16, {{0, 63, 0, 0, unormMax}, {64, 63, 1, 0, unormMax}}};
+            default:
+                throw std::runtime_error("no KTX2 data format descriptor for format " + std::to_string(format));
+            }
+        }
+
+        template <typename T>
+        void append(std::vector<uint8_t>& out, T value)
+        {
+            uint8_t bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        void padTo(std::vector<uint8_t>& out, size_t alignment)
+        {
+            out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+        }
+
+        std::vector<uint8_t> buildDataFormatDescriptor(const FormatInfo& info)
+        {
+            uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(info.samples.size());
+            std::vector<uint8_t> dfd;
+            append<uint32_t>(dfd, 4 + blockSize);
+            // khronos vendor, basic descriptor type
+            append<uint32_t>(dfd, 0);
+            append<uint32_t>(dfd, 2u | blockSize << 16);
+            dfd.push_back(info.model);
+            dfd.push_back(PRIMARIES_BT709);
+            dfd.push_back(info.transfer);
+            dfd.push_back(0); // straight alpha
+            // texel block dimensions minus one
+            uint8_t blockDimension = info.blockCompressed ? 3 : 0;
+            dfd.insert(dfd.end(), {blockDimension, blockDimension, 0, 0});
+            dfd.push_back(static_cast<uint8_t>(info.bytesPerBlock));
+            dfd.insert(dfd.end(), 7, 0);
+            for (const Sample& sample : info.samples)
+            {
+                append<uint16_t>(dfd, sample.bitOffset);
+                dfd.push_back(sample.bitLength);
+                dfd.push_back(sample.channel);
+                append<uint32_t>(dfd, 0); // sample position
+                append<uint32_t>(dfd, sample.lower);
+                append<uint32_t>(dfd, sample.upper);
+            }
+            return dfd;
+        }
+
+        std::vector<uint8_t> buildKeyValueData()
+        {
+            const char key[] = "KTXwriter";
+            const char value[] = "RenderingEngine TextureCooker";
+            std::vector<uint8_t> kvd;
+            append<uint32_t>(kvd, static_cast<uint32_t>(sizeof(key) + sizeof(value)));
+            kvd.insert(kvd.end(), key, key + sizeof(key));
+            kvd.insert(kvd.end(), value, value + sizeof(value));
+            padTo(kvd, 4);
+            return kvd;
+        }
+    }
+
+    void writeKtx2File(
+        const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels)
+    {
+        FormatInfo info = describeFormat(format);
+        uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+        std::vector<uint8_t> file{IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER)};
+        append<uint32_t>(file, format);
+        // typeSize, the size of one component for byte swapping, 1 for block compressed data
+        append<uint32_t>(file, format == VK_FORMAT_R16G16B16A16_SFLOAT ? 2 : 1);
+        append<uint32_t>(file, width);
+        append<uint32_t>(file, height);
+        append<uint32_t>(file, 0); // depth
+        append<uint32_t>(file, 0); // layers
+        append<uint32_t>(file, 1); // faces
+        append<uint32_t>(file, levelCount);
+        append<uint32_t>(file, 0); // supercompression
+
+        std::vector<uint8_t> dfd = buildDataFormatDescriptor(info);
+        std::vector<uint8_t> kvd = buildKeyValueData();
+        uint32_t dfdOffset = static_cast<uint32_t>(file.size() + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t) + levelCount * 3 * sizeof(uint64_t));
+        uint32_t kvdOffset = dfdOffset + static_cast<uint32_t>(dfd.size());
+        append<uint32_t>(file, dfdOffset);
+        append<uint32_t>(file, static_cast<uint32_t>(dfd.size()));
+        append<uint32_t>(file, kvdOffset);
+        append<uint32_t>(file, static_cast<uint32_t>(kvd.size()));
+        append<uint64_t>(file, 0); // supercompression global data
+        append<uint64_t>(file, 0);
+
+        size_t levelIndex = file.size();
+        file.resize(file.size() + levelCount * 3 * sizeof(uint64_t));
+        file.insert(file.end(), dfd.begin(), dfd.end());
+        file.insert(file.end(), kvd.begin(), kvd.end());
+
+        // smallest level first, each aligned to lcm(block size, 4)
+        size_t alignment = std::lcm<size_t>(info.bytesPerBlock, 4);
+        for (uint32_t level = levelCount; level-- > 0;)
+        {
+            padTo(file, alignment);
+            uint64_t entry[3] = {file.size(), levels[level].size(), levels[level].size()};
+            std::memcpy(file.data() + levelIndex + level * sizeof(entry), entry, sizeof(entry));
+            file.insert(file.end(), levels[level].begin(), levels[level].end());
+        }
+
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+            out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+            if (!out)
+            {
+                throw std::runtime_error("failed to write " + temporary);
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("failed to replace " + path + ": " + error.message());
+        }
+    }
+}
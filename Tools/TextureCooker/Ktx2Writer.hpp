@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    Writes a single layer 2D KTX2 file without supercompression, what parseKtx2File reads back
+    - levels[0] is the full size level, every level is already encoded in format
+    - the data format descriptor is filled for the formats the cooker produces
+      (R8G8B8A8 unorm / srgb, R16G16B16A16 sfloat, BC1 / BC3 / BC4 / BC5)
+    Written to <path>.tmp first and renamed, a reader never sees half a file.
+    *************************************************/
+    void writeKtx2File(
+        const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& levels);
+}
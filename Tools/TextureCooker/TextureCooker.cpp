@@ -0,0 +1,456 @@
+#include "TextureCooker.hpp"
+#include "BcEncoder.hpp"
+#include "MappedFile.hpp"
+#include "PixelConversion.hpp"
+#include "VirtualTextureFile.hpp"
+
+// private copy, linking the engine's stb_image would pull Texture.cpp and the device in with it
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    namespace
+    {
+        const char* FORMAT_NAMES[] = {"rgba8", "rgba16f", "bc1", "bc3", "bc4", "bc5"};
+        const char CHANNEL_NAMES[] = "rgba";
+
+        bool isBlockCompressed(CookFormat format)
+        {
+            return format != CookFormat::RGBA8 && format != CookFormat::RGBA16F;
+        }
+
+        size_t bytesPerBlock(CookFormat format)
+        {
+            switch (format)
+            {
+            case CookFormat::RGBA8: return 4;
+            case CookFormat::RGBA16F: return 8;
+            case CookFormat::BC1:
+            case CookFormat::BC4: return 8;
+            default: return 16;
+            }
+        }
+
+        uint32_t parseChannelName(const std::string& name)
+        {
+            const char* found = name.size() == 1 ? std::strchr(CHANNEL_NAMES, name[0]) : nullptr;
+            if (!found || *found == '\0')
+            {
+                throw std::runtime_error("channel must be one of r, g, b, a: " + name);
+            }
+            return static_cast<uint32_t>(found - CHANNEL_NAMES);
+        }
+
+        float srgbToLinear(float value)
+        {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgb(float value)
+        {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        CookImage loadSource(const std::string& path)
+        {
+            int width, height, channels;
+            CookImage image{};
+            if (stbi_is_hdr(path.c_str()))
+            {
+                float* pixels = stbi_loadf(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+                if (!pixels) throw std::runtime_error("failed to load " + path + ": " + stbi_failure_reason());
+                image.texels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+                stbi_image_free(pixels);
+            }
+            else
+            {
+                stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+                if (!pixels) throw std::runtime_error("failed to load " + path + ": " + stbi_failure_reason());
+                image.texels.resize(static_cast<size_t>(width) * height * 4);
+                for (size_t i = 0; i < image.texels.size(); i++)
+                {
+                    image.texels[i] = pixels[i] / 255.0f;
+                }
+                stbi_image_free(pixels);
+            }
+            image.width = static_cast<uint32_t>(width);
+            image.height = static_cast<uint32_t>(height);
+            return image;
+        }
+
+        // 2x2 box, an odd last row / column is folded into its neighbour's footprint by clamping
+        CookImage downsample(const CookImage& source, bool normalMap)
+        {
+            CookImage level{};
+            level.width = std::max(source.width / 2, 1u);
+            level.height = std::max(source.height / 2, 1u);
+            level.texels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+            for (uint32_t y = 0; y < level.height; y++)
+            {
+                for (uint32_t x = 0; x < level.width; x++)
+                {
+                    float sum[4]{};
+                    for (uint32_t dy = 0; dy < 2; dy++)
+                    {
+                        for (uint32_t dx = 0; dx < 2; dx++)
+                        {
+                            uint32_t sx = std::min(x * 2 + dx, source.width - 1);
+                            uint32_t sy = std::min(y * 2 + dy, source.height - 1);
+                            const float* texel = &source.texels[(static_cast<size_t>(sy) * source.width + sx) * 4];
+                            for (int c = 0; c < 4; c++) sum[c] += texel[c];
+                        }
+                    }
+
+                    float* out = &level.texels[(static_cast<size_t>(y) * level.width + x) * 4];
+                    for (int c = 0; c < 4; c++) out[c] = sum[c] * 0.25f;
+                    if (normalMap)
+                    {
+                        float n[3] = {out[0] * 2.0f - 1.0f, out[1] * 2.0f - 1.0f, out[2] * 2.0f - 1.0f};
+                        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                        if (length < 1e-5f)
+                        {
+                            n[0] = 0.0f;
+                            n[1] = 0.0f;
+                            n[2] = 1.0f;
+                            length = 1.0f;
+                        }
+                        for (int c = 0; c < 3; c++) out[c] = n[c] / length * 0.5f + 0.5f;
+                    }
+                }
+            }
+            return level;
+        }
+
+        void quantizeTexel(const float* texel, bool srgb, uint8_t out[4])
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                float value = srgb && c < 3 ? linearToSrgb(std::clamp(texel[c], 0.0f, 1.0f)) : texel[c];
+                out[c] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+            }
+        }
+    }
+
+    CookSettings parseCookSettings(const JsonValue& entry, const std::string& baseDirectory)
+    {
+        auto resolve = [&baseDirectory](const std::string& path) {
+            return (std::filesystem::path{baseDirectory} / path).lexically_normal().generic_string();
+        };
+
+        // a number is a constant, an object a channel of a source, a string the red channel of a grayscale source
+        auto parseChannel = [&resolve](const JsonValue& channel, uint32_t defaultChannel, CookChannel& out) {
+            if (channel.isNumber())
+            {
+                double constant = channel.asNumber();
+                if (!(constant >= 0.0 && constant <= 1.0))
+                {
+                    throw std::runtime_error("channel constants must be in [0, 1]: " + std::to_string(constant));
+                }
+                out.constant = static_cast<float>(constant);
+            }
+            else if (channel.isString())
+            {
+                out.source = resolve(channel.asString());
+                out.channel = 0;
+            }
+            else if (channel.isObject())
+            {
+                out.source = resolve(channel["source"].asString());
+                out.channel = channel.has("channel") ? parseChannelName(channel["channel"].asString()) : defaultChannel;
+            }
+        };
+
+        CookSettings settings{};
+        if (entry["source"].isString())
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                settings.channels[c] = CookChannel{resolve(entry["source"].asString()), c, 0.0f};
+            }
+        }
+        else if (entry["channels"].isObject())
+        {
+            // missing channels are black with opaque alpha
+            settings.channels[3].constant = 1.0f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                parseChannel(entry["channels"][std::string(1, CHANNEL_NAMES[c])], c, settings.channels[c]);
+            }
+        }
+        else if (entry["orm"].isObject())
+        {
+            // the material layout pbr.frag samples: occlusion, roughness, metallic
+            // missing maps are unoccluded, fully rough and dielectric
+            const char* names[] = {"occlusion", "roughness", "metallic"};
+            const float defaults[] = {1.0f, 1.0f, 0.0f};
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                settings.channels[c].constant = defaults[c];
+                parseChannel(entry["orm"][names[c]], 0, settings.channels[c]);
+            }
+            settings.channels[3].constant = 1.0f;
+        }
+        else
+        {
+            throw std::runtime_error("cook entry needs a \"source\", \"channels\" or \"orm\"");
+        }
+
+        settings.virtualTexture = entry["virtual"].asBool(false);
+        if (entry["output"].isString())
+        {
+            settings.output = entry["output"].asString();
+        }
+        else if (entry["source"].isString())
+        {
+            settings.output = std::filesystem::path{entry["source"].asString()}
+                                  .replace_extension(settings.virtualTexture ? ".vtex" : ".ktx2")
+                                  .generic_string();
+        }
+        else
+        {
+            throw std::runtime_error("packed cook entries need an \"output\"");
+        }
+
+        std::string format = entry.has("format") ? entry["format"].asString() : "bc1";
+        auto name = std::find(std::begin(FORMAT_NAMES), std::end(FORMAT_NAMES), format);
+        if (name == std::end(FORMAT_NAMES))
+        {
+            throw std::runtime_error("unknown cook format " + format + " for " + settings.output);
+        }
+        settings.format = static_cast<CookFormat>(name - std::begin(FORMAT_NAMES));
+        settings.srgb = entry["srgb"].asBool(false);
+        settings.normalMap = entry["normalMap"].asBool(false);
+        settings.mips = entry["mips"].asBool(true);
+
+        if (settings.srgb && settings.format != CookFormat::RGBA8 && settings.format != CookFormat::BC1 &&
+            settings.format != CookFormat::BC3)
+        {
+            throw std::runtime_error("srgb is only available for rgba8, bc1 and bc3: " + settings.output);
+        }
+        if (settings.virtualTexture && !settings.mips)
+        {
+            // every level down to a single page is part of a .vtex
+            throw std::runtime_error("virtual textures always have mips: " + settings.output);
+        }
+        return settings;
+    }
+
+    uint64_t hashCookInputs(const CookSettings& settings)
+    {
+        // fnv-1a, bumping the version rebuilds everything after an encoder change
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto add = [&hash](const void* data, size_t size) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+            }
+        };
+
+        std::ostringstream description;
+        description << "cook v1|" << FORMAT_NAMES[static_cast<int>(settings.format)] << "|" << settings.srgb << settings.normalMap
+                    << settings.mips;
+        // only spelled out when set, the hashes of existing KTX2 outputs stay the same
+        if (settings.virtualTexture) description << "|virtual";
+        for (const CookChannel& channel : settings.channels)
+        {
+            description << "|" << channel.source << ":" << channel.channel << ":" << channel.constant;
+        }
+        std::string text = description.str();
+        add(text.data(), text.size());
+
+        std::vector<std::string> sources;
+        for (const CookChannel& channel : settings.channels)
+        {
+            if (!channel.source.empty() && std::find(sources.begin(), sources.end(), channel.source) == sources.end())
+            {
+                sources.push_back(channel.source);
+            }
+        }
+        for (const std::string& source : sources)
+        {
+            MappedFile file{source};
+            if (!file.isOpen())
+            {
+                throw std::runtime_error("missing source " + source);
+            }
+            add(file.data(), file.size());
+        }
+        return hash;
+    }
+
+    VkFormat cookedFormat(const CookSettings& settings)
+    {
+        switch (settings.format)
+        {
+        case CookFormat::RGBA8: return settings.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        case CookFormat::RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+        case CookFormat::BC1: return settings.srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case CookFormat::BC3: return settings.srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case CookFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case CookFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+        }
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    std::vector<CookImage> buildCookLevels(const CookSettings& settings)
+    {
+        std::map<std::string, CookImage> sources;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        for (const CookChannel& channel : settings.channels)
+        {
+            if (channel.source.empty() || sources.count(channel.source)) continue;
+            CookImage& image = sources[channel.source] = loadSource(channel.source);
+            if (width == 0)
+            {
+                width = image.width;
+                height = image.height;
+            }
+            else if (image.width != width || image.height != height)
+            {
+                throw std::runtime_error("packed sources differ in size: " + channel.source);
+            }
+        }
+        if (width == 0)
+        {
+            throw std::runtime_error("no source image for " + settings.output);
+        }
+
+        CookImage base{};
+        base.width = width;
+        base.height = height;
+        base.texels.resize(static_cast<size_t>(width) * height * 4);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            const CookChannel& channel = settings.channels[c];
+            const CookImage* source = channel.source.empty() ? nullptr : &sources[channel.source];
+            for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+            {
+                float value = source ? source->texels[i * 4 + channel.channel] : channel.constant;
+                base.texels[i * 4 + c] = settings.srgb && c < 3 ? srgbToLinear(value) : value;
+            }
+        }
+        sources.clear();
+
+        std::vector<CookImage> levels;
+        levels.push_back(std::move(base));
+        while (settings.mips && (levels.back().width > 1 || levels.back().height > 1))
+        {
+            levels.push_back(downsample(levels.back(), settings.normalMap));
+        }
+        return levels;
+    }
+
+    uint32_t blockRowCount(const CookImage& level, CookFormat format)
+    {
+        return isBlockCompressed(format) ? (level.height + 3) / 4 : level.height;
+    }
+
+    size_t encodedSize(const CookImage& level, CookFormat format)
+    {
+        if (isBlockCompressed(format))
+        {
+            return static_cast<size_t>((level.width + 3) / 4) * ((level.height + 3) / 4) * bytesPerBlock(format);
+        }
+        return static_cast<size_t>(level.width) * level.height * bytesPerBlock(format);
+    }
+
+    void encodeBlockRows(const CookImage& level, const CookSettings& settings, uint32_t firstRow, uint32_t lastRow, uint8_t* out)
+    {
+        const CookFormat format = settings.format;
+        if (format == CookFormat::RGBA8)
+        {
+            for (uint32_t y = firstRow; y < lastRow; y++)
+            {
+                for (uint32_t x = 0; x < level.width; x++)
+                {
+                    size_t index = static_cast<size_t>(y) * level.width + x;
+                    quantizeTexel(&level.texels[index * 4], settings.srgb, out + index * 4);
+                }
+            }
+            return;
+        }
+        if (format == CookFormat::RGBA16F)
+        {
+            // the engine's conversion, so a cooked texture has the same bits as one decoded at load time
+            std::vector<uint16_t> row(static_cast<size_t>(level.width) * 4);
+            for (uint32_t y = firstRow; y < lastRow; y++)
+            {
+                size_t index = static_cast<size_t>(y) * level.width;
+                convertFloatToHalf(&level.texels[index * 4], row.data(), row.size());
+                std::memcpy(out + index * 8, row.data(), row.size() * sizeof(uint16_t));
+            }
+            return;
+        }
+
+        uint32_t blocksWide = (level.width + 3) / 4;
+        size_t blockSize = bytesPerBlock(format);
+        for (uint32_t blockY = firstRow; blockY < lastRow; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+            {
+                // texels past the edge of small levels repeat the last row / column
+                uint8_t texels[16][4];
+                for (uint32_t i = 0; i < 16; i++)
+                {
+                    uint32_t x = std::min(blockX * 4 + i % 4, level.width - 1);
+                    uint32_t y = std::min(blockY * 4 + i / 4, level.height - 1);
+                    quantizeTexel(&level.texels[(static_cast<size_t>(y) * level.width + x) * 4], settings.srgb, texels[i]);
+                }
+
+                uint8_t* block = out + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize;
+                switch (format)
+                {
+                case CookFormat::BC1: encodeBlockBC1(texels, block); break;
+                case CookFormat::BC3: encodeBlockBC3(texels, block); break;
+                case CookFormat::BC5: encodeBlockBC5(texels, block); break;
+                case CookFormat::BC4:
+                {
+                    uint8_t red[16];
+                    for (int i = 0; i < 16; i++) red[i] = texels[i][0];
+                    encodeBlockBC4(red, block);
+                    break;
+                }
+                default: break;
+                }
+            }
+        }
+    }
+
+    CookImage extractVirtualTile(const CookImage& level, uint32_t pageX, uint32_t pageY)
+    {
+        CookImage tile{};
+        tile.width = VIRTUAL_TILE_STRIDE;
+        tile.height = VIRTUAL_TILE_STRIDE;
+        tile.texels.resize(static_cast<size_t>(tile.width) * tile.height * 4);
+
+        int64_t left = static_cast<int64_t>(pageX) * VIRTUAL_TILE_SIZE - VIRTUAL_TILE_BORDER;
+        int64_t top = static_cast<int64_t>(pageY) * VIRTUAL_TILE_SIZE - VIRTUAL_TILE_BORDER;
+        for (uint32_t y = 0; y < tile.height; y++)
+        {
+            // levels narrower than a page repeat their last texel up to the page size as well
+            uint32_t sy = static_cast<uint32_t>(std::clamp<int64_t>(top + y, 0, level.height - 1));
+            for (uint32_t x = 0; x < tile.width; x++)
+            {
+                uint32_t sx = static_cast<uint32_t>(std::clamp<int64_t>(left + x, 0, level.width - 1));
+                std::memcpy(&tile.texels[(static_cast<size_t>(y) * tile.width + x) * 4],
+                            &level.texels[(static_cast<size_t>(sy) * level.width + sx) * 4], 4 * sizeof(float));
+            }
+        }
+        return tile;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Json.hpp"
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    enum class CookFormat { RGBA8, RGBA16F, BC1, BC3, BC4, BC5 };
+
+    // one output channel, taken from a channel of a source image or a constant if source is empty
+    struct CookChannel
+    {
+        std::string source;
+        uint32_t channel = 0;
+        float constant = 0.0f;
+    };
+
+    // one entry of the cook list
+    struct CookSettings
+    {
+        // relative to the output directory
+        std::string output;
+        std::array<CookChannel, 4> channels;
+        CookFormat format = CookFormat::BC1;
+        // sources are srgb encoded, the mips are filtered in linear and the output format is an srgb one
+        bool srgb = false;
+        // rgb holds a tangent space normal, every mip is renormalized
+        bool normalMap = false;
+        bool mips = true;
+        // cut into pages with borders and written as a .vtex (VirtualTextureFile.hpp) instead of a KTX2
+        bool virtualTexture = false;
+    };
+
+    // linear float rgba
+    struct CookImage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> texels;
+    };
+
+    // source paths are resolved against baseDirectory, throws std::runtime_error on invalid settings
+    CookSettings parseCookSettings(const JsonValue& entry, const std::string& baseDirectory);
+    // hash of the settings and the contents of every source file, an output is rebuilt when it changes
+    uint64_t hashCookInputs(const CookSettings& settings);
+    VkFormat cookedFormat(const CookSettings& settings);
+
+    // loads and packs the sources and builds the mip chain, level 0 first
+    std::vector<CookImage> buildCookLevels(const CookSettings& settings);
+
+    // encoding works on rows of blocks (4 texel rows for BCn, 1 otherwise) so a level can be split across threads
+    uint32_t blockRowCount(const CookImage& level, CookFormat format);
+    size_t encodedSize(const CookImage& level, CookFormat format);
+    // writes block rows [firstRow, lastRow) of level into out, which holds the whole encoded level
+    void encodeBlockRows(const CookImage& level, const CookSettings& settings, uint32_t firstRow, uint32_t lastRow, uint8_t* out);
+
+    // the VIRTUAL_TILE_STRIDE sized tile of page (pageX, pageY) of level, its border clamped at the edges of the level
+    CookImage extractVirtualTile(const CookImage& level, uint32_t pageX, uint32_t pageY);
+}
@@ -0,0 +1,59 @@
+#include "VirtualTextureWriter.hpp"
+#include "VirtualTextureFile.hpp"
+
+// std
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace RenderingEngine
+{
+    void writeVirtualTextureFile(
+        const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& tiles)
+    {
+        VirtualTextureLayout layout{format, width, height, tiles.empty() ? 0 : tiles[0].size()};
+        if (tiles.size() != layout.pageCount())
+        {
+            throw std::runtime_error("virtual texture " + path + " needs " + std::to_string(layout.pageCount()) + " tiles");
+        }
+        for (const std::vector<uint8_t>& tile : tiles)
+        {
+            if (tile.size() != layout.tileBytes)
+            {
+                throw std::runtime_error("tiles of " + path + " differ in size");
+            }
+        }
+
+        VirtualTextureHeader header{};
+        std::memcpy(header.identifier, VIRTUAL_TEXTURE_IDENTIFIER, sizeof(header.identifier));
+        header.vkFormat = format;
+        header.width = width;
+        header.height = height;
+        header.levelCount = layout.levelCount;
+        header.tileBytes = layout.tileBytes;
+        header.dataOffset = sizeof(header);
+
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (const std::vector<uint8_t>& tile : tiles)
+            {
+                out.write(reinterpret_cast<const char*>(tile.data()), static_cast<std::streamsize>(tile.size()));
+            }
+            if (!out)
+            {
+                throw std::runtime_error("failed to write " + temporary);
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("failed to replace " + path + ": " + error.message());
+        }
+    }
+}
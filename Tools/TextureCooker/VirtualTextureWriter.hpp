@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RenderingEngine
+{
+    /*************************************************
+    Writes a .vtex file, what parseVirtualTextureFile reads back
+    - tiles are indexed like VirtualTextureLayout pages: level 0 first, row major within a level
+    - every tile is already encoded in format and has the same size
+    Written to <path>.tmp first and renamed, a reader never sees half a file.
+    *************************************************/
+    void writeVirtualTextureFile(
+        const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>>& tiles);
+}
@@ -0,0 +1,354 @@
+// Cooks source textures (png / jpg / hdr ...) into KTX2 files LveTexture uploads as stored,
+// or into tiled .vtex files VirtualTextureSystem streams page by page
+// usage: TextureCooker <cook list .json> <output directory> [--force] [--jobs N]
+//
+// the cook list names the outputs, see Assets/Textures/textures.cook.json:
+//   {"textures": [{"source": "albedo.png", "format": "bc1"},
+//                 {"source": "normal.png", "format": "rgba8", "normalMap": true},
+//                 {"output": "rm.ktx2", "format": "bc5", "channels": {"r": {"source": "r.png"}, "g": {"source": "m.png", "channel": "r"}}},
+//                 {"output": "orm.ktx2", "format": "bc1", "orm": {"occlusion": "ao.png", "roughness": "r.png", "metallic": "m.png"}},
+//                 {"source": "terrain.png", "format": "bc1", "srgb": true, "virtual": true}]}
+// formats: rgba8, rgba16f, bc1, bc3, bc4, bc5, options: srgb, normalMap, mips (default true), virtual
+// <output directory>/manifest.json records the hash of every output's sources and settings,
+// outputs whose hash did not change are not cooked again
+
+#include "Json.hpp"
+#include "Ktx2Writer.hpp"
+#include "MappedFile.hpp"
+#include "TextureCooker.hpp"
+#include "ThreadPool.hpp"
+#include "VirtualTextureFile.hpp"
+#include "VirtualTextureWriter.hpp"
+
+// std
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace RenderingEngine;
+
+namespace
+{
+    struct ManifestEntry
+    {
+        std::string output;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levels = 0;
+        uint64_t hash = 0;
+    };
+
+    struct CookJob
+    {
+        CookSettings settings;
+        std::future<uint64_t> hash;
+        std::future<std::vector<CookImage>> levels;
+    };
+
+    JsonValue readJsonFile(const std::string& path)
+    {
+        MappedFile file{path};
+        if (!file.isOpen())
+        {
+            throw std::runtime_error("failed to open " + path);
+        }
+        return JsonValue::parse(std::string_view{reinterpret_cast<const char*>(file.data()), file.size()});
+    }
+
+    std::string toHex(uint64_t value)
+    {
+        std::ostringstream out;
+        out << std::hex << std::setw(16) << std::setfill('0') << value;
+        return out.str();
+    }
+
+    std::string quote(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\') quoted += '\\';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // whole numbers in [0, max] only, anything else would be undefined to cast and marks the manifest stale
+    uint32_t toUint32(const JsonValue& value, const char* what, uint32_t max = std::numeric_limits<uint32_t>::max())
+    {
+        double number = value.asNumber(-1.0);
+        if (!(number >= 0.0 && number <= max) || number != std::floor(number))
+        {
+            throw std::runtime_error(std::string{"invalid "} + what);
+        }
+        return static_cast<uint32_t>(number);
+    }
+
+    // a missing or unreadable manifest only means everything is cooked again
+    std::map<std::string, ManifestEntry> readManifest(const std::string& path)
+    {
+        std::map<std::string, ManifestEntry> entries;
+        if (!std::filesystem::exists(path)) return entries;
+        try
+        {
+            JsonValue manifest = readJsonFile(path);
+            const JsonValue& textures = manifest["textures"];
+            for (size_t i = 0; i < textures.size(); i++)
+            {
+                ManifestEntry entry{};
+                entry.output = textures[i]["output"].asString();
+                // VkFormat values stay below VK_FORMAT_MAX_ENUM
+                entry.format = static_cast<VkFormat>(toUint32(textures[i]["vkFormat"], "vkFormat", 0x7FFFFFFF));
+                entry.width = toUint32(textures[i]["width"], "width");
+                entry.height = toUint32(textures[i]["height"], "height");
+                entry.levels = toUint32(textures[i]["levels"], "levels");
+                entry.hash = std::strtoull(textures[i]["hash"].asString().c_str(), nullptr, 16);
+                entries[entry.output] = entry;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Ignoring manifest " << path << ": " << e.what() << std::endl;
+            entries.clear();
+        }
+        return entries;
+    }
+
+    void writeManifest(const std::string& path, const std::vector<ManifestEntry>& entries)
+    {
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream out{temporary, std::ios::trunc};
+            out << "{\n  \"version\": 1,\n  \"textures\": [";
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                const ManifestEntry& entry = entries[i];
+                out << (i ? ",\n" : "\n") << "    {\"output\": " << quote(entry.output) << ", \"vkFormat\": " << entry.format
+                    << ", \"width\": " << entry.width << ", \"height\": " << entry.height << ", \"levels\": " << entry.levels
+                    << ", \"hash\": \"" << toHex(entry.hash) << "\"}";
+            }
+            out << "\n  ]\n}\n";
+        }
+        std::filesystem::rename(temporary, path);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string listPath;
+    std::string outputDirectory;
+    bool force = false;
+    uint32_t jobs = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--force") force = true;
+        else if (argument == "--jobs" && i + 1 < argc) jobs = static_cast<uint32_t>(std::atoi(argv[++i]));
+        else if (listPath.empty()) listPath = argument;
+        else outputDirectory = argument;
+    }
+    if (listPath.empty() || outputDirectory.empty())
+    {
+        std::cout << "usage: TextureCooker <cook list .json> <output directory> [--force] [--jobs N]" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    JsonValue list;
+    try
+    {
+        list = readJsonFile(listPath);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+    std::string baseDirectory = std::filesystem::path{listPath}.parent_path().generic_string();
+    std::filesystem::create_directories(outputDirectory);
+    std::string manifestPath = (std::filesystem::path{outputDirectory} / "manifest.json").generic_string();
+    std::map<std::string, ManifestEntry> previous = force ? std::map<std::string, ManifestEntry>{} : readManifest(manifestPath);
+
+    // the cooker owns the machine, every core encodes
+    ThreadPool threadPool{std::max(jobs, 1u)};
+    size_t failed = 0;
+
+    // hashing reads every source once, do it on the pool while the list is walked
+    std::vector<CookJob> cookJobs;
+    const JsonValue& textures = list["textures"];
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        try
+        {
+            CookJob job{};
+            job.settings = parseCookSettings(textures[i], baseDirectory);
+            CookSettings settings = job.settings;
+            job.hash = threadPool.submit([settings]() { return hashCookInputs(settings); });
+            cookJobs.push_back(std::move(job));
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Skipping cook entry " << i << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+
+    // indexed like cookJobs so the manifest keeps the order of the list
+    std::vector<std::optional<ManifestEntry>> manifest(cookJobs.size());
+    std::vector<size_t> dirty;
+    size_t cooked = 0;
+    size_t upToDate = 0;
+    std::vector<uint64_t> hashes(cookJobs.size());
+    for (size_t i = 0; i < cookJobs.size(); i++)
+    {
+        const CookSettings& settings = cookJobs[i].settings;
+        try
+        {
+            hashes[i] = cookJobs[i].hash.get();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Failed " << settings.output << ": " << e.what() << std::endl;
+            failed++;
+            continue;
+        }
+
+        auto known = previous.find(settings.output);
+        if (known != previous.end() && known->second.hash == hashes[i] &&
+            std::filesystem::exists(std::filesystem::path{outputDirectory} / settings.output))
+        {
+            manifest[i] = known->second;
+            upToDate++;
+        }
+        else
+        {
+            dirty.push_back(i);
+        }
+    }
+
+    // decoding and mip building of the next textures overlaps the encoding of the current one,
+    // a couple ahead is enough to keep every core busy without holding every float image in memory
+    constexpr size_t LOOKAHEAD = 2;
+    auto prepare = [&](size_t d) {
+        if (d >= dirty.size()) return;
+        CookSettings settings = cookJobs[dirty[d]].settings;
+        cookJobs[dirty[d]].levels = threadPool.submit([settings]() { return buildCookLevels(settings); });
+    };
+    for (size_t d = 0; d < LOOKAHEAD; d++) prepare(d);
+
+    for (size_t d = 0; d < dirty.size(); d++)
+    {
+        prepare(d + LOOKAHEAD);
+        CookJob& job = cookJobs[dirty[d]];
+        const CookSettings& settings = job.settings;
+        auto cookStart = std::chrono::high_resolution_clock::now();
+        try
+        {
+            std::vector<CookImage> levels = job.levels.get();
+            std::filesystem::path outputPath = std::filesystem::path{outputDirectory} / settings.output;
+            std::filesystem::create_directories(outputPath.parent_path());
+            uint32_t levelCount = static_cast<uint32_t>(levels.size());
+
+            if (settings.virtualTexture)
+            {
+                // the levels down to a single page are cut into tiles, one job per row of pages
+                VirtualTextureLayout layout{cookedFormat(settings), levels[0].width, levels[0].height, 0};
+                std::vector<std::vector<uint8_t>> tiles(layout.pageCount());
+                std::vector<std::future<void>> rows;
+                for (uint32_t level = 0; level < layout.levelCount; level++)
+                {
+                    for (uint32_t y = 0; y < layout.pagesY(level); y++)
+                    {
+                        const CookImage* image = &levels[level];
+                        std::vector<uint8_t>* row = &tiles[layout.pageIndex(level, 0, y)];
+                        uint32_t pagesX = layout.pagesX(level);
+                        rows.push_back(threadPool.submit([image, &settings, y, row, pagesX]() {
+                            for (uint32_t x = 0; x < pagesX; x++)
+                            {
+                                CookImage tile = extractVirtualTile(*image, x, y);
+                                row[x].resize(encodedSize(tile, settings.format));
+                                encodeBlockRows(tile, settings, 0, blockRowCount(tile, settings.format), row[x].data());
+                            }
+                        }));
+                    }
+                }
+                for (std::future<void>& row : rows) row.get();
+
+                writeVirtualTextureFile(outputPath.generic_string(), cookedFormat(settings), levels[0].width, levels[0].height, tiles);
+                levelCount = layout.levelCount;
+            }
+            else
+            {
+                // split every level into bands of block rows
+                std::vector<std::vector<uint8_t>> encoded(levels.size());
+                std::vector<std::future<void>> bands;
+                for (size_t level = 0; level < levels.size(); level++)
+                {
+                    encoded[level].resize(encodedSize(levels[level], settings.format));
+                    uint32_t rows = blockRowCount(levels[level], settings.format);
+                    uint32_t rowsPerBand = std::max(rows / (threadPool.getThreadCount() * 4), 1u);
+                    for (uint32_t first = 0; first < rows; first += rowsPerBand)
+                    {
+                        uint32_t last = std::min(first + rowsPerBand, rows);
+                        const CookImage* image = &levels[level];
+                        uint8_t* out = encoded[level].data();
+                        bands.push_back(threadPool.submit(
+                            [image, &settings, first, last, out]() { encodeBlockRows(*image, settings, first, last, out); }));
+                    }
+                }
+                for (std::future<void>& band : bands) band.get();
+
+                writeKtx2File(outputPath.generic_string(), cookedFormat(settings), levels[0].width, levels[0].height, encoded);
+            }
+
+            ManifestEntry entry{};
+            entry.output = settings.output;
+            entry.format = cookedFormat(settings);
+            entry.width = levels[0].width;
+            entry.height = levels[0].height;
+            entry.levels = levelCount;
+            entry.hash = hashes[dirty[d]];
+            manifest[dirty[d]] = entry;
+            cooked++;
+
+            auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                std::chrono::high_resolution_clock::now() - cookStart).count();
+            std::cout << "Cooked " << settings.output << " (" << entry.width << "x" << entry.height << ", " << entry.levels
+                      << " levels) in " << elapsed << " ms" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Failed " << settings.output << ": " << e.what() << std::endl;
+            failed++;
+            // the old output stays listed until a cook succeeds, its hash no longer matches so it is retried
+            auto known = previous.find(settings.output);
+            if (known != previous.end()) manifest[dirty[d]] = known->second;
+        }
+    }
+
+    std::vector<ManifestEntry> entries;
+    for (const std::optional<ManifestEntry>& entry : manifest)
+    {
+        if (entry) entries.push_back(*entry);
+    }
+    writeManifest(manifestPath, entries);
+
+    auto elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed in "
+              << elapsed << " ms" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Compares VertexWelder against the std::unordered_map dedup loadObjModel used before
+// usage: VertexWeldBenchmark [grid size, default 1024]
+
+#include "VertexWelder.hpp"
+#include "utility.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+// std
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace std
+{
+    template <>
+    struct hash<RenderingEngine::LveModel::Vertex>
+    {
+        size_t operator()(RenderingEngine::LveModel::Vertex const& vertex) const
+        {
+            size_t seed = 0;
+            RenderingEngine::hashCombine(seed, vertex.position, vertex.normal, vertex.tangent, vertex.bitangent, vertex.uv);
+            return seed;
+        }
+    };
+}
+
+using RenderingEngine::LveModel;
+using RenderingEngine::VertexWelder;
+
+// triangle soup of a (gridSize + 1)^2 vertex grid, six corners per quad like an unindexed obj
+static std::vector<LveModel::Vertex> makeTriangleSoup(uint32_t gridSize)
+{
+    auto gridVertex = [gridSize](uint32_t x, uint32_t y) {
+        LveModel::Vertex vertex{};
+        float u = static_cast<float>(x) / gridSize;
+        float v = static_cast<float>(y) / gridSize;
+        vertex.position = {u * 10.0f, glm::sin(u * 20.0f) * glm::cos(v * 20.0f), v * 10.0f};
+        vertex.normal = glm::normalize(glm::vec3{-glm::cos(u * 20.0f), 1.0f, glm::sin(v * 20.0f)});
+        vertex.tangent = {1.0f, 0.0f, 0.0f};
+        vertex.bitangent = glm::cross(vertex.normal, vertex.tangent);
+        vertex.uv = {u, v};
+        return vertex;
+    };
+
+    std::vector<LveModel::Vertex> soup;
+    soup.reserve(static_cast<size_t>(gridSize) * gridSize * 6);
+    for (uint32_t y = 0; y < gridSize; y++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            soup.push_back(gridVertex(x, y));
+            soup.push_back(gridVertex(x + 1, y));
+            soup.push_back(gridVertex(x + 1, y + 1));
+            soup.push_back(gridVertex(x, y));
+            soup.push_back(gridVertex(x + 1, y + 1));
+            soup.push_back(gridVertex(x, y + 1));
+        }
+    }
+    return soup;
+}
+
+template <typename Function>
+static double measureMilliseconds(Function&& function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t gridSize = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1024;
+    std::vector<LveModel::Vertex> soup = makeTriangleSoup(gridSize);
+    std::cout << "Corners: " << soup.size() << ", expected unique vertices: "
+              << static_cast<size_t>(gridSize + 1) * (gridSize + 1) << std::endl;
+
+    std::vector<LveModel::Vertex> mapVertices;
+    std::vector<uint32_t> mapIndices;
+    double mapTime = measureMilliseconds([&]() {
+        std::unordered_map<LveModel::Vertex, uint32_t> uniqueVertices{};
+        for (const auto& vertex : soup)
+        {
+            if (uniqueVertices.count(vertex) == 0)
+            {
+                uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+                mapVertices.push_back(vertex);
+            }
+            mapIndices.push_back(uniqueVertices[vertex]);
+        }
+    });
+
+    std::vector<LveModel::Vertex> weldVertices;
+    std::vector<uint32_t> weldIndices;
+    double weldTime = measureMilliseconds([&]() {
+        VertexWelder welder{weldVertices, soup.size() / 6};
+        weldIndices.reserve(soup.size());
+        for (const auto& vertex : soup)
+        {
+            weldIndices.push_back(welder.weld(vertex));
+        }
+    });
+
+    std::vector<LveModel::Vertex> toleranceVertices;
+    double toleranceTime = measureMilliseconds([&]() {
+        VertexWelder welder{toleranceVertices, soup.size() / 6, 1e-5f};
+        for (const auto& vertex : soup)
+        {
+            welder.weld(vertex);
+        }
+    });
+
+    bool identical = mapVertices.size() == weldVertices.size() && mapIndices == weldIndices;
+    std::cout << "unordered_map:          " << mapTime << " ms, " << mapVertices.size() << " vertices" << std::endl;
+    std::cout << "VertexWelder exact:     " << weldTime << " ms, " << weldVertices.size() << " vertices"
+              << " (" << mapTime / weldTime << "x)" << std::endl;
+    std::cout << "VertexWelder tolerance: " << toleranceTime << " ms, " << toleranceVertices.size() << " vertices" << std::endl;
+    std::cout << (identical ? "Index buffers match" : "Index buffers DIFFER") << std::endl;
+    return identical ? 0 : 1;
+}
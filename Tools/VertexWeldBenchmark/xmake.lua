@@ -0,0 +1,7 @@
+-- xmake build VertexWeldBenchmark && xmake run VertexWeldBenchmark
+target("VertexWeldBenchmark")
+    set_default(false)
+    set_kind("binary")
+    add_files("*.cpp")
+    add_deps("VulkanRHI")
+    add_includedirs("$(projectdir)/Engine/Modules/Rendering/Vulkan", "$(projectdir)/Engine/External")
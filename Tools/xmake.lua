@@ -0,0 +1,3 @@
+includes("VertexWeldBenchmark")
+includes("TextureCooker")
+includes("EngineTests")
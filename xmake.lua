@@ -16,4 +16,4 @@ set_defaultmode("debug") -- set default compile mode
 add_requires("vulkansdk", "glm", "vcpkg::glfw3", "assimp")
 add_packages("vulkansdk", "glm", "vcpkg::glfw3", "assimp")
 add_syslinks("user32", "gdi32", "shell32")
-includes("Engine","Shaders")
\ No newline at end of file
+includes("Engine","Shaders","Tools")
\ No newline at end of file